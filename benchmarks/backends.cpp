@@ -0,0 +1,101 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Allocation workload run once without this sanitizer and once per allocator
+ * backend with it, allowing to compare the combinations.
+ *
+ * The results are printed as one JSON object per line to the standard output
+ * stream, labeled with the given backend name.
+ *
+ * Usage: backends <label>
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+/** The clock used to measure the workload.                 */
+using Clock = std::chrono::steady_clock;
+
+/** The amount of blocks kept alive by each thread.         */
+static constexpr std::size_t liveBlocks = 1024;
+/** The amount of allocation and deallocation pairs per thread. */
+static constexpr std::size_t operations = 1000000;
+
+/**
+ * Replaces random blocks of random sizes.
+ *
+ * @param seed the seed of the random numbers
+ */
+static void churn(unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<std::size_t> sizes(8, 4096), slots(0, liveBlocks - 1);
+    std::vector<void*> blocks(liveBlocks, nullptr);
+    for (std::size_t i = 0; i < operations; ++i) {
+        auto& block = blocks[slots(random)];
+        std::free(block);
+        block = std::malloc(sizes(random));
+        static_cast<volatile char*>(block)[0] = 1;
+    }
+    for (const auto& block : blocks) {
+        std::free(block);
+    }
+}
+
+/**
+ * Runs the workload on the given amount of threads and prints its result.
+ *
+ * @param label the name of the measured backend
+ * @param threads the amount of threads
+ */
+static void run(const char* label, std::size_t threads) {
+    const auto begin = Clock::now();
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(churn, static_cast<unsigned>(i + 1));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    const auto nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+    const auto total       = static_cast<double>(threads * operations);
+    std::printf("{\"benchmark\":\"backend.churn\",\"backend\":\"%s\",\"threads\":%zu,\"operations\":%zu,"
+                "\"seconds\":%.6f,\"ns_per_op\":%.2f,\"ops_per_sec\":%.0f}\n",
+                label, threads, threads * operations, nanoseconds / 1e9, nanoseconds / total, total / nanoseconds * 1e9);
+    std::fflush(stdout);
+}
+}
+
+int main(int argc, char** argv) {
+    const auto label    = argc > 1 ? argv[1] : "unnamed";
+    const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= hardware; threads *= 2) {
+        run(label, threads);
+    }
+    return 0;
+}
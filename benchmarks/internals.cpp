@@ -0,0 +1,459 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Microbenchmarks of the internal data structures.
+ *
+ * Every benchmark exercises one component in isolation. The results are
+ * printed as one JSON object per line to the standard output stream.
+ *
+ * Usage: internals [entries...]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "LeakSani.hpp"
+#include "TLSTracker.hpp"
+#include "allocators/ObjectPool.hpp"
+#include "allocators/PoolAllocator.hpp"
+#include "callstacks/callstackHelper.hpp"
+#include "presence/presence.hpp"
+#include "statistics/Stats.hpp"
+
+namespace {
+/** The clock used to measure the benchmarks.                     */
+using Clock = std::chrono::steady_clock;
+/** The map type of the allocation trackers.                      */
+template<typename T>
+using PoolMap = std::map<const void* const, T, std::less<const void* const>, lsan::PoolAllocator<std::pair<const void* const, T>>>;
+
+/** The minimal duration of the benchmarks of small entry counts. */
+static constexpr auto minimalDuration = std::chrono::milliseconds(100);
+/** The size of the objects allocated from the object pools.      */
+static constexpr std::size_t objectSize = 64;
+/** The amount of objects in one block of the object pools.       */
+static constexpr std::size_t blockSize = 500;
+/** The amount of distinct callstacks that are classified.        */
+static constexpr std::size_t callstackCount = 64;
+
+/** Keeps the results of the benchmarked lookups alive.           */
+static volatile std::size_t sink;
+
+/**
+ * Prints the result of a benchmark.
+ *
+ * @param benchmark the name of the benchmark
+ * @param entries the amount of entries the benchmark worked on
+ * @param threads the amount of threads used
+ * @param operations the amount of performed operations
+ * @param elapsed the time the operations took
+ */
+static void print(const char* benchmark, std::size_t entries, std::size_t threads, std::size_t operations, Clock::duration elapsed) {
+    const auto nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    std::printf("{\"benchmark\":\"%s\",\"entries\":%zu,\"threads\":%zu,\"operations\":%zu,"
+                "\"seconds\":%.6f,\"ns_per_op\":%.2f,\"ops_per_sec\":%.0f}\n",
+                benchmark, entries, threads, operations, nanoseconds / 1e9,
+                operations == 0 ? 0.0 : nanoseconds / static_cast<double>(operations),
+                nanoseconds == 0 ? 0.0 : static_cast<double>(operations) / nanoseconds * 1e9);
+    std::fflush(stdout);
+}
+
+/**
+ * Prints that a benchmark has been skipped.
+ *
+ * @param benchmark the name of the benchmark
+ * @param entries the amount of entries
+ * @param reason the reason why the benchmark was skipped
+ */
+static void skip(const char* benchmark, std::size_t entries, const char* reason) {
+    std::printf("{\"benchmark\":\"%s\",\"entries\":%zu,\"skipped\":\"%s\"}\n", benchmark, entries, reason);
+    std::fflush(stdout);
+}
+
+/**
+ * Measures the duration of the given function.
+ *
+ * @param function the function to be measured
+ * @return the measured duration
+ */
+template<typename F>
+static inline auto measure(F&& function) -> Clock::duration {
+    const auto begin = Clock::now();
+    function();
+    return Clock::now() - begin;
+}
+
+/**
+ * Returns whether the given amount of bytes fits into half of the physical memory.
+ *
+ * @param bytes the amount of bytes
+ * @return whether the bytes can be allocated safely
+ */
+static inline auto fits(std::size_t bytes) -> bool {
+    const auto pages = sysconf(_SC_PHYS_PAGES);
+    return pages <= 0 || bytes < static_cast<std::size_t>(pages) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) / 2;
+}
+
+/**
+ * Creates the given amount of distinct, shuffled keys looking like heap pointers.
+ *
+ * @param count the amount of keys
+ * @return the keys
+ */
+static auto makeKeys(std::size_t count) -> std::vector<const void*> {
+    std::vector<const void*> keys;
+    keys.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        keys.push_back(reinterpret_cast<const void*>(0x100000 + i * 16));
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(count));
+    return keys;
+}
+
+/**
+ * Benchmarks the insertion, lookup and removal of entries in the map type of the allocation trackers.
+ *
+ * @param name the name of the benchmark
+ * @param keys the keys to be used
+ * @param prototype the value every entry is a copy of
+ */
+template<typename T>
+static void benchRegistry(const char* name, const std::vector<const void*>& keys, const T& prototype) {
+    const auto count = keys.size();
+    const auto nodeSize = sizeof(std::pair<const void* const, T>) + 4 * sizeof(void*) + sizeof(void*);
+    const auto prefix = std::string("registry.") + name;
+    if (!fits(count * nodeSize)) {
+        skip((prefix + ".insert").c_str(), count, "insufficient memory");
+        return;
+    }
+
+    Clock::duration inserting {}, looking {}, erasing {};
+    std::size_t rounds = 0;
+    do {
+        PoolMap<T> map;
+        inserting += measure([&] {
+            for (const auto& key : keys) {
+                map.emplace(key, prototype);
+            }
+        });
+        std::size_t found = 0;
+        looking += measure([&] {
+            for (const auto& key : keys) {
+                found += map.find(key) != map.end();
+            }
+        });
+        sink = found;
+        erasing += measure([&] {
+            for (const auto& key : keys) {
+                map.erase(key);
+            }
+        });
+        ++rounds;
+    } while (inserting + looking + erasing < minimalDuration);
+
+    print((prefix + ".insert").c_str(), count, 1, count * rounds, inserting);
+    print((prefix + ".lookup").c_str(), count, 1, count * rounds, looking);
+    print((prefix + ".erase").c_str(),  count, 1, count * rounds, erasing);
+}
+
+/**
+ * Benchmarks the registration and removal of allocation records in a thread-local tracker.
+ *
+ * @param keys the pointers of the allocation records
+ * @param prototype the allocation record every record is a copy of
+ */
+static void benchTracker(const std::vector<const void*>& keys, const lsan::MallocInfo& prototype) {
+    const auto count = keys.size();
+    if (!fits(count * (sizeof(lsan::MallocInfo) + 6 * sizeof(void*)))) {
+        skip("tracker.add", count, "insufficient memory");
+        return;
+    }
+
+    Clock::duration adding {}, removing {};
+    std::size_t rounds = 0;
+    do {
+        lsan::TLSTracker tracker;
+        adding += measure([&] {
+            for (const auto& key : keys) {
+                auto info = prototype;
+                info.pointer = const_cast<void*>(key);
+                tracker.addMalloc(std::move(info));
+            }
+        });
+        removing += measure([&] {
+            for (const auto& key : keys) {
+                tracker.maybeRemoveMalloc(const_cast<void*>(key));
+            }
+        });
+        ++rounds;
+    } while (adding + removing < minimalDuration);
+
+    print("tracker.add",    count, 1, count * rounds, adding);
+    print("tracker.remove", count, 1, count * rounds, removing);
+}
+
+/**
+ * Benchmarks the marking, checking and unmarking of pointers in the presence filter.
+ *
+ * @param keys the pointers to be marked
+ */
+static void benchPresence(const std::vector<const void*>& keys) {
+    const auto count = keys.size();
+
+    Clock::duration adding {}, hitting {}, missing {}, removing {};
+    std::size_t rounds = 0;
+    do {
+        adding += measure([&] {
+            for (const auto& key : keys) {
+                lsan::presence::add(key);
+            }
+        });
+        std::size_t found = 0;
+        hitting += measure([&] {
+            for (const auto& key : keys) {
+                found += lsan::presence::mayContain(key);
+            }
+        });
+        missing += measure([&] {
+            for (const auto& key : keys) {
+                found += lsan::presence::mayContain(static_cast<const char*>(key) + count * 16);
+            }
+        });
+        sink = found;
+        removing += measure([&] {
+            for (const auto& key : keys) {
+                lsan::presence::remove(key);
+            }
+        });
+        ++rounds;
+    } while (adding + hitting + missing + removing < minimalDuration);
+
+    print("presence.add",    count, 1, count * rounds, adding);
+    print("presence.hit",    count, 1, count * rounds, hitting);
+    print("presence.miss",   count, 1, count * rounds, missing);
+    print("presence.remove", count, 1, count * rounds, removing);
+}
+
+/**
+ * @brief Benchmarks an allocation pattern of the object pool.
+ *
+ * All objects are deallocated again, so every block is released as a whole.
+ *
+ * @param name the name of the benchmark
+ * @param count the amount of objects to allocate at once
+ * @param order the function reordering the allocated objects before they are deallocated
+ */
+static void benchPool(const char* name, std::size_t count, const std::function<void(std::vector<void*>&)>& order) {
+    if (!fits(count * (objectSize + sizeof(void*)))) {
+        skip(name, count, "insufficient memory");
+        return;
+    }
+
+    lsan::ObjectPool pool(objectSize, blockSize);
+    std::vector<void*> objects(count);
+    Clock::duration elapsed {};
+    std::size_t rounds = 0;
+    do {
+        elapsed += measure([&] {
+            for (auto& object : objects) {
+                object = pool.allocate();
+            }
+        });
+        order(objects);
+        elapsed += measure([&] {
+            for (const auto& object : objects) {
+                pool.deallocate(object);
+            }
+        });
+        ++rounds;
+    } while (elapsed < minimalDuration);
+
+    print(name, count, 1, 2 * count * rounds, elapsed);
+}
+
+/**
+ * Benchmarks the object pool while only some of its objects are deallocated,
+ * so that no block can be released.
+ *
+ * @param count the amount of objects to allocate
+ */
+static void benchPoolChurn(std::size_t count) {
+    if (!fits(count * (objectSize + sizeof(void*)))) {
+        skip("pool.churn", count, "insufficient memory");
+        return;
+    }
+
+    lsan::ObjectPool pool(objectSize, blockSize);
+    std::vector<void*> objects(count);
+    for (auto& object : objects) {
+        object = pool.allocate();
+    }
+    std::mt19937_64 random(count);
+    std::uniform_int_distribution<std::size_t> distribution(0, count - 1);
+    std::size_t operations = 0;
+    Clock::duration elapsed {};
+    do {
+        elapsed += measure([&] {
+            for (std::size_t i = 0; i < count; ++i) {
+                auto& object = objects[distribution(random)];
+                pool.deallocate(object);
+                object = pool.allocate();
+            }
+        });
+        operations += 2 * count;
+    } while (elapsed < minimalDuration);
+    for (const auto& object : objects) {
+        pool.deallocate(object);
+    }
+
+    print("pool.churn", count, 1, operations, elapsed);
+}
+
+/**
+ * @brief Benchmarks concurrent updates of one statistics object.
+ *
+ * The amount of updates per thread is reported as the amount of entries.
+ *
+ * @param threads the amount of updating threads
+ * @param operations the amount of updates per thread
+ */
+static void benchStats(std::size_t threads, std::size_t operations) {
+    lsan::Stats stats;
+    std::atomic_size_t ready = 0;
+    std::atomic_bool start = false;
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([&, i] {
+            ++ready;
+            while (!start.load(std::memory_order_acquire));
+            for (std::size_t j = 0; j < operations / 2; ++j) {
+                const auto size = 16 + (i + j) % 1024;
+                stats.addMalloc(size);
+                stats.addFree(size);
+            }
+        });
+    }
+    while (ready < threads);
+    const auto elapsed = measure([&] {
+        start.store(true, std::memory_order_release);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    });
+    print("stats.update", operations, threads, threads * (operations / 2) * 2, elapsed);
+}
+
+/**
+ * Captures a callstack after descending the given amount of frames.
+ *
+ * @param depth the amount of frames to descend
+ * @return the captured callstack
+ */
+[[ gnu::noinline ]] static auto captureAt(std::size_t depth) -> lcs::callstack {
+    if (depth == 0) {
+        return lcs::callstack();
+    }
+    auto toReturn = captureAt(depth - 1);
+    __asm__ __volatile__("" ::: "memory");
+    return toReturn;
+}
+
+/**
+ * Benchmarks the classification of callstacks: the first classification
+ * translates the binaries, the following ones use the cache.
+ */
+static void benchClassification() {
+    std::vector<lcs::callstack> callstacks;
+    callstacks.reserve(callstackCount);
+    for (std::size_t i = 0; i < callstackCount; ++i) {
+        callstacks.push_back(captureAt(i % 16));
+    }
+
+    std::size_t users = 0;
+    const auto cold = measure([&] {
+        for (auto& callstack : callstacks) {
+            users += lsan::callstackHelper::getCallstackType(callstack) == lsan::callstackHelper::CallstackType::USER;
+        }
+    });
+    print("classification.cold", callstackCount, 1, callstackCount, cold);
+
+    Clock::duration warm {};
+    std::size_t operations = 0;
+    do {
+        warm += measure([&] {
+            for (auto& callstack : callstacks) {
+                users += lsan::callstackHelper::getCallstackType(callstack) == lsan::callstackHelper::CallstackType::USER;
+            }
+        });
+        operations += callstackCount;
+    } while (warm < minimalDuration);
+    print("classification.warm", callstackCount, 1, operations, warm);
+    sink = users;
+}
+}
+
+int main(int argc, char** argv) {
+    // The allocations of the benchmarks themselves are not tracked.
+    lsan::LSan::finished = true;
+
+    std::vector<std::size_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        if (auto size = std::strtoull(argv[i], nullptr, 10); size > 0) {
+            sizes.push_back(size);
+        }
+    }
+    if (sizes.empty()) {
+        sizes = { 1000, 10000, 100000, 1000000 };
+    }
+
+    const lsan::MallocInfo prototype(nullptr, 64);
+    for (const auto& size : sizes) {
+        const auto& keys = makeKeys(size);
+        benchRegistry<std::size_t>("keys", keys, 64);
+        benchRegistry("records", keys, prototype);
+        benchTracker(keys, prototype);
+        benchPresence(keys);
+
+        benchPool("pool.lifo", size, [](auto& objects) { std::reverse(objects.begin(), objects.end()); });
+        benchPool("pool.fifo", size, [](auto&) {});
+        benchPool("pool.random", size, [size](auto& objects) { std::shuffle(objects.begin(), objects.end(), std::mt19937_64(size)); });
+        benchPoolChurn(size);
+    }
+
+    const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= 2 * hardware; threads *= 2) {
+        benchStats(threads, 1000000);
+    }
+    benchClassification();
+}
@@ -0,0 +1,184 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef lsan_dump_h
+#define lsan_dump_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * The heap dump consists of fixed-size records, so it can be used directly after
+ * mapping it into memory. All values are stored in the byte order of the dumped
+ * process, every section starts at an offset aligned to eight bytes:
+ *
+ *  - the header,
+ *  - the contents of the blocks, if included,
+ *  - the blocks, sorted by their address,
+ *  - the callstacks of the blocks,
+ *  - the frames of the callstacks,
+ *  - the loaded modules,
+ *  - the string table containing the names of the frames and modules.
+ */
+
+/** The magic bytes at the beginning of a heap dump. */
+#define LSAN_DUMP_MAGIC   "LSANHEAP"
+/** The version of the heap dump format.              */
+#define LSAN_DUMP_VERSION 1
+
+/** The flag indicating that the contents of the blocks are included. */
+#define LSAN_DUMP_CONTENTS 0x1
+
+/**
+ * @brief The header of a heap dump.
+ *
+ * @since 1.11
+ */
+struct __lsan_dumpHeader {
+    /** The magic bytes `LSAN_DUMP_MAGIC`.                     */
+    char magic[8];
+    /** The version of the format.                             */
+    uint32_t version;
+    /** The flags of the dump.                                 */
+    uint32_t flags;
+    /** The timestamp of the dump in ticks.                    */
+    uint64_t timestamp;
+    /** The amount of ticks per second.                        */
+    uint64_t ticksPerSecond;
+
+    /** The amount of blocks.                                  */
+    uint64_t blockCount;
+    /** The offset of the blocks in the file.                  */
+    uint64_t blockOffset;
+    /** The amount of callstacks.                              */
+    uint64_t stackCount;
+    /** The offset of the callstacks in the file.              */
+    uint64_t stackOffset;
+    /** The amount of frames.                                  */
+    uint64_t frameCount;
+    /** The offset of the frames in the file.                  */
+    uint64_t frameOffset;
+    /** The amount of modules.                                 */
+    uint64_t moduleCount;
+    /** The offset of the modules in the file.                 */
+    uint64_t moduleOffset;
+    /** The size of the string table in bytes.                 */
+    uint64_t stringsSize;
+    /** The offset of the string table in the file.            */
+    uint64_t stringsOffset;
+};
+
+/**
+ * @brief A live block of a heap dump.
+ *
+ * @since 1.11
+ */
+struct __lsan_dumpBlock {
+    /** The address of the block.                                        */
+    uint64_t address;
+    /** The requested size of the block.                                 */
+    uint64_t size;
+    /** The timestamp of the allocation in ticks.                        */
+    uint64_t timestamp;
+    /** The offset of the contents in the file or `UINT64_MAX`.          */
+    uint64_t contents;
+    /** The index of the callstack of the allocation.                    */
+    uint32_t stack;
+    /** The index of the allocating thread, as used for the heap flows. */
+    uint32_t thread;
+};
+
+/**
+ * @brief A callstack of a heap dump.
+ *
+ * @since 1.11
+ */
+struct __lsan_dumpStack {
+    /** The identifier of the callstack, as used by `__lsan_getTopSites`. */
+    uint64_t id;
+    /** The index of the first frame of the callstack.                    */
+    uint32_t firstFrame;
+    /** The amount of frames of the callstack.                            */
+    uint32_t frameCount;
+};
+
+/**
+ * @brief A frame of a callstack of a heap dump.
+ *
+ * @since 1.11
+ */
+struct __lsan_dumpFrame {
+    /** The return address.                                       */
+    uint64_t address;
+    /** The offset of the name of the frame in the string table. */
+    uint64_t name;
+};
+
+/**
+ * @brief A loaded module of a heap dump.
+ *
+ * @since 1.11
+ */
+struct __lsan_dumpModule {
+    /** The lowest loaded address of the module.                   */
+    uint64_t begin;
+    /** The end of the highest loaded segment of the module.       */
+    uint64_t end;
+    /** The offset of the path of the module in the string table. */
+    uint64_t name;
+};
+
+/**
+ * @brief Writes all live allocations to the file at the given path.
+ *
+ * The callstacks of the allocations are translated. The dump can be analyzed using the
+ * tool `lsan-heap`. If the contents are included, the pointers between the blocks can be
+ * analyzed as well.
+ *
+ * @param path the path of the file to be written
+ * @param contents whether to include the contents of the blocks
+ * @return whether the dump was written successfully
+ * @since 1.11
+ */
+bool __lsan_dumpHeapWithContents(const char* path, bool contents);
+
+/**
+ * @brief Writes all live allocations to the file at the given path.
+ *
+ * The contents of the blocks are not included.
+ *
+ * @param path the path of the file to be written
+ * @return whether the dump was written successfully
+ * @since 1.11
+ */
+static inline bool __lsan_dumpHeap(const char* path) {
+    return __lsan_dumpHeapWithContents(path, false);
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* lsan_dump_h */
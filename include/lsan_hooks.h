@@ -0,0 +1,83 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef lsan_hooks_h
+#define lsan_hooks_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The allocation operations delivered to the allocation hook.
+ *
+ * @since 1.11
+ */
+enum __lsan_allocationOp {
+    __lsan_opMalloc,
+    __lsan_opCalloc,
+    __lsan_opRealloc,
+    __lsan_opFree,
+    __lsan_opMemalign
+};
+
+/**
+ * @brief The type of the allocation hook.
+ *
+ * The stack identifier of an allocation is the one of its allocation record, as used by
+ * `__lsan_getTopSites`, the heap dumps and the probes. For deallocations and for blocks
+ * below `LSAN_MIN_TRACKED_SIZE`, it is the one of the callstack of the operation.
+ *
+ * @param pointer the allocated or deallocated block
+ * @param size the requested size or zero for deallocations
+ * @param op the allocation operation
+ * @param stackId the identifier of the callstack of the operation
+ * @param context the context given when setting the hook
+ * @since 1.11
+ */
+typedef void (*__lsan_allocationHook)(const void* pointer, size_t size, enum __lsan_allocationOp op,
+                                      uint64_t stackId, void* context);
+
+/**
+ * @brief Sets the hook called for sampled allocation events.
+ *
+ * Every `sampleRate`-th allocation of every thread is sampled, the deallocation of a
+ * sampled block is delivered as well. The hook is called by the allocating or deallocating
+ * thread, the allocations made inside of the hook are neither tracked nor delivered. Passing
+ * `NULL` as callback removes the hook; once this function returns, the previous hook is no
+ * longer called. It may be called from inside of the hook, then only the call in progress
+ * of the previous hook continues.
+ *
+ * @param callback the hook to be called or `NULL`
+ * @param sampleRate the amount of allocations per sampled allocation
+ * @param context the context passed to the hook
+ * @since 1.11
+ */
+void __lsan_setAllocationHook(__lsan_allocationHook callback, size_t sampleRate, void* context);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* lsan_hooks_h */
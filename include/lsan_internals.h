@@ -183,11 +183,81 @@ extern bool __lsan_printFunctions;
  */
 extern bool __lsan_relativePaths;
 
+/**
+ * @brief If this value is set to `true`, the usable sizes of the allocations are
+ * recorded in order to report the memory wasted by the rounding of the allocator.
+ *
+ * Activates the statistical bookkeeping. Should be set at the very beginning of
+ * the program in order to get realistic results.
+ * Defaults to `false`.
+ *
+ * @since 1.11
+ */
+extern bool __lsan_trackSlack;
+
+/**
+ * @brief If this value is set to `true`, the recent allocation events of every
+ * thread are recorded and printed when the program crashes.
+ *
+ * Threads that have already recorded events keep recording them.
+ * Defaults to `true`.
+ *
+ * @since 1.11
+ */
+extern bool __lsan_flightRecorder;
+
+/**
+ * @brief The amount of the most recent allocation events printed for every thread
+ * except the crashed one when the program crashes.
+ *
+ * All recorded events of the crashed thread are printed.
+ * Defaults to `16`.
+ *
+ * @since 1.11
+ */
+extern size_t __lsan_recorderEvents;
+
+/**
+ * @brief If this value is set to `true`, the live heap is attributed to the NUMA
+ * nodes it is physically placed on.
+ *
+ * Activates the statistical bookkeeping. Should be set at the very beginning of
+ * the program in order to get realistic results. On systems without NUMA
+ * support, everything is attributed to a single node.
+ * Defaults to `false`.
+ *
+ * @since 1.11
+ */
+extern bool __lsan_numaStats;
+
+/**
+ * @brief If this value is set to `true`, the leaks whose callstacks go through a
+ * module are reported when the module is unloaded using `dlclose`.
+ *
+ * The leaks are only reported once the last reference to the module has been
+ * closed. The callstacks going through the closed module are translated in any case.
+ * Defaults to `false`.
+ *
+ * @since 1.11
+ */
+extern bool __lsan_reportOnUnload;
+
+/**
+ * @brief If this value is set to `true`, the live heap is printed by the C++ dynamic
+ * type of the blocks upon exit.
+ *
+ * The dynamic type of polymorphic objects is found using their virtual table pointer.
+ * Defaults to `false`.
+ *
+ * @since 1.11
+ */
+extern bool __lsan_typeStats;
+
 /**
  * @brief This value defines the count of leaks that are printed at the exit of the program.
  *
- * If more leaks are detected, the first leaks are printed and a message about the truncation
- * is also printed.
+ * If more leaks are detected, the first leaks in the order defined by `__lsan_leakOrder` are
+ * printed and a message about the truncation is also printed.
  * Defaults to `100`.
  *
  * @since 1.3
@@ -216,6 +286,30 @@ extern size_t __lsan_callstackSize;
  */
 extern size_t __lsan_firstPartyThreshold;
 
+/**
+ * @brief This value defines the average amount of allocations per allocation
+ * served from the guarded pool.
+ *
+ * The blocks of the guarded pool are surrounded by inaccessible pages and are
+ * made inaccessible when deallocated, so overflows and accesses after `free`
+ * are reported together with the allocation and deallocation callstacks.
+ * Only allocations of up to the size of a page made by `malloc` and `calloc`
+ * are sampled. Defaults to `0`, which deactivates the sampling.
+ *
+ * @since 1.11
+ */
+extern size_t __lsan_guardedSampleRate;
+
+/**
+ * @brief This value defines the amount of pages in the guarded pool.
+ *
+ * It is only read once, when the first allocation is sampled.
+ * Defaults to `64`.
+ *
+ * @since 1.11
+ */
+extern size_t __lsan_guardedPoolSize;
+
 /**
  * @brief This string defines the regex pattern for which binary file
  * names are considered to be first party.
@@ -227,6 +321,20 @@ extern size_t __lsan_firstPartyThreshold;
  */
 extern const char * __lsan_firstPartyRegex;
 
+/**
+ * @brief This string defines the key the leaks printed at the exit of the program are ordered by.
+ *
+ * The following keys are available:
+ * - `size`: the biggest leaks first
+ * - `age`: the oldest leaks first
+ * - `count`: the leaks of the allocation sites with the most leaks first
+ *
+ * Defaults to `"size"`.
+ *
+ * @since 1.11
+ */
+extern const char * __lsan_leakOrder;
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
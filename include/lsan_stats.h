@@ -32,6 +32,7 @@ extern "C" {
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
  * @deprecated Since v1.7 this option is no longer supported. Will be removed in v2.
@@ -281,6 +282,290 @@ static inline void __lsan_printStats() {
     __lsan_printStatsWithWidth(100);
 }
 
+/**
+ * @brief Returns the total amount of bytes the allocator reserved in excess of the requested sizes.
+ *
+ * Only allocations whose usable size was recorded using `__lsan_trackSlack` are considered.
+ *
+ * @return The total amount of wasted bytes.
+ * @since 1.11
+ */
+size_t __lsan_getSlackBytes();
+
+/**
+ * @brief Prints the memory wasted by the rounding of the allocator.
+ *
+ * The allocation sites are ranked by their wasted bytes, the given amount of sites is printed
+ * together with suggested request sizes. The output stream defined by `__lsan_printCout` is
+ * used for the printing. The byte amounts are printed human readable if `__lsan_humanPrint` is set to true.
+ * This function already checks for the availability of the slack statistics using
+ * `__lsan_trackSlack`, and guarantees to not crash the program, even in the case the
+ * slack statistics are unavailable.
+ *
+ * @param count The maximum amount of allocation sites to be printed.
+ * @since 1.11
+ */
+void __lsan_printSlackStatsWithCount(size_t count);
+
+/**
+ * @brief Prints the memory wasted by the rounding of the allocator.
+ *
+ * The ten allocation sites wasting the most bytes are printed, the amount can be adjusted by
+ * using `__lsan_printSlackStatsWithCount(size_t)`.
+ * The output stream defined by `__lsan_printCout` is used for the printing. The byte amounts
+ * are printed human readable if `__lsan_humanPrint` is set to true.
+ * This function already checks for the availability of the slack statistics using
+ * `__lsan_trackSlack`, and guarantees to not crash the program, even in the case the
+ * slack statistics are unavailable.
+ *
+ * @since 1.11
+ */
+static inline void __lsan_printSlackStats() {
+    __lsan_printSlackStatsWithCount(10);
+}
+
+/**
+ * @brief This structure contains the estimated allocations of an allocation site.
+ *
+ * @since 1.11
+ */
+struct __lsan_site {
+    /** The identifier of the callstack of the allocation site. */
+    uint64_t stackId;
+    /** The estimated amount of allocations.                    */
+    size_t count;
+    /** The estimated amount of allocated bytes.                */
+    size_t bytes;
+};
+
+/**
+ * @brief Stores the allocation sites with the most allocations into the given array.
+ *
+ * The allocation sites are estimated using a sketch of a fixed size: the estimates are
+ * never lower than the actual values, at most 16 sites are available. Only available
+ * while the statistical bookkeeping is active.
+ *
+ * @param k The maximum amount of allocation sites to be stored.
+ * @param sites The array to store the allocation sites in, sorted by their allocation count.
+ * @return The amount of stored allocation sites.
+ * @since 1.11
+ */
+size_t __lsan_getTopSites(size_t k, struct __lsan_site* sites);
+
+/**
+ * @brief Stores the allocation sites with the most allocated bytes into the given array.
+ *
+ * The allocation sites are estimated using a sketch of a fixed size: the estimates are
+ * never lower than the actual values, at most 16 sites are available. Only available
+ * while the statistical bookkeeping is active.
+ *
+ * @param k The maximum amount of allocation sites to be stored.
+ * @param sites The array to store the allocation sites in, sorted by their allocated bytes.
+ * @return The amount of stored allocation sites.
+ * @since 1.11
+ */
+size_t __lsan_getTopSitesByBytes(size_t k, struct __lsan_site* sites);
+
+/**
+ * @brief This structure contains the blocks of one thread deallocated by another thread.
+ *
+ * The threads are identified by an index assigned on their first allocation, starting at `0`.
+ * The index of an exited thread is reused by the next new thread.
+ *
+ * @since 1.11
+ */
+struct __lsan_threadFlow {
+    /** The identifier of the allocating thread.   */
+    size_t allocatingThread;
+    /** The identifier of the deallocating thread. */
+    size_t deallocatingThread;
+    /** The name of the allocating thread.         */
+    char allocatingName[16];
+    /** The name of the deallocating thread.       */
+    char deallocatingName[16];
+    /** The amount of deallocated blocks.          */
+    size_t count;
+    /** The amount of deallocated bytes.           */
+    size_t bytes;
+};
+
+/**
+ * @brief Stores the heaviest heap flows between threads into the given array.
+ *
+ * A heap flow consists of the blocks allocated by one thread and deallocated by another
+ * one. The first 63 threads are distinguished as allocating threads, the blocks of the
+ * remaining ones are counted for the identifier `63`. Only available while the statistical
+ * bookkeeping is active.
+ *
+ * @param k The maximum amount of heap flows to be stored.
+ * @param flows The array to store the heap flows in, sorted by their bytes.
+ * @return The amount of stored heap flows.
+ * @since 1.11
+ */
+size_t __lsan_getThreadFlows(size_t k, struct __lsan_threadFlow* flows);
+
+/**
+ * @brief Returns the amount of bytes allocated by the calling thread.
+ *
+ * The usable sizes of the blocks as reported by the allocator are counted. The counters
+ * of the calling thread are read without locking and are available regardless of the
+ * statistical bookkeeping.
+ *
+ * @return the amount of bytes allocated by the calling thread
+ * @since 1.11
+ */
+size_t __lsan_threadAllocatedBytes(void);
+
+/**
+ * @brief Returns the amount of bytes deallocated by the calling thread.
+ *
+ * The usable sizes of the blocks as reported by the allocator are counted.
+ *
+ * @return the amount of bytes deallocated by the calling thread
+ * @since 1.11
+ */
+size_t __lsan_threadFreedBytes(void);
+
+/**
+ * Returns the amount of allocations made by the calling thread.
+ *
+ * @return the amount of allocations of the calling thread
+ * @since 1.11
+ */
+size_t __lsan_threadAllocationCount(void);
+
+/**
+ * Returns the amount of deallocations made by the calling thread.
+ *
+ * @return the amount of deallocations of the calling thread
+ * @since 1.11
+ */
+size_t __lsan_threadFreeCount(void);
+
+/**
+ * @brief Prints the NUMA nodes the live heap is physically placed on.
+ *
+ * The live bytes are printed per node and per allocating node, the given amount of
+ * allocation sites is printed with their node distribution. The allocation sites
+ * whose blocks are mostly deallocated by threads running on another node are
+ * printed as well. The output stream defined by `__lsan_printCout` is used for
+ * the printing. The byte amounts are printed human readable if `__lsan_humanPrint`
+ * is set to true.
+ * This function already checks for the availability of the NUMA statistics using
+ * `__lsan_numaStats`, and guarantees to not crash the program, even in the case the
+ * NUMA statistics are unavailable.
+ *
+ * @param count The maximum amount of allocation sites to be printed.
+ * @since 1.11
+ */
+void __lsan_printNumaStatsWithCount(size_t count);
+
+/**
+ * @brief Prints the NUMA nodes the live heap is physically placed on.
+ *
+ * The ten allocation sites with the most live bytes are printed, the amount can be adjusted
+ * by using `__lsan_printNumaStatsWithCount(size_t)`.
+ * The output stream defined by `__lsan_printCout` is used for the printing. The byte amounts
+ * are printed human readable if `__lsan_humanPrint` is set to true.
+ * This function already checks for the availability of the NUMA statistics using
+ * `__lsan_numaStats`, and guarantees to not crash the program, even in the case the
+ * NUMA statistics are unavailable.
+ *
+ * @since 1.11
+ */
+static inline void __lsan_printNumaStats() {
+    __lsan_printNumaStatsWithCount(10);
+}
+
+/**
+ * @brief Prints the live heap by the C++ dynamic type of its blocks.
+ *
+ * The first word of every live block is looked up in the virtual tables of the
+ * loaded modules. The given amount of types with the most bytes is printed with
+ * their amount of blocks and bytes. The output stream defined by `__lsan_printCout`
+ * is used for the printing. The byte amounts are printed human readable if
+ * `__lsan_humanPrint` is set to true.
+ * This function does not depend on the statistical bookkeeping.
+ *
+ * @param count The maximum amount of types to be printed.
+ * @since 1.11
+ */
+void __lsan_printTypeStatsWithCount(size_t count);
+
+/**
+ * @brief Prints the live heap by the C++ dynamic type of its blocks.
+ *
+ * The ten types with the most bytes are printed, the amount can be adjusted by using
+ * `__lsan_printTypeStatsWithCount(size_t)`.
+ * The output stream defined by `__lsan_printCout` is used for the printing. The byte amounts
+ * are printed human readable if `__lsan_humanPrint` is set to true.
+ *
+ * @since 1.11
+ */
+static inline void __lsan_printTypeStats() {
+    __lsan_printTypeStatsWithCount(10);
+}
+
+/**
+ * @brief Prints the memory duplicated by copy-on-write in this forked process.
+ *
+ * The pages shared with the parent process that have been copied since the fork
+ * are attributed to the live blocks on them, the given amount of allocation sites
+ * with the most duplicated bytes is printed. The output stream defined by
+ * `__lsan_printCout` is used for the printing. The byte amounts are printed human
+ * readable if `__lsan_humanPrint` is set to true.
+ * This function already checks whether the copy-on-write breakage is scanned in
+ * this process, and guarantees to not crash the program, even in the case it is not.
+ *
+ * @param count The maximum amount of allocation sites to be printed.
+ * @since 1.11
+ */
+void __lsan_printCowStatsWithCount(size_t count);
+
+/**
+ * @brief Prints the memory duplicated by copy-on-write in this forked process.
+ *
+ * The ten allocation sites with the most duplicated bytes are printed, the amount can be
+ * adjusted by using `__lsan_printCowStatsWithCount(size_t)`.
+ * The output stream defined by `__lsan_printCout` is used for the printing. The byte amounts
+ * are printed human readable if `__lsan_humanPrint` is set to true.
+ * This function already checks whether the copy-on-write breakage is scanned in this
+ * process, and guarantees to not crash the program, even in the case it is not.
+ *
+ * @since 1.11
+ */
+static inline void __lsan_printCowStats() {
+    __lsan_printCowStatsWithCount(10);
+}
+
+/**
+ * @brief Prints the cache lines potentially falsely shared by heap blocks of different threads.
+ *
+ * The live blocks are sorted by their address. Every cache line holding blocks allocated
+ * by different threads is counted for the pairs of allocation sites of these blocks, the
+ * given amount of pairs with the most shared cache lines is printed. The blocks are
+ * attributed to the thread that allocated them, also after it has exited.
+ * The output stream defined by `__lsan_printCout` is used for the printing.
+ * This function does not depend on the statistical bookkeeping.
+ *
+ * @param count The maximum amount of allocation site pairs to be printed.
+ * @since 1.11
+ */
+void __lsan_printFalseSharingWithCount(size_t count);
+
+/**
+ * @brief Prints the cache lines potentially falsely shared by heap blocks of different threads.
+ *
+ * The ten pairs of allocation sites with the most shared cache lines are printed, the amount
+ * can be adjusted by using `__lsan_printFalseSharingWithCount(size_t)`.
+ * The output stream defined by `__lsan_printCout` is used for the printing.
+ *
+ * @since 1.11
+ */
+static inline void __lsan_printFalseSharing() {
+    __lsan_printFalseSharingWithCount(10);
+}
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -22,6 +22,7 @@
 #ifndef ATracker_hpp
 #define ATracker_hpp
 
+#include <deque>
 #include <map>
 #include <mutex>
 #include <optional>
@@ -32,6 +33,9 @@
 #include "MallocInfo.hpp"
 
 #include "allocators/PoolAllocator.hpp"
+#include "allocators/RealAllocator.hpp"
+#include "presence/presence.hpp"
+#include "reclamation/epoch.hpp"
 
 namespace lsan {
 /**
@@ -50,23 +54,112 @@ protected:
     PoolMap<const void* const, MallocInfo> infos;
     /** The mutex to manage the access to the registered allocations. */
     std::mutex infoMutex;
+    /** A retired allocation record along with its retirement epoch.  */
+    using Retired = std::pair<epoch::Epoch, decltype(infos)::node_type>;
+    /** The retired allocation records, guarded by the info mutex.     */
+    std::deque<Retired, RealAllocator<Retired>> retired;
+
+    /**
+     * @brief Retires the given allocation record.
+     *
+     * The record stays valid until no thread can still reference it.
+     * The info mutex needs to be locked.
+     *
+     * @param node the node of the allocation record to be retired
+     */
+    inline void retire(decltype(infos)::node_type&& node) {
+        const auto epoch = epoch::current();
+        retired.emplace_back(epoch, std::move(node));
+        reclaim();
+    }
+
+    /**
+     * @brief Removes the given allocation record from the registered allocations and retires it.
+     *
+     * The info mutex needs to be locked.
+     *
+     * @param it the iterator pointing to the allocation record to be retired
+     * @return the iterator following the retired allocation record
+     */
+    inline auto retire(decltype(infos)::iterator it) -> decltype(infos)::iterator {
+        const auto next = std::next(it);
+        retire(infos.extract(it));
+        return next;
+    }
+
+    /**
+     * @brief Destroys the retired allocation records no thread can reference anymore.
+     *
+     * The info mutex needs to be locked.
+     */
+    inline void reclaim() {
+        while (!retired.empty() && epoch::isReclaimable(retired.front().first)) {
+            retired.pop_front();
+        }
+    }
+
+    /**
+     * @brief Waits until all retired allocation records can be destroyed and destroys them.
+     *
+     * The given lock of the info mutex is released while waiting, as the
+     * threads still referencing the records might need it to leave their
+     * critical sections.
+     *
+     * @param lock the held lock of the info mutex
+     */
+    inline void reclaimAll(std::unique_lock<std::mutex>& lock) {
+        while (!retired.empty()) {
+            auto toReclaim = std::move(retired);
+            retired.clear();
+            lock.unlock();
+            epoch::synchronize(toReclaim.back().first);
+            lock.lock();
+            toReclaim.clear();
+        }
+    }
+
+    /**
+     * @brief Registers the given allocation record, replacing a possibly existing one.
+     *
+     * An already deallocated record for the same pointer is retired, as it might
+     * still be referenced. The pointer is marked in the presence filter. The
+     * info mutex needs to be locked.
+     *
+     * @param info the allocation record to be registered
+     */
+    inline void insert(MallocInfo&& info) {
+        presence::add(info.pointer);
+        const auto& it = infos.find(info.pointer);
+        if (it != infos.end() && it->second.deleted) {
+            retire(it);
+        }
+        infos.insert_or_assign(info.pointer, std::move(info));
+    }
 
     /**
      * Helper function to potentially add the given allocation record
-     * to the statistics.
+     * to the statistics. The usable size of the record may be recorded.
+     * Called before the info mutex is locked.
      *
      * @param info the allocation record
      */
-    virtual inline void maybeAddToStats([[ maybe_unused ]] const MallocInfo& info) {}
+    virtual inline void maybeAddToStats([[ maybe_unused ]] MallocInfo& info) {}
 
 public:
     virtual ~ATracker() = default;
 
-    /** Indicates whether allocations should be ignored.                 */
+    /**
+     * Returns the mutex for the memory allocation infos.
+     *
+     * @return the mutex
+     */
+    constexpr inline auto getInfoMutex() -> std::mutex & {
+        return infoMutex;
+    }
+
+    /** Indicates whether allocations should be ignored. */
     bool ignoreMalloc = false;
-    /** Indicates whether this tracker instance needs to be deallocated. */
-    bool needsDealloc = false;
-    /** The mutex to guard allocations in this thread.                   */
+    /** The mutex to guard allocations in this thread.   */
     std::recursive_mutex mutex;
 
     /**
@@ -75,19 +168,23 @@ public:
      * @param info the allocation record to be registered
      */
     inline void addMalloc(MallocInfo&& info) {
-        std::lock_guard lock { infoMutex };
-        
         maybeAddToStats(info);
-        infos.insert_or_assign(info.pointer, std::move(info));
+
+        std::lock_guard lock { infoMutex };
+        insert(std::move(info));
     }
 
     /**
-     * Attempts to remove the allocation record for the given pointer.
+     * @brief Attempts to remove the allocation record for the given pointer.
+     *
+     * A returned record is only guaranteed to stay valid while the calling
+     * thread is inside of an `epoch::Guard`.
      *
      * @param pointer the pointer of the actual allocation
+     * @param reused whether the block may already have been reused, keeping it marked in the presence filter
      * @return whether the allocation record was removed and the potentially found existing record
      */
-    virtual auto removeMalloc(void* pointer) -> std::pair<bool, std::optional<MallocInfo::CRef>> = 0;
+    virtual auto removeMalloc(void* pointer, bool reused = false) -> std::pair<bool, std::optional<MallocInfo::CRef>> = 0;
 
     /**
      * Changes the allocation record already registered to the given one.
@@ -108,9 +205,10 @@ public:
      * Does not call out to the global instance.
      *
      * @param pointer the pointer whose allocation record to be removed
+     * @param reused whether the block may already have been reused, keeping it marked in the presence filter
      * @return whether the record was removed and the potentially already as deleted marked record 
      */
-    virtual auto maybeRemoveMalloc(void* pointer) -> std::pair<bool, std::optional<MallocInfo::CRef>> = 0;
+    virtual auto maybeRemoveMalloc(void* pointer, bool reused = false) -> std::pair<bool, std::optional<MallocInfo::CRef>> = 0;
 
     /**
      * @brief Changes the allocation record already registered to the given one.
@@ -123,6 +221,22 @@ public:
     virtual auto maybeChangeMalloc([[ maybe_unused ]] const MallocInfo& info) -> bool {
         return false;
     }
+
+    /**
+     * @brief Calls the given function with every registered allocation record.
+     *
+     * The info mutex is locked while the function is called.
+     *
+     * @param function the function to be called
+     */
+    template<typename F>
+    inline void forEachRecord(F&& function) {
+        std::lock_guard lock { infoMutex };
+
+        for (auto& [_, info] : infos) {
+            function(info);
+        }
+    }
 };
 }
 
@@ -20,6 +20,10 @@
  */
 
 #include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
 
 #include <lsan_internals.h>
 
@@ -32,13 +36,16 @@
 #include "lsanMisc.hpp"
 #include "TLSTracker.hpp"
 #include "callstacks/callstackHelper.hpp"
+#include "cow/cow.hpp"
 #include "crashWarner/exceptionHandler.hpp"
+#include "flow/flow.hpp"
+#include "probes/probes.hpp"
 #include "signals/signals.hpp"
 #include "signals/signalHandlers.hpp"
 
 namespace lsan {
 std::atomic_bool LSan::finished = false;
-std::atomic_bool LSan::preventDealloc = false;
+thread_local bool LSan::threadExiting = false;
 
 auto LSan::generateRegex(const char * regex) -> std::optional<std::regex> {
     if (regex == nullptr || *regex == '\0') {
@@ -54,25 +61,19 @@ auto LSan::generateRegex(const char * regex) -> std::optional<std::regex> {
 }
 
 /**
- * If the given pointer is a TLSTracker, it is deleted and the thread-local
- * value is set to point to the global tracker instance.
+ * If the given pointer is a TLSTracker, it is released for reuse and the
+ * thread-local value is set to point to the global tracker instance. The
+ * allocations done while the thread is torn down are tracked by the global
+ * tracker instance.
  *
  * @param value the thread-local value
  */
 static inline void destroySaniKey(void* value) {
     auto& globalInstance = getInstance();
     if (value != std::addressof(globalInstance)) {
+        LSan::threadExiting = true;
         pthread_setspecific(globalInstance.saniKey, std::addressof(globalInstance));
-        auto tracker = static_cast<TLSTracker*>(value);
-        if (!globalInstance.preventDealloc) {
-            std::lock_guard lock(globalInstance.mutex);
-            auto ignore = globalInstance.ignoreMalloc;
-            globalInstance.ignoreMalloc = true;
-            delete tracker;
-            globalInstance.ignoreMalloc = ignore;
-        } else {
-            tracker->needsDealloc = true;
-        }
+        static_cast<TLSTracker*>(value)->release();
     }
 }
 
@@ -121,55 +122,45 @@ LSan::LSan(): saniKey(createSaniKey()) {
 #endif
 
     std::set_terminate(exceptionHandler);
+
+    if (behaviour.cowScan()) {
+        cow::registerHandlers();
+    }
 }
 
 LSan::~LSan() {
-    for (auto tracker : tlsTrackers) {
-        if (tracker->needsDealloc) {
+    for (auto tracker = tlsTrackers.load(std::memory_order_acquire); tracker != nullptr;) {
+        const auto next = tracker->getNext();
+        if (!tracker->isInUse()) {
             delete tracker;
         }
+        tracker = next;
     }
-    preventDealloc = false;
-}
-
-auto LSan::copyTrackerList() -> decltype(tlsTrackers) {
-    std::lock_guard lock { tlsTrackerMutex };
-
-    return tlsTrackers;
 }
 
 void LSan::finish() {
-    preventDealloc = true;
     finished = true;
     {
         std::lock_guard lock { mutex };
         ignoreMalloc = true;
     }
 
-    auto trackers = copyTrackerList();
-    for (auto tracker : trackers) {
+    for (auto tracker = tlsTrackers.load(std::memory_order_acquire); tracker != nullptr; tracker = tracker->getNext()) {
         tracker->finish();
     }
 }
 
-void LSan::registerTracker(ATracker* tracker) {
-    std::lock_guard lock1 { mutex };
-    std::lock_guard lock { tlsTrackerMutex };
-
-    auto ignore = ignoreMalloc;
-    ignoreMalloc = true;
-    tlsTrackers.insert(tracker);
-    ignoreMalloc = ignore;
-}
-
-void LSan::deregisterTracker(ATracker* tracker) {
-    std::lock_guard lock1 { mutex };
-    std::lock_guard lock { tlsTrackerMutex };
-
-    auto ignore = ignoreMalloc;
-    ignoreMalloc = true;
-    tlsTrackers.erase(tracker);
-    ignoreMalloc = ignore;
+auto LSan::acquireTracker() -> TLSTracker& {
+    auto head = tlsTrackers.load(std::memory_order_acquire);
+    for (auto tracker = head; tracker != nullptr; tracker = tracker->getNext()) {
+        if (tracker->tryAcquire()) {
+            return *tracker;
+        }
+    }
+    auto tracker = new TLSTracker();
+    tracker->next = head;
+    while (!tlsTrackers.compare_exchange_weak(tracker->next, tracker, std::memory_order_release, std::memory_order_relaxed));
+    return *tracker;
 }
 
 void LSan::absorbLeaks(PoolMap<const void *const, MallocInfo>&& leaks) {
@@ -180,19 +171,23 @@ void LSan::absorbLeaks(PoolMap<const void *const, MallocInfo>&& leaks) {
     ignoreMalloc = true;
     infos.get_allocator().merge(leaks.get_allocator());
     infos.merge(std::move(leaks));
+    // The records left over replace the stale ones, which might still be referenced.
+    while (!leaks.empty()) {
+        auto node = leaks.extract(leaks.begin());
+        retire(infos.find(node.key()));
+        infos.insert(std::move(node));
+    }
     ignoreMalloc = ignore;
 }
 
-// FIXME: Though unlikely, the invalidly freed record ref can become invalid throughout this process
-auto LSan::removeMalloc(ATracker* tracker, void* pointer) -> std::pair<bool, std::optional<MallocInfo::CRef>> {
-    const auto& result = maybeRemoveMalloc(pointer);
+auto LSan::removeMalloc(ATracker* tracker, void* pointer, bool reused) -> std::pair<bool, std::optional<MallocInfo::CRef>> {
+    const auto& result = maybeRemoveMalloc(pointer, reused);
     std::pair<bool, std::optional<MallocInfo::CRef>> tmp { false, std::nullopt };
     if (!result.first) {
-        std::lock_guard lock { tlsTrackerMutex };
-        for (auto element : tlsTrackers) {
+        for (auto element = tlsTrackers.load(std::memory_order_acquire); element != nullptr; element = element->getNext()) {
             if (element == tracker) continue;
 
-            const auto& result = element->maybeRemoveMalloc(pointer);
+            const auto& result = element->maybeRemoveMalloc(pointer, reused);
             if (result.first) {
                 return result;
             }
@@ -210,11 +205,14 @@ auto LSan::removeMalloc(ATracker* tracker, void* pointer) -> std::pair<bool, std
     return result;
 }
 
-auto LSan::removeMalloc(void* pointer) -> std::pair<bool, std::optional<MallocInfo::CRef>> {
-    return removeMalloc(nullptr, pointer);
+auto LSan::removeMalloc(void* pointer, bool reused) -> std::pair<bool, std::optional<MallocInfo::CRef>> {
+    if (!presence::mayContain(pointer)) {
+        return std::make_pair(false, std::nullopt);
+    }
+    return removeMalloc(nullptr, pointer, reused);
 }
 
-auto LSan::maybeRemoveMalloc(void* pointer) -> std::pair<bool, std::optional<MallocInfo::CRef>> {
+auto LSan::maybeRemoveMalloc(void* pointer, bool reused) -> std::pair<bool, std::optional<MallocInfo::CRef>> {
     std::lock_guard lock { infoMutex };
 
     const auto& it = infos.find(pointer);
@@ -226,22 +224,35 @@ auto LSan::maybeRemoveMalloc(void* pointer) -> std::pair<bool, std::optional<Mal
     }
     if (behaviour.statsActive()) {
         stats -= it->second;
+        if (behaviour.numaStats() && numa::sampleFree()) {
+            stats.addNumaFree(it->second, numa::nodeOf(it->second.pointer), numa::currentNode());
+        }
+        const auto thread = flow::threadIndex();
+        if (it->second.thread != thread || it->second.threadGeneration != flow::threadGeneration()) {
+            flow::add(it->second.thread, it->second.threadGeneration, thread, flow::threadGeneration(), it->second.size);
+            stats.addRemoteFree(it->second);
+        }
     }
     if (behaviour.statsActive()) {
         it->second.markDeleted();
     } else {
         infos.erase(it);
+        if (!reused) {
+            presence::remove(pointer);
+        }
     }
     return std::make_pair(true, std::nullopt);
 }
 
 void LSan::changeMalloc(ATracker* tracker, MallocInfo&& info) {
+    if (behaviour.statsActive()) {
+        prepareForStats(info);
+    }
     std::lock_guard lock { infoMutex };
 
     const auto& it = infos.find(info.pointer);
     if (it == infos.end()) {
-        std::lock_guard tlsLock { tlsTrackerMutex };
-        for (auto element : tlsTrackers) {
+        for (auto element = tlsTrackers.load(std::memory_order_acquire); element != nullptr; element = element->getNext()) {
             if (element == tracker) continue;
 
             if (element->maybeChangeMalloc(info)) {
@@ -251,9 +262,9 @@ void LSan::changeMalloc(ATracker* tracker, MallocInfo&& info) {
         return;
     }
     if (behaviour.statsActive()) {
-        stats.replaceMalloc(it->second.size, info.size);
+        stats.replaceMalloc(it->second.size, info);
     }
-    infos.insert_or_assign(info.pointer, info);
+    insert(std::move(info));
 }
 
 void LSan::changeMalloc(MallocInfo&& info) {
@@ -346,38 +357,133 @@ static inline auto maybeShowDeprecationWarnings(std::ostream & out) -> std::ostr
     return out;
 }
 
+/**
+ * This enumeration contains the keys the printed leaks can be ordered by.
+ */
+enum class LeakOrder {
+    /** The biggest leaks first.                                  */
+    SIZE,
+    /** The oldest leaks first.                                   */
+    AGE,
+    /** The leaks of the sites with the most leaks first.         */
+    COUNT
+};
+
+/**
+ * Returns the leak order named by the given string.
+ *
+ * @param name the name of the leak order
+ * @return the named leak order or `std::nullopt` if the name is unknown
+ */
+static inline auto getLeakOrder(const char* name) -> std::optional<LeakOrder> {
+    if (name == nullptr || behaviour::lowerCompare(name, "size")) {
+        return LeakOrder::SIZE;
+    } else if (behaviour::lowerCompare(name, "age")) {
+        return LeakOrder::AGE;
+    } else if (behaviour::lowerCompare(name, "count")) {
+        return LeakOrder::COUNT;
+    }
+    return std::nullopt;
+}
+
+/**
+ * This structure represents a candidate leak to be printed.
+ */
+struct Leak {
+    /** The allocation record of the leak.                        */
+    const MallocInfo* info;
+    /** The identifier of the allocation site.                    */
+    std::uint64_t site;
+    /** The amount of leaks of the allocation site.               */
+    std::size_t siteCount;
+};
+
 auto operator<<(std::ostream& stream, LSan& self) -> std::ostream& {
     using formatter::Style;
     
     std::lock_guard lock(self.infoMutex);
 
+    const auto order = getLeakOrder(self.behaviour.leakOrder());
+    const auto key   = order.value_or(LeakOrder::SIZE);
+    const auto limit = self.behaviour.leakCount();
+
+    const auto ranksBefore = [key](const Leak& lhs, const Leak& rhs) {
+        switch (key) {
+            case LeakOrder::AGE:   return lhs.info->timestamp < rhs.info->timestamp;
+            case LeakOrder::COUNT:
+                if (lhs.siteCount != rhs.siteCount) return lhs.siteCount > rhs.siteCount;
+                if (lhs.site != rhs.site)           return lhs.site < rhs.site;
+                [[fallthrough]];
+
+            default: return lhs.info->size > rhs.info->size;
+        }
+    };
+    // The heap keeps the selected leaks with the one ranking last on top.
+    std::vector<Leak> leaks;
+    const auto select = [&](const Leak& leak) {
+        if (leaks.size() < limit) {
+            leaks.push_back(leak);
+            std::push_heap(leaks.begin(), leaks.end(), ranksBefore);
+        } else if (limit > 0 && ranksBefore(leak, leaks.front())) {
+            std::pop_heap(leaks.begin(), leaks.end(), ranksBefore);
+            leaks.back() = leak;
+            std::push_heap(leaks.begin(), leaks.end(), ranksBefore);
+        }
+    };
+
     callstack_autoClearCaches = false;
     std::size_t i     = 0,
                 j     = 0,
                 bytes = 0,
                 count = 0,
+                shown = SIZE_MAX,
                 total = self.infos.size();
+    std::vector<Leak> candidates;
+    std::unordered_map<std::uint64_t, std::size_t> sites;
     for (auto & [ptr, info] : self.infos) {
-        if (isATTY()) {
+        if (isATTY() && j * 10000 / total != shown) {
+            shown = j * 10000 / total;
             char buffer[7] {};
-            std::snprintf(buffer, 7, "%05.2f", static_cast<double>(j) / total * 100);
+            std::snprintf(buffer, 7, "%05.2f", static_cast<double>(shown) / 100);
             stream << "\rCollecting the leaks: " << formatter::format<Style::BOLD>(buffer) << " %";
         }
         if (!info.deleted && callstackHelper::getCallstackType(info.createdCallstack) == callstackHelper::CallstackType::USER) {
             ++count;
             bytes += info.size;
-            if (i < self.behaviour.leakCount()) {
-                if (isATTY()) {
-                    stream << "\r                                    \r";
-                }
-                stream << info << std::endl;
-                ++i;
+            LSAN_PROBE(leak, info.pointer, info.size, info.getStackId());
+            if (key == LeakOrder::COUNT) {
+                const auto site = info.getStackId();
+                ++sites[site];
+                candidates.push_back({ &info, site, 0 });
+            } else {
+                select({ &info, 0, 0 });
             }
         }
         ++j;
     }
+    for (auto& candidate : candidates) {
+        candidate.siteCount = sites[candidate.site];
+        select(candidate);
+    }
+    std::sort_heap(leaks.begin(), leaks.end(), ranksBefore);
     if (isATTY()) {
-        stream << "\r                                    \r";
+        stream << "\r                                    \r"
+               << "Translating the callstacks...";
+    }
+    {
+        std::vector<std::reference_wrapper<lcs::callstack>> callstacks;
+        callstacks.reserve(leaks.size());
+        for (const auto& leak : leaks) {
+            callstacks.push_back(leak.info->createdCallstack);
+        }
+        const callstackHelper::Translations translations { callstacks };
+        if (isATTY()) {
+            stream << "\r                                    \r";
+        }
+        for (const auto& leak : leaks) {
+            stream << *leak.info << std::endl;
+            ++i;
+        }
     }
     if (self.callstackSizeExceeded) {
         stream << printCallstackSizeExceeded;
@@ -398,6 +504,14 @@ auto operator<<(std::ostream& stream, LSan& self) -> std::ostream& {
         stream << std::endl << printWorkingDirectory;
     }
     stream << maybeShowDeprecationWarnings;
+    if (!order.has_value()) {
+        stream << std::endl << formatter::get<Style::RED>
+               << formatter::format<Style::BOLD>("LSAN_LEAK_ORDER") << " ("
+               << formatter::format<Style::ITALIC>("__lsan_leakOrder") << ") "
+               << formatter::format<Style::BOLD>("ignored: ")
+               << formatter::format<Style::ITALIC, Style::BOLD>("\"" + std::string(self.behaviour.leakOrder()) + "\"")
+               << formatter::clear<Style::RED> << std::endl;
+    }
     if (self.userRegexError.has_value()) {
         stream << std::endl << formatter::get<Style::RED>
                << formatter::format<Style::BOLD>("LSAN_FIRST_PARTY_REGEX") << " ("
@@ -28,7 +28,6 @@
 #include <optional>
 #include <ostream>
 #include <regex>
-#include <set>
 #include <utility>
 
 #include <pthread.h>
@@ -36,6 +35,7 @@
 
 #include "ATracker.hpp"
 #include "MallocInfo.hpp"
+#include "TLSTracker.hpp"
 
 #ifdef BENCHMARK
  #include "timing.hpp"
@@ -43,6 +43,7 @@
 
 #include "allocations/realAlloc.hpp"
 #include "behaviour/Behaviour.hpp"
+#include "numa/numa.hpp"
 #include "statistics/Stats.hpp"
 
 namespace lsan {
@@ -62,10 +63,8 @@ class LSan final: public ATracker {
     std::optional<std::optional<std::regex>> userRegex;
     /** The user regex error message.                                                   */
     std::optional<std::string> userRegexError;
-    /** The registered thread-local allocation trackers.                                */
-    std::set<ATracker*> tlsTrackers;
-    /** The mutex to manage the access to the registered thread-local trackers.         */
-    std::mutex tlsTrackerMutex;
+    /** The first one of the registered thread-local allocation trackers.               */
+    std::atomic<TLSTracker*> tlsTrackers = nullptr;
 
 #ifdef BENCHMARK
     /** The registered timings of the allocations.                                      */
@@ -84,13 +83,6 @@ class LSan final: public ATracker {
      */
     auto generateRegex(const char * regex) -> std::optional<std::regex>;
     
-    /**
-     * Creates a thread-safe copy of the thread-local tracker list.
-     *
-     * @return the copy
-     */
-    auto copyTrackerList() -> decltype(tlsTrackers);
-
     /**
      * Loads the user first party regular expression.
      */
@@ -98,9 +90,31 @@ class LSan final: public ATracker {
         userRegex = generateRegex(behaviour.firstPartyRegex());
     }
 
+    /**
+     * @brief Completes the given allocation record for the statistics.
+     *
+     * Computes the identifier of its callstack, so it is not hashed while
+     * any mutex is locked.
+     *
+     * @param info the allocation record
+     */
+    inline void prepareForStats(MallocInfo& info) {
+        // The usable size passed in by the allocation functions is only kept if the slack is tracked.
+        if (!behaviour.trackSlack()) {
+            info.usableSize = 0;
+        } else if (info.usableSize == 0) {
+            info.usableSize = real::malloc_usable_size(info.pointer);
+        }
+        if (behaviour.numaStats()) {
+            info.numaNode = numa::currentNode();
+        }
+        info.getStackId();
+    }
+
 protected:
-    virtual inline void maybeAddToStats(const MallocInfo& info) final override {
+    virtual inline void maybeAddToStats(MallocInfo& info) final override {
         if (behaviour.statsActive()) {
+            prepareForStats(info);
             stats += info;
         }
     }
@@ -108,8 +122,8 @@ protected:
 public:
     /** Indicates whether the allocation tracking has finished.                     */
     static std::atomic_bool finished;
-    /** Indicates whether to ignore deallocations in the TLS deallocator.           */
-    static std::atomic_bool preventDealloc;
+    /** Indicates whether the calling thread has released its tracker while exiting. */
+    static thread_local bool threadExiting __attribute__((tls_model("initial-exec")));
     /** The thread-local storage key used for the thread-local allocation trackers. */
     const pthread_key_t saniKey;
 
@@ -134,13 +148,15 @@ public:
      * @brief Attempts to remove the allocation record associated with the given pointer.
      *
      * If no record is found in this instance, all registered trackers except
-     * the given one are searched for the record.
+     * the given one are searched for the record. A returned record is only
+     * guaranteed to stay valid while the calling thread is inside of an `epoch::Guard`.
      *
      * @param tracker the tracker to not be searched
      * @param pointer the pointer to the allocation
+     * @param reused whether the block may already have been reused
      * @return whether a record was removed and the potentially existing record
      */
-    auto removeMalloc(ATracker* tracker, void* pointer) -> std::pair<bool, std::optional<MallocInfo::CRef>>;
+    auto removeMalloc(ATracker* tracker, void* pointer, bool reused) -> std::pair<bool, std::optional<MallocInfo::CRef>>;
 
     /**
      * @brief Replaces the allocation record with the given one.
@@ -154,18 +170,65 @@ public:
     void changeMalloc(ATracker* tracker, MallocInfo&& info);
 
     /**
-     * Registers the given allocation tracker.
+     * @brief Returns a thread-local allocation tracker for the calling thread.
+     *
+     * A released tracker is reused if available, otherwise a new one is
+     * registered. Does not lock.
+     *
+     * @return the acquired thread-local allocation tracker
+     */
+    auto acquireTracker() -> TLSTracker&;
+
+    /**
+     * Calls the given function with this instance and every registered thread-local
+     * allocation tracker.
+     *
+     * @param function the function to be called
+     */
+    template<typename F>
+    inline void forEachTracker(F&& function) {
+        function(static_cast<ATracker&>(*this));
+        for (auto element = tlsTrackers.load(std::memory_order_acquire); element != nullptr; element = element->getNext()) {
+            function(static_cast<ATracker&>(*element));
+        }
+    }
+
+    /**
+     * @brief Calls the given function with the allocation records of this instance and
+     * of every registered thread-local allocation tracker.
      *
-     * @param tracker the allocation tracker to be registered
+     * The info mutex of the respective tracker is locked while the function is called.
+     *
+     * @param function the function to be called
      */
-    void registerTracker(ATracker* tracker);
+    template<typename F>
+    inline void forEachRecordOfAllTrackers(F&& function) {
+        forEachTracker([&function](ATracker& tracker) {
+            tracker.forEachRecord(function);
+        });
+    }
 
     /**
-     * Deregisters the given allocation tracker.
+     * Counts an allocation below the minimal tracked size in the statistics.
      *
-     * @param tracker the allocation tracker to be deregistered
+     * @param size the requested size of the allocation
      */
-    void deregisterTracker(ATracker* tracker);
+    inline void addUntracked(std::size_t size) {
+        if (behaviour.statsActive()) {
+            stats.addMalloc(size);
+        }
+    }
+
+    /**
+     * Counts the deallocation of a block below the minimal tracked size in the statistics.
+     *
+     * @param size the requested size of the deallocated block
+     */
+    inline void removeUntracked(std::size_t size) {
+        if (behaviour.statsActive()) {
+            stats.addFree(size);
+        }
+    }
 
     /**
      * Absorbs the given allocation records.
@@ -214,15 +277,6 @@ public:
     constexpr inline auto getMutex() -> std::recursive_mutex & {
         return mutex;
     }
-    
-    /**
-     * Returns the mutex for the memory allocation infos.
-     *
-     * @return the mutex
-     */
-    constexpr inline auto getInfoMutex() -> std::mutex & {
-        return infoMutex;
-    }
 
     virtual void changeMalloc(MallocInfo&& info) final override;
 
@@ -230,9 +284,10 @@ public:
      * Removes the allocation record associated with the given pointer.
      *
      * @param pointer the allocation pointer
+     * @param reused whether the block may already have been reused
      * @return a pair with a boolean indicating the success and optionally the already deleted allocation record
      */
-    virtual auto removeMalloc(void* pointer) -> std::pair<bool, std::optional<MallocInfo::CRef>> final override;
+    virtual auto removeMalloc(void* pointer, bool reused) -> std::pair<bool, std::optional<MallocInfo::CRef>> final override;
 
     /**
      * @brief Attempts to remove the allocation record associated with the given pointer.
@@ -240,9 +295,10 @@ public:
      * Does not search in the thread-local trackers.
      *
      * @param pointer the allocation pointer
+     * @param reused whether the block may already have been reused
      * @return whether a record was removed and the potentially existing record
      */
-    virtual auto maybeRemoveMalloc(void* pointer) -> std::pair<bool, std::optional<MallocInfo::CRef>> final override;
+    virtual auto maybeRemoveMalloc(void* pointer, bool reused) -> std::pair<bool, std::optional<MallocInfo::CRef>> final override;
 
     /**
      * Calculates and returns the total count of allocated bytes that are stored inside the
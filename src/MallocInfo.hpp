@@ -23,6 +23,7 @@
 #define MallocInfo_hpp
 
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <optional>
 #include <ostream>
@@ -31,6 +32,9 @@
 #include <callstack.h>
 
 #include "callstacks/callstackHelper.hpp"
+#include "flow/flow.hpp"
+#include "governor/governor.hpp"
+#include "recorder/recorder.hpp"
 
 namespace lsan {
 /**
@@ -50,8 +54,20 @@ struct MallocInfo {
     void* pointer;
     /** The size of the allocated piece of memory.                */
     std::size_t size;
+    /** The usable size as reported by the allocator or zero.     */
+    std::size_t usableSize = 0;
+    /** The identifier of the allocation callstack, zero if not yet computed. */
+    mutable std::uint64_t stackId = 0;
+    /** The NUMA node of the allocating thread or `-1`.           */
+    int numaNode = -1;
     /** Indicating whether this allocation has been deallocated.  */
     bool deleted = false;
+    /** The index of the allocating thread.                       */
+    std::uint8_t thread;
+    /** The generation of the index of the allocating thread.     */
+    std::uint16_t threadGeneration;
+    /** The timestamp when this allocation happened in ticks.     */
+    std::uint64_t timestamp;
     /** The timestamp when this record was freed.                 */
     std::optional<std::chrono::system_clock::time_point> freeTimestamp;
     /** The callstack where this allocation happened.             */
@@ -64,17 +80,37 @@ struct MallocInfo {
      *
      * @param pointer the pointer to the allocated piece of memory
      * @param size the size of the allocated piece of memory
+     * @param usableSize the usable size as reported by the allocator or zero if not known
      */
-    inline MallocInfo(void* const pointer, const std::size_t size): pointer(pointer), size(size) {}
+    inline MallocInfo(void* const pointer, const std::size_t size, const std::size_t usableSize = 0):
+        pointer(pointer), size(size), usableSize(usableSize), thread(flow::threadIndex()), threadGeneration(flow::threadGeneration()), timestamp(recorder::timestamp()), createdCallstack(callstackHelper::capture()) {}
+
+    /**
+     * @brief Returns the identifier of the allocation callstack.
+     *
+     * It is computed on the first call and stored in this record. The records
+     * shared with other threads are only to be used under their info mutex.
+     *
+     * @return the identifier of the allocation callstack
+     */
+    inline auto getStackId() const -> std::uint64_t {
+        if (stackId == 0) {
+            stackId = callstackHelper::getStackId(createdCallstack);
+        }
+        return stackId;
+    }
 
     /**
      * @brief Marks this allocation record as deleted.
      *
-     * Creates a callstack of the point this function is called.
+     * Creates a callstack of the point this function is called, unless
+     * suspended by the overhead governor.
      */
     inline void markDeleted() {
         deleted = true;
-        deletedCallstack = lcs::callstack();
+        if (governor::captureDeletions()) {
+            deletedCallstack = callstackHelper::capture();
+        }
         freeTimestamp = std::chrono::system_clock::now();
     }
     
@@ -24,32 +24,8 @@
 #include "lsanMisc.hpp"
 
 namespace lsan {
-TLSTracker::TLSTracker() {
-    getInstance().registerTracker(this);
-}
-
 TLSTracker::~TLSTracker() {
-    if (finished) return;
-
-    finished = true;
-
-    std::lock_guard lock { mutex };
-    ignoreMalloc = true;
-
-    pthread_setspecific(getInstance().saniKey, std::addressof(getInstance()));
-    getInstance().deregisterTracker(this);
-
-    std::lock_guard lock1 { infoMutex };
-    if (getBehaviour().invalidFree()) {
-        for (auto it = infos.cbegin(); it != infos.cend();) {
-            if (it->second.deleted) {
-                it = infos.erase(it);
-            } else {
-                ++it;
-            }
-        }
-    }
-    getInstance().absorbLeaks(std::move(infos));
+    finish();
 }
 
 void TLSTracker::finish() {
@@ -58,24 +34,25 @@ void TLSTracker::finish() {
     finished = true;
 
     std::lock_guard lock  { mutex     };
-    std::lock_guard lock1 { infoMutex };
+    std::unique_lock lock1 { infoMutex };
 
     ignoreMalloc = true;
 
     if (getBehaviour().invalidFree()) {
-        for (auto it = infos.cbegin(); it != infos.cend();) {
+        for (auto it = infos.begin(); it != infos.end();) {
             if (it->second.deleted) {
-                it = infos.erase(it);
+                it = retire(it);
             } else {
                 ++it;
             }
         }
     }
+    reclaimAll(lock1);
     getInstance().absorbLeaks(std::move(infos));
     infos = decltype(infos)();
 }
 
-auto TLSTracker::maybeRemoveMalloc(void* pointer) -> std::pair<bool, std::optional<MallocInfo::CRef>> {
+auto TLSTracker::maybeRemoveMalloc(void* pointer, bool reused) -> std::pair<bool, std::optional<MallocInfo::CRef>> {
     std::lock_guard lock { infoMutex };
 
     const auto& it = infos.find(pointer);
@@ -89,15 +66,22 @@ auto TLSTracker::maybeRemoveMalloc(void* pointer) -> std::pair<bool, std::option
         it->second.markDeleted();
     } else {
         infos.erase(it);
+        // Another thread may already have registered the reused block.
+        if (!reused) {
+            presence::remove(pointer);
+        }
     }
     return std::make_pair(true, std::nullopt);
 }
 
-auto TLSTracker::removeMalloc(void* pointer) -> std::pair<bool, std::optional<MallocInfo::CRef>> {
-    const auto& result = maybeRemoveMalloc(pointer);
+auto TLSTracker::removeMalloc(void* pointer, bool reused) -> std::pair<bool, std::optional<MallocInfo::CRef>> {
+    if (!presence::mayContain(pointer)) {
+        return std::make_pair(false, std::nullopt);
+    }
+    const auto& result = maybeRemoveMalloc(pointer, reused);
 
     if (!result.first) {
-        const auto& globalResult = getInstance().removeMalloc(this, pointer);
+        const auto& globalResult = getInstance().removeMalloc(this, pointer, reused);
         if (!globalResult.first) {
             if (globalResult.second && result.second) {
                 return globalResult.second->get().isMoreRecent(result.second->get()) ? globalResult : result;
@@ -117,7 +101,7 @@ void TLSTracker::changeMalloc(MallocInfo&& info) {
         getInstance().changeMalloc(this, std::move(info));
         return;
     }
-    infos.insert_or_assign(info.pointer, std::move(info));
+    insert(std::move(info));
 }
 
 auto TLSTracker::maybeChangeMalloc(const MallocInfo& info) -> bool {
@@ -127,7 +111,7 @@ auto TLSTracker::maybeChangeMalloc(const MallocInfo& info) -> bool {
     if (it == infos.end()) {
         return false;
     }
-    infos.insert_or_assign(info.pointer, std::move(info));
+    insert(MallocInfo(info));
     return true;
 }
 }
@@ -26,20 +26,74 @@
 
 #include "ATracker.hpp"
 
+#include "allocations/realAlloc.hpp"
+
 namespace lsan {
 /**
- * This class represents a thread-local allocation tracker.
+ * @brief This class represents a thread-local allocation tracker.
+ *
+ * The trackers are never deregistered: the tracker of an exited thread is
+ * released and reused by a newly created thread along with its records.
  */
 class TLSTracker: public ATracker {
+    friend class LSan;
+
 private:
-    /** Indicates whether the tracking has finished. */
+    /** Indicates whether the tracking has finished.              */
     std::atomic_bool finished = false;
+    /** Indicates whether this tracker is owned by a thread.      */
+    std::atomic_bool inUse = true;
+    /** The next registered thread-local tracker.                 */
+    TLSTracker* next = nullptr;
 
 public:
-    TLSTracker();
+    TLSTracker() = default;
    ~TLSTracker();
 
-    virtual auto removeMalloc(void* pointer) -> std::pair<bool, std::optional<MallocInfo::CRef>> final override;
+    inline static auto operator new(std::size_t count) -> void* {
+        return real::malloc(count);
+    }
+
+    inline static void operator delete(void* ptr) {
+        real::free(ptr);
+    }
+
+    /**
+     * Returns the next registered thread-local tracker.
+     *
+     * @return the next tracker or `nullptr` if this tracker is the last one
+     */
+    constexpr inline auto getNext() const noexcept -> TLSTracker* {
+        return next;
+    }
+
+    /**
+     * Attempts to take the ownership of this tracker.
+     *
+     * @return whether the calling thread now owns this tracker
+     */
+    inline auto tryAcquire() noexcept -> bool {
+        bool expected = false;
+        return inUse.compare_exchange_strong(expected, true, std::memory_order_acquire);
+    }
+
+    /**
+     * Releases the ownership of this tracker, allowing it to be reused by another thread.
+     */
+    inline void release() noexcept {
+        inUse.store(false, std::memory_order_release);
+    }
+
+    /**
+     * Returns whether this tracker is currently owned by a thread.
+     *
+     * @return whether this tracker is in use
+     */
+    inline auto isInUse() const noexcept -> bool {
+        return inUse.load(std::memory_order_acquire);
+    }
+
+    virtual auto removeMalloc(void* pointer, bool reused) -> std::pair<bool, std::optional<MallocInfo::CRef>> final override;
     virtual void changeMalloc(MallocInfo&& info) final override;
 
     virtual auto maybeChangeMalloc(const MallocInfo& info) -> bool final override;
@@ -50,9 +104,10 @@ public:
      * Does not search in other trackers.
      *
      * @param pointer the allocation pointer
+     * @param reused whether the block may already have been reused
      * @return whether a record was removed and the potentially already existing record
      */
-    virtual auto maybeRemoveMalloc(void* pointer) -> std::pair<bool, std::optional<MallocInfo::CRef>> final override;
+    virtual auto maybeRemoveMalloc(void* pointer, bool reused) -> std::pair<bool, std::optional<MallocInfo::CRef>> final override;
 
     virtual void finish() final override;
 };
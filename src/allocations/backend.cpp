@@ -0,0 +1,289 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include "backend.hpp"
+
+#include "../behaviour/helper.hpp"
+
+namespace lsan::backend {
+/** The minimal alignment of the bootstrap blocks. */
+static constexpr std::size_t bootstrapAlignment = alignof(std::max_align_t);
+
+alignas(bootstrapAlignment) unsigned char bootstrapBuffer[256 * 1024];
+const std::size_t bootstrapSize = sizeof(bootstrapBuffer);
+
+/** The offset of the next free byte in the bootstrap buffer. */
+static std::atomic_size_t bootstrapOffset { 0 };
+
+/**
+ * This enumeration contains the possible states of the backend resolution.
+ */
+enum class State {
+    UNRESOLVED, RESOLVING, RESOLVED
+};
+
+/** The state of the backend resolution. */
+static std::atomic<State> state { State::UNRESOLVED };
+
+/** The resolved allocator backend. */
+static Backend resolved;
+
+/**
+ * The known allocator backends, mapped to their library names.
+ */
+static constexpr std::pair<const char*, const char*> libraries[] = {
+    { "libc",     "libc.so.6"                },
+    { "jemalloc", "libjemalloc.so.2"         },
+    { "tcmalloc", "libtcmalloc.so.4"         },
+    { "tcmalloc", "libtcmalloc_minimal.so.4" },
+    { "mimalloc", "libmimalloc.so.2"         },
+};
+
+/**
+ * @brief Allocates a block of memory from the bootstrap buffer.
+ *
+ * The size of the block is stored directly in front of it.
+ *
+ * @param size the requested size
+ * @param alignment the requested alignment, needs to be a power of two
+ * @return the allocated block or `nullptr` if the bootstrap buffer is exhausted
+ */
+static inline auto bootstrapAllocate(std::size_t size, std::size_t alignment = bootstrapAlignment) noexcept -> void* {
+    alignment = std::max(alignment, bootstrapAlignment);
+
+    const auto begin = reinterpret_cast<std::uintptr_t>(bootstrapBuffer);
+    auto offset = bootstrapOffset.load(std::memory_order_relaxed);
+    std::uintptr_t block;
+    std::size_t next;
+    do {
+        block = (begin + offset + sizeof(std::size_t) + alignment - 1) & ~(alignment - 1);
+        if (size > bootstrapSize || block - begin > bootstrapSize - size) {
+            return nullptr;
+        }
+        next = block - begin + size;
+    } while (!bootstrapOffset.compare_exchange_weak(offset, next, std::memory_order_relaxed));
+
+    *reinterpret_cast<std::size_t*>(block - sizeof(std::size_t)) = size;
+    return reinterpret_cast<void*>(block);
+}
+
+auto isResolving() noexcept -> bool {
+    return state.load(std::memory_order_acquire) == State::RESOLVING;
+}
+
+auto bootstrapSizeOf(const void* pointer) noexcept -> std::size_t {
+    return *reinterpret_cast<const std::size_t*>(reinterpret_cast<std::uintptr_t>(pointer) - sizeof(std::size_t));
+}
+
+auto reallocBootstrap(void* pointer, std::size_t size) noexcept -> void* {
+    auto toReturn = get().malloc(size);
+    if (toReturn != nullptr) {
+        std::memcpy(toReturn, pointer, std::min(size, bootstrapSizeOf(pointer)));
+    }
+    return toReturn;
+}
+
+/**
+ * Loads the allocation functions of the given library handle.
+ *
+ * @param handle the handle of the library to load the functions from
+ * @param name the name of the allocator backend
+ * @return whether all allocation functions were found
+ */
+static inline auto load(void* handle, const char* name) noexcept -> bool {
+    auto memalign = dlsym(handle, "memalign");
+    if (memalign == nullptr) {
+        memalign = dlsym(handle, "aligned_alloc");
+    }
+
+    Backend backend {
+        name,
+        nullptr,
+        reinterpret_cast<decltype(Backend::malloc)>(dlsym(handle, "malloc")),
+        reinterpret_cast<decltype(Backend::calloc)>(dlsym(handle, "calloc")),
+        reinterpret_cast<decltype(Backend::realloc)>(dlsym(handle, "realloc")),
+        reinterpret_cast<decltype(Backend::free)>(dlsym(handle, "free")),
+        reinterpret_cast<decltype(Backend::memalign)>(memalign),
+        reinterpret_cast<decltype(Backend::valloc)>(dlsym(handle, "valloc")),
+        reinterpret_cast<decltype(Backend::posix_memalign)>(dlsym(handle, "posix_memalign")),
+        reinterpret_cast<decltype(Backend::malloc_usable_size)>(dlsym(handle, "malloc_usable_size")),
+    };
+    if (backend.malloc == nullptr || backend.calloc == nullptr || backend.realloc == nullptr
+        || backend.free == nullptr || backend.memalign == nullptr || backend.valloc == nullptr
+        || backend.posix_memalign == nullptr || backend.malloc_usable_size == nullptr) {
+        return false;
+    }
+
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void*>(backend.malloc), &info) != 0) {
+        backend.library = info.dli_fname;
+    }
+    resolved = backend;
+    return true;
+}
+
+/**
+ * Opens the library of the allocator backend with the given name.
+ *
+ * @param name the name of the allocator backend or the name of its library
+ * @return the library handle or `nullptr` if no library could be opened
+ */
+static inline auto open(const char* name) noexcept -> void* {
+    bool known = false;
+    for (const auto& [backendName, library] : libraries) {
+        if (behaviour::lowerCompare(name, backendName)) {
+            known = true;
+            if (auto handle = dlopen(library, RTLD_NOW | RTLD_LOCAL)) {
+                return handle;
+            }
+        }
+    }
+    return known ? nullptr : dlopen(name, RTLD_NOW | RTLD_LOCAL);
+}
+
+/**
+ * @brief Resolves the allocator backend.
+ *
+ * Does nothing if the backend has already been or is currently being resolved.
+ */
+static void resolve() noexcept {
+    auto expected = State::UNRESOLVED;
+    if (!state.compare_exchange_strong(expected, State::RESOLVING)) {
+        return;
+    }
+
+    const auto& name = behaviour::getVariable("LSAN_BACKEND");
+    auto loaded = false;
+    if (name && **name != '\0' && !behaviour::lowerCompare(*name, "next")) {
+        if (auto handle = open(*name)) {
+            loaded = load(handle, *name);
+        }
+        if (!loaded) {
+            std::fprintf(stderr, "LeakSanitizer: Could not load the allocator backend \"%s\", using the next allocator.\n", *name);
+        }
+    }
+    if (!loaded && !load(RTLD_NEXT, "next")) {
+        std::fputs("LeakSanitizer: Could not resolve the next allocator, aborting.\n", stderr);
+        std::abort();
+    }
+
+    current.store(&resolved, std::memory_order_release);
+    state.store(State::RESOLVED, std::memory_order_release);
+}
+
+/**
+ * Returns whether the backend has been resolved, resolving it if necessary.
+ *
+ * @return whether the resolved backend can be used
+ */
+static inline auto isResolved() noexcept -> bool {
+    resolve();
+    return state.load(std::memory_order_acquire) == State::RESOLVED;
+}
+
+static auto bootstrapMalloc(std::size_t size) -> void* {
+    return isResolved() ? get().malloc(size) : bootstrapAllocate(size);
+}
+
+static auto bootstrapCalloc(std::size_t count, std::size_t size) -> void* {
+    if (isResolved()) {
+        return get().calloc(count, size);
+    }
+    if (size != 0 && count > bootstrapSize / size) {
+        return nullptr;
+    }
+    // The bootstrap buffer is never reused, hence it is still zeroed.
+    return bootstrapAllocate(count * size);
+}
+
+static auto bootstrapRealloc(void* pointer, std::size_t size) -> void* {
+    if (isResolved()) {
+        return pointer != nullptr && isBootstrap(pointer) ? reallocBootstrap(pointer, size) : get().realloc(pointer, size);
+    }
+    auto toReturn = bootstrapAllocate(size);
+    if (toReturn != nullptr && pointer != nullptr) {
+        std::memcpy(toReturn, pointer, std::min(size, bootstrapSizeOf(pointer)));
+    }
+    return toReturn;
+}
+
+static void bootstrapFree(void* pointer) {
+    if (pointer != nullptr && !isBootstrap(pointer) && isResolved()) {
+        get().free(pointer);
+    }
+}
+
+static auto bootstrapMemalign(std::size_t alignment, std::size_t size) -> void* {
+    return isResolved() ? get().memalign(alignment, size) : bootstrapAllocate(size, alignment);
+}
+
+static auto bootstrapValloc(std::size_t size) -> void* {
+    return isResolved() ? get().valloc(size) : bootstrapAllocate(size, static_cast<std::size_t>(getpagesize()));
+}
+
+static auto bootstrapPosixMemalign(void** memPtr, std::size_t alignment, std::size_t size) -> int {
+    if (isResolved()) {
+        return get().posix_memalign(memPtr, alignment, size);
+    }
+    auto block = bootstrapAllocate(size, alignment);
+    if (block == nullptr) {
+        return ENOMEM;
+    }
+    *memPtr = block;
+    return 0;
+}
+
+static auto bootstrapUsableSize(void* pointer) -> std::size_t {
+    if (pointer == nullptr) {
+        return 0;
+    }
+    return isBootstrap(pointer) ? bootstrapSizeOf(pointer) : (isResolved() ? get().malloc_usable_size(pointer) : 0);
+}
+
+/** The backend resolving the actual backend on its first use. */
+static constexpr Backend bootstrap {
+    "bootstrap",
+    nullptr,
+    bootstrapMalloc,
+    bootstrapCalloc,
+    bootstrapRealloc,
+    bootstrapFree,
+    bootstrapMemalign,
+    bootstrapValloc,
+    bootstrapPosixMemalign,
+    bootstrapUsableSize,
+};
+
+std::atomic<const Backend*> current { &bootstrap };
+}
+
+#endif /* __linux__ */
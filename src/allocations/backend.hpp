@@ -0,0 +1,118 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef backend_hpp
+#define backend_hpp
+
+#ifdef __linux__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief This namespace contains the allocator backend the allocations are forwarded to.
+ *
+ * The backend is resolved lazily on its first use. By default, the next
+ * allocator in the symbol lookup order is used, which allows to compose this
+ * sanitizer with allocators like jemalloc. An allocator can also be chosen
+ * explicitly using `LSAN_BACKEND`.
+ *
+ * The allocations made while resolving the backend are served from a static
+ * bootstrap buffer. Its blocks are neither tracked nor ever deallocated.
+ */
+namespace lsan::backend {
+/**
+ * This structure contains the allocation functions of an allocator backend.
+ */
+struct Backend {
+    /** The name of the allocator backend.                     */
+    const char* name;
+    /** The file name of the library providing the allocator. */
+    const char* library;
+
+    void*       (*malloc)(std::size_t);
+    void*       (*calloc)(std::size_t, std::size_t);
+    void*       (*realloc)(void*, std::size_t);
+    void        (*free)(void*);
+    void*       (*memalign)(std::size_t, std::size_t);
+    void*       (*valloc)(std::size_t);
+    int         (*posix_memalign)(void**, std::size_t, std::size_t);
+    std::size_t (*malloc_usable_size)(void*);
+};
+
+/** The currently active allocator backend.      */
+extern std::atomic<const Backend*> current;
+/** The buffer for the bootstrap allocations.   */
+extern unsigned char bootstrapBuffer[];
+/** The size of the bootstrap allocation buffer. */
+extern const std::size_t bootstrapSize;
+
+/**
+ * Returns the currently active allocator backend.
+ *
+ * @return the active backend
+ */
+static inline auto get() noexcept -> const Backend& {
+    return *current.load(std::memory_order_acquire);
+}
+
+/**
+ * Returns whether the given pointer has been allocated from the bootstrap buffer.
+ *
+ * @param pointer the pointer to be checked
+ * @return whether the pointer points into the bootstrap buffer
+ */
+static inline auto isBootstrap(const void* pointer) noexcept -> bool {
+    const auto address = reinterpret_cast<std::uintptr_t>(pointer),
+               begin   = reinterpret_cast<std::uintptr_t>(bootstrapBuffer);
+    return address >= begin && address < begin + bootstrapSize;
+}
+
+/**
+ * Returns whether the allocator backend is currently being resolved.
+ *
+ * @return whether the backend is being resolved
+ */
+auto isResolving() noexcept -> bool;
+
+/**
+ * Returns the usable size of the given block allocated from the bootstrap buffer.
+ *
+ * @param pointer the bootstrap block
+ * @return the usable size of the block
+ */
+auto bootstrapSizeOf(const void* pointer) noexcept -> std::size_t;
+
+/**
+ * Moves the given block allocated from the bootstrap buffer into a newly
+ * allocated block of the given size using the active backend.
+ *
+ * @param pointer the bootstrap block
+ * @param size the requested new size
+ * @return the newly allocated block or `nullptr` if no memory was available
+ */
+auto reallocBootstrap(void* pointer, std::size_t size) noexcept -> void*;
+}
+
+#endif /* __linux__ */
+
+#endif /* backend_hpp */
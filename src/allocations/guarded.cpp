@@ -0,0 +1,278 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "guarded.hpp"
+#include "realAlloc.hpp"
+
+#include "../lsanMisc.hpp"
+#include "../MallocInfo.hpp"
+#include "../governor/governor.hpp"
+
+namespace lsan::guarded {
+/**
+ * This structure represents a page of the guarded pool.
+ */
+struct Slot {
+    /** The record of the last allocation served from this slot. */
+    std::optional<MallocInfo> info;
+    /** Indicates whether the block of this slot is allocated.    */
+    bool allocated = false;
+};
+
+/** The minimal alignment of the guarded blocks.                         */
+static constexpr std::size_t alignment = alignof(std::max_align_t);
+/** The countdown used while sampling is deactivated.                    */
+static constexpr std::size_t recheckInterval = 65536;
+
+thread_local std::size_t countdown = 0;
+std::atomic<std::uintptr_t> poolBegin = 0;
+std::atomic<std::uintptr_t> poolEnd   = 0;
+
+/** Indicates whether the calling thread is currently sampling.          */
+static thread_local bool sampling __attribute__((tls_model("initial-exec"))) = false;
+/** The state of the random number generator of the calling thread.      */
+static thread_local std::uint32_t seed __attribute__((tls_model("initial-exec"))) = 0;
+
+/** The slots of the guarded pool.                                       */
+static Slot* slots = nullptr;
+/** The amount of slots in the guarded pool.                             */
+static std::size_t slotCount = 0;
+/** The index of the slot to be tried first for the next allocation.     */
+static std::size_t nextSlot = 0;
+/** The size of a page.                                                  */
+static std::size_t pageSize = 0;
+/** The mutex protecting the slots.                                      */
+static std::mutex mutex;
+/** Ensures the guarded pool is only created once.                       */
+static std::once_flag created;
+
+/**
+ * Creates the guarded pool. Its pages are mapped inaccessible.
+ */
+static void create() noexcept {
+    const auto count = getBehaviour().guardedPoolSize();
+    if (count == 0) return;
+
+    const auto page     = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const auto poolSize = (2 * count + 1) * page;
+    auto pool = mmap(nullptr, poolSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pool == MAP_FAILED) return;
+    auto metadata = mmap(nullptr, count * sizeof(Slot), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (metadata == MAP_FAILED) {
+        munmap(pool, poolSize);
+        return;
+    }
+    slots = static_cast<Slot*>(metadata);
+    for (std::size_t i = 0; i < count; ++i) {
+        new (slots + i) Slot();
+    }
+    slotCount = count;
+    pageSize  = page;
+
+    const auto begin = reinterpret_cast<std::uintptr_t>(pool);
+    poolEnd.store(begin + poolSize, std::memory_order_relaxed);
+    poolBegin.store(begin, std::memory_order_release);
+}
+
+/**
+ * Returns the address of the page of the slot with the given index.
+ *
+ * @param index the index of the slot
+ * @return the address of the page
+ */
+static inline auto pageOf(std::size_t index) noexcept -> std::uintptr_t {
+    return poolBegin.load(std::memory_order_relaxed) + (2 * index + 1) * pageSize;
+}
+
+/**
+ * Returns the index of the page the given address lies in.
+ *
+ * @param address the address inside the guarded pool
+ * @return the index of the page, odd for slots and even for guard pages
+ */
+static inline auto pageIndexOf(const void* address) noexcept -> std::size_t {
+    return (reinterpret_cast<std::uintptr_t>(address) - poolBegin.load(std::memory_order_relaxed)) / pageSize;
+}
+
+/**
+ * Returns the slot whose block is the given pointer.
+ *
+ * @param pointer the pointer to a guarded block
+ * @return the slot or `nullptr` if the pointer does not point into a slot
+ */
+static inline auto slotOf(const void* pointer) noexcept -> Slot* {
+    const auto page = pageIndexOf(pointer);
+    return page % 2 == 1 ? slots + page / 2 : nullptr;
+}
+
+/**
+ * Returns a random countdown for the given sample rate.
+ *
+ * @param rate the sample rate
+ * @return a countdown averaging to the sample rate
+ */
+static inline auto nextCountdown(std::size_t rate) noexcept -> std::size_t {
+    if (seed == 0) {
+        seed = static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(&seed) >> 4) | 1;
+    }
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return 1 + seed % (2 * rate);
+}
+
+/**
+ * Returns whether a block of the given size can be served from the guarded pool.
+ *
+ * @param size the requested size
+ * @return whether the block fits into a slot
+ */
+static inline auto fits(std::size_t size) noexcept -> bool {
+    std::call_once(created, create);
+    return slotCount != 0 && size <= pageSize;
+}
+
+/**
+ * Allocates a block from the guarded pool for the given allocation record.
+ *
+ * @param info the allocation record, its pointer is set to the allocated block
+ * @return the guarded block or `nullptr` if no slot is available
+ */
+static inline auto allocate(MallocInfo&& info) noexcept -> void* {
+    const auto size = info.size;
+
+    std::lock_guard lock { mutex };
+    for (std::size_t i = 0; i < slotCount; ++i) {
+        const auto index = (nextSlot + i) % slotCount;
+        auto& slot = slots[index];
+        if (slot.allocated) continue;
+
+        const auto page = pageOf(index);
+        if (mprotect(reinterpret_cast<void*>(page), pageSize, PROT_READ | PROT_WRITE) != 0) {
+            return nullptr;
+        }
+        std::memset(reinterpret_cast<void*>(page), 0, pageSize);
+        // Blocks of size zero are placed like one byte blocks, so that they lie within their page.
+        const auto block = reinterpret_cast<void*>((page + pageSize - std::max<std::size_t>(size, 1)) & ~(alignment - 1));
+        info.pointer = block;
+        slot.info = std::move(info);
+        slot.allocated = true;
+        nextSlot = index + 1;
+        return block;
+    }
+    return nullptr;
+}
+
+auto sample(std::size_t size) noexcept -> void* {
+    if (sampling || LSan::finished) return nullptr;
+
+    sampling = true;
+    void* toReturn = nullptr;
+    auto& tracker = getTracker();
+    {
+        std::lock_guard lock { tracker.mutex };
+        // The internal allocations are not sampled, the countdown is kept for the next allocation.
+        if (!tracker.ignoreMalloc) {
+            const auto due  = countdown == 1;
+            const auto rate = getBehaviour().guardedSampleRate() * governor::getSampleFactor();
+            countdown = rate == 0 ? recheckInterval : nextCountdown(rate);
+            if (due && rate != 0 && fits(size)) {
+                // The record is created before the slots are locked, its callstack is reused by the tracking.
+                tracker.ignoreMalloc = true;
+                auto info = MallocInfo(nullptr, size);
+                toReturn = allocate(std::move(info));
+                tracker.ignoreMalloc = false;
+            }
+        }
+    }
+    sampling = false;
+    return toReturn;
+}
+
+auto sizeOf(const void* pointer) noexcept -> std::size_t {
+    std::lock_guard lock { mutex };
+
+    const auto slot = slotOf(pointer);
+    return slot != nullptr && slot->allocated && slot->info->pointer == pointer ? slot->info->size : 0;
+}
+
+auto recordOf(const void* pointer) -> MallocInfo {
+    std::lock_guard lock { mutex };
+
+    return *slotOf(pointer)->info;
+}
+
+auto deallocate(void* pointer) noexcept -> bool {
+    std::lock_guard lock { mutex };
+
+    const auto slot = slotOf(pointer);
+    if (slot == nullptr || !slot->allocated || slot->info->pointer != pointer) {
+        return false;
+    }
+    // Creating the callstack might allocate, which must not sample while the slots are locked.
+    const auto wasSampling = sampling;
+    sampling = true;
+    slot->info->markDeleted();
+    sampling = wasSampling;
+
+    slot->allocated = false;
+    mprotect(reinterpret_cast<void*>(pageOf(static_cast<std::size_t>(slot - slots))), pageSize, PROT_NONE);
+    return true;
+}
+
+auto reallocate(void* pointer, std::size_t size) noexcept -> void* {
+    auto toReturn = real::malloc(size);
+    if (toReturn != nullptr) {
+        std::memcpy(toReturn, pointer, std::min(size, sizeOf(pointer)));
+        deallocate(pointer);
+    }
+    return toReturn;
+}
+
+auto describe(const void* address) noexcept -> std::optional<std::pair<const char*, const MallocInfo*>> {
+    if (!contains(address)) return std::nullopt;
+
+    const auto page = pageIndexOf(address);
+    if (page % 2 == 1) {
+        const auto& slot = slots[page / 2];
+        if (slot.info.has_value() && !slot.allocated) {
+            return std::make_pair("Use after free", &*slot.info);
+        }
+        return std::nullopt;
+    }
+    if (page > 0 && slots[page / 2 - 1].info.has_value()) {
+        return std::make_pair("Heap buffer overflow", &*slots[page / 2 - 1].info);
+    }
+    if (page / 2 < slotCount && slots[page / 2].info.has_value()) {
+        return std::make_pair("Heap buffer underflow", &*slots[page / 2].info);
+    }
+    return std::nullopt;
+}
+}
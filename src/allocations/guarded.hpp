@@ -0,0 +1,142 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef guarded_hpp
+#define guarded_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace lsan {
+struct MallocInfo;
+}
+
+/**
+ * @brief This namespace contains the pool of guarded allocations.
+ *
+ * A sample of the allocations is served from a fixed-size pool of pages.
+ * Each page is surrounded by inaccessible guard pages and the blocks are
+ * placed at the end of their page, so overflowing them raises a segmentation
+ * fault. Deallocated pages are made inaccessible as well, in order to detect
+ * accesses after `free`. The pages are reused as late as possible.
+ */
+namespace lsan::guarded {
+/** The countdown to the next sampled allocation of the calling thread. */
+extern thread_local std::size_t countdown __attribute__((tls_model("initial-exec")));
+/** The address of the beginning of the guarded pool.                 */
+extern std::atomic<std::uintptr_t> poolBegin;
+/** The address of the end of the guarded pool.                       */
+extern std::atomic<std::uintptr_t> poolEnd;
+
+/**
+ * @brief Samples an allocation of the given size.
+ *
+ * Resets the countdown of the calling thread.
+ *
+ * @param size the requested size
+ * @return the guarded block or `nullptr` if the allocation was not sampled
+ */
+auto sample(std::size_t size) noexcept -> void*;
+
+/**
+ * @brief Allocates the given amount of bytes from the guarded pool if the
+ * allocation is sampled.
+ *
+ * The blocks are zero-initialized.
+ *
+ * @param size the requested size
+ * @return the guarded block or `nullptr` if the allocation was not sampled
+ */
+static inline auto maybeAllocate(std::size_t size) noexcept -> void* {
+    if (__builtin_expect(countdown > 1, true)) {
+        --countdown;
+        return nullptr;
+    }
+    return sample(size);
+}
+
+/**
+ * Returns whether the given address lies within the guarded pool.
+ *
+ * @param address the address to be checked
+ * @return whether the address belongs to the guarded pool
+ */
+static inline auto contains(const void* address) noexcept -> bool {
+    const auto value = reinterpret_cast<std::uintptr_t>(address);
+    return value >= poolBegin.load(std::memory_order_relaxed) && value < poolEnd.load(std::memory_order_relaxed);
+}
+
+/**
+ * Returns the requested size of the given guarded block.
+ *
+ * @param pointer the guarded block
+ * @return the size of the block or zero if it is not allocated
+ */
+auto sizeOf(const void* pointer) noexcept -> std::size_t;
+
+/**
+ * @brief Returns a copy of the allocation record of the given guarded block.
+ *
+ * The block needs to be allocated.
+ *
+ * @param pointer the guarded block
+ * @return the allocation record
+ */
+auto recordOf(const void* pointer) -> MallocInfo;
+
+/**
+ * @brief Moves the given guarded block into a newly allocated block of the
+ * given size using the allocator backend.
+ *
+ * The guarded block is deallocated.
+ *
+ * @param pointer the guarded block
+ * @param size the requested new size
+ * @return the newly allocated block or `nullptr` if no memory was available
+ */
+auto reallocate(void* pointer, std::size_t size) noexcept -> void*;
+
+/**
+ * @brief Deallocates the given guarded block.
+ *
+ * Its page is made inaccessible.
+ *
+ * @param pointer the guarded block
+ * @return whether the block was allocated
+ */
+auto deallocate(void* pointer) noexcept -> bool;
+
+/**
+ * @brief Describes the invalid access of the given address inside of the guarded pool.
+ *
+ * Does neither lock nor allocate.
+ *
+ * @param address the accessed address
+ * @return the kind of the invalid access and the allocation record of the affected block
+ */
+auto describe(const void* address) noexcept -> std::optional<std::pair<const char*, const MallocInfo*>>;
+}
+
+#endif /* guarded_hpp */
@@ -24,21 +24,49 @@
 
 #include <cstdlib>
 
+#include "guarded.hpp"
+
 #ifdef __linux__
-extern "C" {
-void* __libc_malloc(std::size_t);
-void* __libc_valloc(std::size_t);
-void* __libc_calloc(std::size_t, std::size_t);
-void* __libc_realloc(void *, std::size_t);
-void  __libc_free(void *);
-void* __libc_memalign(std::size_t, std::size_t);
-}
+ #include "backend.hpp"
+#elif defined(__APPLE__)
+ #include <malloc/malloc.h>
 #endif
 
 /**
  * This namespace contains wrapper to the real functions.
  */
 namespace lsan::real {
+/**
+ * @brief Returns whether the given pointer has been allocated while the allocator backend was resolved.
+ *
+ * Such blocks are never tracked.
+ *
+ * @param pointer the pointer to be checked
+ * @return whether the given pointer belongs to the bootstrap allocations
+ */
+static inline auto isBootstrap([[ maybe_unused ]] const void* pointer) -> bool {
+#ifdef __linux__
+    return backend::isBootstrap(pointer);
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Returns whether the allocator backend is currently being resolved.
+ *
+ * The deallocations made meanwhile are not tracked.
+ *
+ * @return whether the backend is being resolved
+ */
+static inline auto isResolving() -> bool {
+#ifdef __linux__
+    return backend::isResolving();
+#else
+    return false;
+#endif
+}
+
 /**
  * Calls the real `malloc` function.
  *
@@ -48,7 +76,7 @@ namespace lsan::real {
 static inline auto malloc(std::size_t size) -> void * {
     void * toReturn;
 #ifdef __linux__
-    toReturn = __libc_malloc(size);
+    toReturn = backend::get().malloc(size);
 #else
     toReturn = std::malloc(size);
 #endif
@@ -64,7 +92,7 @@ static inline auto malloc(std::size_t size) -> void * {
 static inline auto valloc(std::size_t size) -> void* {
     void* toReturn;
 #ifdef __linux__
-    toReturn = __libc_valloc(size);
+    toReturn = backend::get().valloc(size);
 #else
     toReturn = ::valloc(size);
 #endif
@@ -81,7 +109,7 @@ static inline auto valloc(std::size_t size) -> void* {
 static inline auto calloc(std::size_t count, std::size_t size) -> void * {
     void * toReturn;
 #ifdef __linux__
-    toReturn = __libc_calloc(count, size);
+    toReturn = backend::get().calloc(count, size);
 #else
     toReturn = std::calloc(count, size);
 #endif
@@ -98,7 +126,7 @@ static inline auto calloc(std::size_t count, std::size_t size) -> void * {
 static inline auto aligned_alloc(std::size_t alignment, std::size_t size) -> void* {
     void* toReturn;
 #ifdef __linux__
-    toReturn = __libc_memalign(alignment, size);
+    toReturn = backend::get().memalign(alignment, size);
 #else
     toReturn = std::aligned_alloc(alignment, size);
 #endif
@@ -116,11 +144,7 @@ static inline auto aligned_alloc(std::size_t alignment, std::size_t size) -> voi
 static inline auto posix_memalign(void** memPtr, std::size_t alignment, std::size_t size) -> int {
     int toReturn;
 #ifdef __linux__
-    abort();
-    (void) memPtr;
-    (void) alignment;
-    (void) size;
-    // TODO: Linux version
+    toReturn = backend::get().posix_memalign(memPtr, alignment, size);
 #else
     toReturn = ::posix_memalign(memPtr, alignment, size);
 #endif
@@ -128,16 +152,23 @@ static inline auto posix_memalign(void** memPtr, std::size_t alignment, std::siz
 }
 
 /**
- * Calls the real `realloc` function.
+ * @brief Calls the real `realloc` function.
+ *
+ * Guarded blocks are moved into a block allocated by the real allocator.
  *
  * @param pointer the pointer to the memory block to be reallocated
  * @param size the requested new size the memory block
  * @return the reallocated memory block
  */
 static inline auto realloc(void * pointer, std::size_t size) -> void * {
+    if (guarded::contains(pointer)) {
+        return guarded::reallocate(pointer, size);
+    }
+
     void * toReturn;
 #ifdef __linux__
-    toReturn = __libc_realloc(pointer, size);
+    toReturn = backend::isBootstrap(pointer) ? backend::reallocBootstrap(pointer, size)
+                                             : backend::get().realloc(pointer, size);
 #else
     toReturn = std::realloc(pointer, size);
 #endif
@@ -145,17 +176,47 @@ static inline auto realloc(void * pointer, std::size_t size) -> void * {
 }
 
 /**
- * Calls the real `free` function.
+ * @brief Calls the real `free` function.
+ *
+ * Guarded blocks are returned to the guarded pool.
  *
  * @param pointer the pointer to be freed
  */
 static inline void free(void * pointer) {
+    if (guarded::contains(pointer)) {
+        guarded::deallocate(pointer);
+        return;
+    }
+
 #ifdef __linux__
-    __libc_free(pointer);
+    if (!backend::isBootstrap(pointer)) {
+        backend::get().free(pointer);
+    }
 #else
     std::free(pointer);
 #endif
 }
+
+/**
+ * Returns the usable size of the given block of memory.
+ *
+ * @param pointer the block of memory
+ * @return the usable size of the given block
+ */
+static inline auto malloc_usable_size(void* pointer) -> std::size_t {
+    if (guarded::contains(pointer)) {
+        return guarded::sizeOf(pointer);
+    }
+
+    std::size_t toReturn;
+#ifdef __linux__
+    toReturn = backend::isBootstrap(pointer) ? backend::bootstrapSizeOf(pointer)
+                                             : backend::get().malloc_usable_size(pointer);
+#else
+    toReturn = malloc_size(pointer);
+#endif
+    return toReturn;
+}
 }
 
 #endif /* realAlloc_hpp */
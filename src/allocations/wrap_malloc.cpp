@@ -19,6 +19,8 @@
  * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include <lsan_internals.h>
@@ -40,6 +42,15 @@
 #include "../timing.hpp"
 #include "../crashWarner/crash.hpp"
 #include "../crashWarner/warn.hpp"
+#include "../callers/callers.hpp"
+#include "../governor/governor.hpp"
+#include "../hooks/hooks.hpp"
+#include "../probes/probes.hpp"
+#include "../reclamation/epoch.hpp"
+#include "../recorder/recorder.hpp"
+#include "../statistics/statsMode.hpp"
+#include "../statistics/threadCounters.hpp"
+#include "../untracked/untracked.hpp"
 
 #ifdef __linux__
 auto operator new(std::size_t size) -> void * {
@@ -84,6 +95,51 @@ void __wrap_free(void* pointer, const char*, int) {
 namespace lsan {
 #endif /* !__linux__ */
 
+/**
+ * Allocates the given amount of bytes, from the guarded pool if the allocation is sampled.
+ *
+ * @param size the requested size
+ * @return the allocated block or `nullptr` if no memory was available
+ */
+static inline auto sampledMalloc(std::size_t size) -> void* {
+    auto toReturn = lsan::guarded::maybeAllocate(size);
+    return toReturn != nullptr ? toReturn : lsan::real::malloc(size);
+}
+
+/**
+ * Allocates the given amount of zero-initialized objects, from the guarded
+ * pool if the allocation is sampled.
+ *
+ * @param objectSize the size of the objects
+ * @param count the amount of objects
+ * @return the allocated block or `nullptr` if no memory was available
+ */
+static inline auto sampledCalloc(std::size_t objectSize, std::size_t count) -> void* {
+    std::size_t size;
+    if (!__builtin_mul_overflow(objectSize, count, &size)) {
+        if (auto toReturn = lsan::guarded::maybeAllocate(size)) {
+            return toReturn;
+        }
+    }
+    return lsan::real::calloc(objectSize, count);
+}
+
+/**
+ * Creates the allocation record of the given block, reusing the one of a guarded block.
+ *
+ * @param pointer the allocated block
+ * @param size the requested size
+ * @return the allocation record
+ */
+static inline auto createRecord(void* pointer, std::size_t size, std::size_t usableSize) -> lsan::MallocInfo {
+    if (lsan::guarded::contains(pointer)) {
+        auto toReturn = lsan::guarded::recordOf(pointer);
+        toReturn.usableSize = usableSize;
+        return toReturn;
+    }
+    return lsan::MallocInfo(pointer, size, usableSize);
+}
+
 /**
  * Creates an appropriate invalid free message for the given pointer.
  *
@@ -98,6 +154,124 @@ static inline auto createInvalidFreeMessage(const void* address, bool doubleFree
         + " for address " + formatString<Style::BOLD>(lsan::utils::toString(address));
 }
 
+/**
+ * Returns whether the allocation made from the given return address is to be tracked.
+ *
+ * @param caller the return address of the allocation function
+ * @return whether the caller is not excluded by `LSAN_TRACK_MODULES`
+ */
+static inline auto trackedCaller(const void* caller) -> bool {
+    return !lsan::callers::active() || lsan::callers::tracked(caller);
+}
+
+/**
+ * Counts the given block instead of tracking it if it is smaller than the minimal tracked size.
+ *
+ * @param pointer the allocated block
+ * @param size the requested size
+ * @return whether the block is not to be tracked
+ */
+static inline auto countUntracked(void* pointer, std::size_t size) -> bool {
+    if (size >= lsan::getBehaviour().minTrackedSize()) {
+        lsan::untracked::forget(pointer);
+        return false;
+    }
+    lsan::untracked::add(pointer, size);
+    lsan::getInstance().addUntracked(size);
+    return true;
+}
+
+/**
+ * Remembers the given block allocated by a module not listed in `LSAN_TRACK_MODULES`.
+ *
+ * @param pointer the allocated block
+ * @param size the requested size
+ * @return whether the block is not to be tracked, that is, always
+ */
+static inline auto exclude(void* pointer, std::size_t size) -> bool {
+    lsan::untracked::add(pointer, size, true);
+    return true;
+}
+
+/**
+ * Removes the given block if it has not been tracked. Must be called before the block is deallocated.
+ *
+ * @param pointer the block to be deallocated
+ * @return whether the block has been removed, has already been deallocated or is not an untracked one
+ */
+static inline auto removeUntracked(void* pointer) -> lsan::untracked::Result {
+    lsan::untracked::Block block;
+    const auto result = lsan::untracked::remove(pointer, lsan::getBehaviour().invalidFree(), block);
+    if (result == lsan::untracked::Result::REMOVED && !block.excluded) {
+        lsan::getInstance().removeUntracked(block.size);
+    }
+    return result;
+}
+
+/**
+ * Reports the invalid deallocation of the given block.
+ *
+ * @param pointer the invalidly deallocated block
+ * @param doubleFree whether the block has previously been deallocated
+ * @param info the allocation record of the block if known
+ */
+static inline void warnInvalidFree(const void* pointer, bool doubleFree, const std::optional<lsan::MallocInfo::CRef>& info) {
+    if (lsan::getBehaviour().invalidCrash()) {
+        lsan::crash(createInvalidFreeMessage(pointer, doubleFree), info);
+    } else {
+        lsan::warn(createInvalidFreeMessage(pointer, doubleFree), info);
+    }
+}
+
+/**
+ * Removes the allocation record or the untracked entry of the given block,
+ * reporting its invalid deallocation. Must be called before the block is deallocated.
+ *
+ * @param tracker the tracker of the calling thread
+ * @param pointer the block to be deallocated
+ */
+static inline void removeBlock(lsan::ATracker& tracker, void* pointer) {
+    switch (removeUntracked(pointer)) {
+        case lsan::untracked::Result::REMOVED:
+            return;
+
+        case lsan::untracked::Result::DEALLOCATED:
+            warnInvalidFree(pointer, true, std::nullopt);
+            return;
+
+        case lsan::untracked::Result::UNKNOWN:
+            break;
+    }
+    const lsan::epoch::Guard guard;
+    const auto& it = tracker.removeMalloc(pointer);
+    if (!it.first && lsan::getBehaviour().invalidFree()) {
+        warnInvalidFree(pointer, static_cast<bool>(it.second), it.second);
+    }
+}
+
+/**
+ * Counts the given block allocated by a module not listed in `LSAN_TRACK_MODULES` for the calling thread.
+ *
+ * @param pointer the allocated block, may be `nullptr`
+ * @param size the requested size
+ * @return the given block
+ */
+static inline auto countedOnly(void* pointer, std::size_t size) -> void* {
+    if (pointer == nullptr || lsan::real::isBootstrap(pointer) || lsan::LSan::finished) {
+        return pointer;
+    }
+    auto& tracker = lsan::getTracker();
+    const std::lock_guard lock { tracker.mutex };
+    if (!tracker.ignoreMalloc) {
+        tracker.ignoreMalloc = true;
+        const auto usableSize = lsan::real::malloc_usable_size(pointer);
+        lsan::threadCounters::addAllocation(usableSize);
+        exclude(pointer, size);
+        tracker.ignoreMalloc = false;
+    }
+    return pointer;
+}
+
 #ifdef __APPLE__
 auto malloc_zone_malloc(malloc_zone_t* zone, std::size_t size) -> void* {
     if (zone == nullptr) {
@@ -105,16 +279,27 @@ auto malloc_zone_malloc(malloc_zone_t* zone, std::size_t size) -> void* {
     }
 
     auto ptr = ::malloc_zone_malloc(zone, size);
+    if (statsMode::active()) {
+        return statsMode::counted(ptr);
+    }
+    if (!trackedCaller(__builtin_return_address(0))) {
+        return countedOnly(ptr, size);
+    }
     if (ptr != nullptr && !LSan::finished) {
         auto& tracker = getTracker();
         const std::lock_guard lock { tracker.mutex };
         if (!tracker.ignoreMalloc) {
             tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
+            const auto usableSize = real::malloc_usable_size(ptr);
+            threadCounters::addAllocation(usableSize);
 
             if (getBehaviour().zeroAllocation() && size == 0) {
                 warn("Implementation-defined allocation of size 0");
             }
-            tracker.addMalloc(MallocInfo(ptr, size));
+            if (!countUntracked(ptr, size)) {
+                tracker.addMalloc(MallocInfo(ptr, size, usableSize));
+            }
             tracker.ignoreMalloc = false;
         }
     }
@@ -127,16 +312,27 @@ auto malloc_zone_calloc(malloc_zone_t* zone, std::size_t count, std::size_t size
     }
 
     auto ptr = ::malloc_zone_calloc(zone, count, size);
+    if (statsMode::active()) {
+        return statsMode::counted(ptr);
+    }
+    if (!trackedCaller(__builtin_return_address(0))) {
+        return countedOnly(ptr, count * size);
+    }
     if (ptr != nullptr && !LSan::finished) {
         auto& tracker = getTracker();
         const std::lock_guard lock { tracker.mutex };
         if (!tracker.ignoreMalloc) {
             tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
+            const auto usableSize = real::malloc_usable_size(ptr);
+            threadCounters::addAllocation(usableSize);
 
             if (getBehaviour().zeroAllocation() && size == 0) {
                 warn("Implementation-defined allocation of size 0");
             }
-            tracker.addMalloc(MallocInfo(ptr, count * size));
+            if (!countUntracked(ptr, count * size)) {
+                tracker.addMalloc(MallocInfo(ptr, count * size, usableSize));
+            }
             tracker.ignoreMalloc = false;
         }
     }
@@ -149,16 +345,27 @@ auto malloc_zone_valloc(malloc_zone_t* zone, std::size_t size) -> void* {
     }
 
     auto ptr = ::malloc_zone_valloc(zone, size);
+    if (statsMode::active()) {
+        return statsMode::counted(ptr);
+    }
+    if (!trackedCaller(__builtin_return_address(0))) {
+        return countedOnly(ptr, size);
+    }
     if (ptr != nullptr && !LSan::finished) {
         auto& tracker = getTracker();
         const std::lock_guard lock { tracker.mutex };
         if (!tracker.ignoreMalloc) {
             tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
+            const auto usableSize = real::malloc_usable_size(ptr);
+            threadCounters::addAllocation(usableSize);
 
             if (getBehaviour().zeroAllocation() && size == 0) {
                 warn("Implementation-defined allocation of size 0");
             }
-            tracker.addMalloc(MallocInfo(ptr, size));
+            if (!countUntracked(ptr, size)) {
+                tracker.addMalloc(MallocInfo(ptr, size, usableSize));
+            }
             tracker.ignoreMalloc = false;
         }
     }
@@ -171,16 +378,27 @@ auto malloc_zone_memalign(malloc_zone_t* zone, std::size_t alignment, std::size_
     }
 
     auto ptr = ::malloc_zone_memalign(zone, alignment, size);
+    if (statsMode::active()) {
+        return statsMode::counted(ptr);
+    }
+    if (!trackedCaller(__builtin_return_address(0))) {
+        return countedOnly(ptr, size);
+    }
     if (ptr != nullptr && !LSan::finished) {
         auto& tracker = getTracker();
         const std::lock_guard lock { tracker.mutex };
         if (!tracker.ignoreMalloc) {
             tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
+            const auto usableSize = real::malloc_usable_size(ptr);
+            threadCounters::addAllocation(usableSize);
 
             if (getBehaviour().zeroAllocation() && size == 0) {
                 warn("Implementation-defined allocation of size 0");
             }
-            tracker.addMalloc(MallocInfo(ptr, size));
+            if (!countUntracked(ptr, size)) {
+                tracker.addMalloc(MallocInfo(ptr, size, usableSize));
+            }
             tracker.ignoreMalloc = false;
         }
     }
@@ -192,11 +410,12 @@ void malloc_destroy_zone(malloc_zone_t* zone) {
         crashForce("Destroying NULL zone");
     }
 
-    if (!LSan::finished) {
+    if (!statsMode::active() && !LSan::finished) {
         auto& tracker = getTracker();
         const std::lock_guard lock { tracker.mutex };
         if (!tracker.ignoreMalloc) {
             tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
             zone->introspect->enumerator(mach_task_self_,
                                          &tracker,
                                          MALLOC_PTR_IN_USE_RANGE_TYPE,
@@ -219,13 +438,30 @@ auto malloc_zone_batch_malloc(malloc_zone_t* zone, std::size_t size, void** resu
         crashForce("Batch allocating with NULL zone");
     }
     auto batched = ::malloc_zone_batch_malloc(zone, size, results, num_requested);
+    if (statsMode::active()) {
+        for (unsigned i = 0; i < batched; ++i) {
+            statsMode::counted(results[i]);
+        }
+        return batched;
+    }
+    if (!trackedCaller(__builtin_return_address(0))) {
+        for (unsigned i = 0; i < batched; ++i) {
+            countedOnly(results[i], size);
+        }
+        return batched;
+    }
     if (!LSan::finished && batched > 0) {
         auto& tracker = getTracker();
         const std::lock_guard lock { tracker.mutex };
         if (!tracker.ignoreMalloc) {
             tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
             for (std::size_t i = 0; i < batched; ++i) {
-                tracker.addMalloc(MallocInfo(results[i], size));
+                const auto usableSize = real::malloc_usable_size(results[i]);
+                threadCounters::addAllocation(usableSize);
+                if (!countUntracked(results[i], size)) {
+                    tracker.addMalloc(MallocInfo(results[i], size, usableSize));
+                }
             }
             tracker.ignoreMalloc = false;
         }
@@ -237,23 +473,25 @@ void malloc_zone_batch_free(malloc_zone_t* zone, void** to_be_freed, unsigned nu
     if (zone == nullptr) {
         crashForce("Batch free with NULL zone");
     }
+    if (statsMode::active()) {
+        for (unsigned i = 0; i < num; ++i) {
+            statsMode::deallocated(to_be_freed[i]);
+        }
+        ::malloc_zone_batch_free(zone, to_be_freed, num);
+        return;
+    }
     if (!LSan::finished && num > 0) {
         auto& tracker = getTracker();
         const std::lock_guard lock { tracker.mutex };
         if (!tracker.ignoreMalloc) {
             tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
             for (unsigned i = 0; i < num; ++i) {
                 if (to_be_freed[i] == nullptr && getBehaviour().freeNull()) {
                     warn("Free of NULL");
                 } else if (to_be_freed[i] != nullptr) {
-                    const auto& it = tracker.removeMalloc(to_be_freed[i]);
-                    if (getBehaviour().invalidFree() && !it.first) {
-                        if (getBehaviour().invalidCrash()) {
-                            crash(createInvalidFreeMessage(to_be_freed[i], static_cast<bool>(it.second)), it.second);
-                        } else {
-                            warn(createInvalidFreeMessage(to_be_freed[i], static_cast<bool>(it.second)), it.second);
-                        }
-                    }
+                    threadCounters::addDeallocation(real::malloc_usable_size(to_be_freed[i]));
+                    removeBlock(tracker, to_be_freed[i]);
                 }
             }
             tracker.ignoreMalloc = false;
@@ -266,23 +504,23 @@ void malloc_zone_free(malloc_zone_t* zone, void* ptr) {
     if (zone == nullptr) {
         crashForce("Called with NULL as zone");
     }
+    if (statsMode::active()) {
+        statsMode::deallocated(ptr);
+        ::malloc_zone_free(zone, ptr);
+        return;
+    }
 
     if (!LSan::finished) {
         auto& tracker = getTracker();
         const std::lock_guard lock { tracker.mutex };
         if (!tracker.ignoreMalloc) {
             tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
             if (ptr == nullptr && getBehaviour().freeNull()) {
                 warn("Free of NULL");
             } else if (ptr != nullptr) {
-                const auto& it = tracker.removeMalloc(ptr);
-                if (getBehaviour().invalidFree() && !it.first) {
-                    if (getBehaviour().invalidCrash()) {
-                        crash(createInvalidFreeMessage(ptr, static_cast<bool>(it.second)), it.second);
-                    } else {
-                        warn(createInvalidFreeMessage(ptr, static_cast<bool>(it.second)), it.second);
-                    }
-                }
+                threadCounters::addDeallocation(real::malloc_usable_size(ptr));
+                removeBlock(tracker, ptr);
             }
             tracker.ignoreMalloc = false;
         }
@@ -295,25 +533,49 @@ auto malloc_zone_realloc(malloc_zone_t* zone, void* ptr, std::size_t size) -> vo
         crashForce("Called with NULL as zone");
     }
 
+    if (statsMode::active()) {
+        const auto oldSize = ptr == nullptr ? 0 : real::malloc_usable_size(ptr);
+        auto toReturn = ::malloc_zone_realloc(zone, ptr, size);
+        if (toReturn != nullptr) {
+            if (ptr != nullptr) {
+                statsMode::deallocated(oldSize);
+            }
+            statsMode::counted(toReturn);
+        }
+        return toReturn;
+    }
     if (LSan::finished) {
         return ::malloc_zone_realloc(zone, ptr, size);
     }
+    const auto trackNew = trackedCaller(__builtin_return_address(0));
     auto& tracker = getTracker();
     std::lock_guard lock { tracker.mutex };
     auto ignored = tracker.ignoreMalloc;
     if (!ignored) {
         tracker.ignoreMalloc = true;
     }
+    const auto oldSize = ignored || ptr == nullptr ? 0 : real::malloc_usable_size(ptr);
     auto toReturn = ::malloc_zone_realloc(zone, ptr, size);
     if (!ignored) {
+        const lsan::governor::Measurement measurement;
         if (toReturn != nullptr) {
-            if (toReturn != ptr) {
-                if (ptr != nullptr) {
-                    tracker.removeMalloc(ptr);
+            if (ptr != nullptr) {
+                threadCounters::addDeallocation(oldSize);
+            }
+            const auto usableSize = real::malloc_usable_size(toReturn);
+            threadCounters::addAllocation(usableSize);
+            const auto wasTracked = ptr != nullptr && removeUntracked(ptr) != untracked::Result::REMOVED;
+            if (trackNew ? countUntracked(toReturn, size) : exclude(toReturn, size)) {
+                if (wasTracked) {
+                    tracker.removeMalloc(ptr, ptr != toReturn);
                 }
-                tracker.addMalloc(MallocInfo(toReturn, size));
+            } else if (toReturn == ptr && wasTracked) {
+                tracker.changeMalloc(MallocInfo(toReturn, size, usableSize));
             } else {
-                tracker.changeMalloc(MallocInfo(toReturn, size));
+                if (wasTracked) {
+                    tracker.removeMalloc(ptr, ptr != toReturn);
+                }
+                tracker.addMalloc(MallocInfo(toReturn, size, usableSize));
             }
         }
         tracker.ignoreMalloc = false;
@@ -323,19 +585,36 @@ auto malloc_zone_realloc(malloc_zone_t* zone, void* ptr, std::size_t size) -> vo
 #endif
 
 auto malloc(std::size_t size) -> void * {
-    BENCH(auto ptr = lsan::real::malloc(size);, std::chrono::nanoseconds, systemTime);
+    if (lsan::statsMode::active()) {
+        return lsan::statsMode::counted(lsan::real::malloc(size));
+    }
+    if (!trackedCaller(__builtin_return_address(0))) {
+        return countedOnly(lsan::real::malloc(size), size);
+    }
+    BENCH(auto ptr = sampledMalloc(size);, std::chrono::nanoseconds, systemTime);
     
-    if (ptr != nullptr && !lsan::LSan::finished) {
+    if (ptr != nullptr && !lsan::real::isBootstrap(ptr) && !lsan::LSan::finished) {
         auto& tracker = lsan::getTracker();
         BENCH(const std::lock_guard lock(tracker.mutex);, std::chrono::nanoseconds, lockingTime);
 
         if (!tracker.ignoreMalloc) {
             tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
+            const auto usableSize = lsan::real::malloc_usable_size(ptr);
+            lsan::threadCounters::addAllocation(usableSize);
             BENCH({
                 if (lsan::getBehaviour().zeroAllocation() && size == 0) {
                     lsan::warn("Implementation-defined allocation of size 0");
                 }
-                tracker.addMalloc(lsan::MallocInfo(ptr, size));
+                lsan::recorder::record(lsan::recorder::Op::MALLOC, ptr, size, __builtin_return_address(0));
+                if (countUntracked(ptr, size)) {
+                    lsan::hooks::allocated(lsan::recorder::Op::MALLOC, ptr, size);
+                } else {
+                    auto info = createRecord(ptr, size, usableSize);
+                    LSAN_PROBE_ALLOCATION(malloc, info);
+                    lsan::hooks::allocated(lsan::recorder::Op::MALLOC, ptr, size, &info);
+                    tracker.addMalloc(std::move(info));
+                }
             }, std::chrono::nanoseconds, trackingTime);
             
             BENCH_ONLY({
@@ -352,19 +631,36 @@ auto malloc(std::size_t size) -> void * {
 }
 
 auto calloc(std::size_t objectSize, std::size_t count) -> void* {
-    BENCH(auto ptr = lsan::real::calloc(objectSize, count);, std::chrono::nanoseconds, sysTime);
+    if (lsan::statsMode::active()) {
+        return lsan::statsMode::counted(lsan::real::calloc(objectSize, count));
+    }
+    if (!trackedCaller(__builtin_return_address(0))) {
+        return countedOnly(lsan::real::calloc(objectSize, count), objectSize * count);
+    }
+    BENCH(auto ptr = sampledCalloc(objectSize, count);, std::chrono::nanoseconds, sysTime);
     
-    if (ptr != nullptr && !lsan::LSan::finished) {
+    if (ptr != nullptr && !lsan::real::isBootstrap(ptr) && !lsan::LSan::finished) {
         auto& tracker = lsan::getTracker();
         BENCH(std::lock_guard lock(tracker.mutex);, std::chrono::nanoseconds, lockingTime);
 
         if (!tracker.ignoreMalloc) {
             tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
+            const auto usableSize = lsan::real::malloc_usable_size(ptr);
+            lsan::threadCounters::addAllocation(usableSize);
             BENCH({
                 if (lsan::getBehaviour().zeroAllocation() && objectSize * count == 0) {
                     lsan::warn("Implementation-defined allocation of size 0");
                 }
-                tracker.addMalloc(lsan::MallocInfo(ptr, objectSize * count));
+                lsan::recorder::record(lsan::recorder::Op::CALLOC, ptr, objectSize * count, __builtin_return_address(0));
+                if (countUntracked(ptr, objectSize * count)) {
+                    lsan::hooks::allocated(lsan::recorder::Op::CALLOC, ptr, objectSize * count);
+                } else {
+                    auto info = createRecord(ptr, objectSize * count, usableSize);
+                    LSAN_PROBE_ALLOCATION(calloc, info);
+                    lsan::hooks::allocated(lsan::recorder::Op::CALLOC, ptr, objectSize * count, &info);
+                    tracker.addMalloc(std::move(info));
+                }
             }, std::chrono::nanoseconds, trackingTime);
             
             BENCH_ONLY({
@@ -381,18 +677,35 @@ auto calloc(std::size_t objectSize, std::size_t count) -> void* {
 
 auto valloc(std::size_t size) -> void* {
     auto ptr = lsan::real::valloc(size);
+    if (lsan::statsMode::active()) {
+        return lsan::statsMode::counted(ptr);
+    }
+    if (!trackedCaller(__builtin_return_address(0))) {
+        return countedOnly(ptr, size);
+    }
 
-    if (ptr != nullptr && !lsan::LSan::finished) {
+    if (ptr != nullptr && !lsan::real::isBootstrap(ptr) && !lsan::LSan::finished) {
         auto& tracker = lsan::getTracker();
         const std::lock_guard lock { tracker.mutex };
 
         if (!tracker.ignoreMalloc) {
             tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
+            const auto usableSize = lsan::real::malloc_usable_size(ptr);
+            lsan::threadCounters::addAllocation(usableSize);
 
             if (lsan::getBehaviour().zeroAllocation() && size == 0) {
                 lsan::warn("Implementation-defined allocation of size 0");
             }
-            tracker.addMalloc(lsan::MallocInfo(ptr, size));
+            lsan::recorder::record(lsan::recorder::Op::MEMALIGN, ptr, size, __builtin_return_address(0));
+            if (countUntracked(ptr, size)) {
+                lsan::hooks::allocated(lsan::recorder::Op::MEMALIGN, ptr, size);
+            } else {
+                auto info = lsan::MallocInfo(ptr, size, usableSize);
+                LSAN_PROBE_ALLOCATION(malloc, info);
+                lsan::hooks::allocated(lsan::recorder::Op::MEMALIGN, ptr, size, &info);
+                tracker.addMalloc(std::move(info));
+            }
             tracker.ignoreMalloc = false;
         }
     }
@@ -401,18 +714,35 @@ auto valloc(std::size_t size) -> void* {
 
 auto aligned_alloc(std::size_t alignment, std::size_t size) -> void* {
     auto ptr = lsan::real::aligned_alloc(alignment, size);
+    if (lsan::statsMode::active()) {
+        return lsan::statsMode::counted(ptr);
+    }
+    if (!trackedCaller(__builtin_return_address(0))) {
+        return countedOnly(ptr, size);
+    }
 
-    if (ptr != nullptr && !lsan::LSan::finished) {
+    if (ptr != nullptr && !lsan::real::isBootstrap(ptr) && !lsan::LSan::finished) {
         auto& tracker = lsan::getTracker();
         const std::lock_guard lock { tracker.mutex };
 
         if (!tracker.ignoreMalloc) {
             tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
+            const auto usableSize = lsan::real::malloc_usable_size(ptr);
+            lsan::threadCounters::addAllocation(usableSize);
 
             if (lsan::getBehaviour().zeroAllocation() && size == 0) {
                 lsan::warn("Implementation-defined allocation of size 0");
             }
-            tracker.addMalloc(lsan::MallocInfo(ptr, size));
+            lsan::recorder::record(lsan::recorder::Op::MEMALIGN, ptr, size, __builtin_return_address(0));
+            if (countUntracked(ptr, size)) {
+                lsan::hooks::allocated(lsan::recorder::Op::MEMALIGN, ptr, size);
+            } else {
+                auto info = lsan::MallocInfo(ptr, size, usableSize);
+                LSAN_PROBE_ALLOCATION(malloc, info);
+                lsan::hooks::allocated(lsan::recorder::Op::MEMALIGN, ptr, size, &info);
+                tracker.addMalloc(std::move(info));
+            }
             tracker.ignoreMalloc = false;
         }
     }
@@ -420,7 +750,27 @@ auto aligned_alloc(std::size_t alignment, std::size_t size) -> void* {
 }
 
 auto realloc(void * pointer, std::size_t size) -> void * {
+    if (lsan::statsMode::active() && !lsan::real::isBootstrap(pointer)) {
+        const auto oldSize = pointer == nullptr ? 0 : lsan::real::malloc_usable_size(pointer);
+        auto ptr = lsan::real::realloc(pointer, size);
+        if (ptr != nullptr) {
+            if (pointer != nullptr) {
+                lsan::statsMode::deallocated(oldSize);
+            }
+            lsan::statsMode::counted(ptr);
+        }
+        return ptr;
+    }
     if (lsan::LSan::finished) return lsan::real::realloc(pointer, size);
+    if (lsan::real::isBootstrap(pointer)) {
+        // Blocks of the bootstrap buffer are not tracked, the moved block is a new allocation.
+        auto ptr = malloc(size);
+        if (ptr != nullptr) {
+            std::memcpy(ptr, pointer, std::min(size, lsan::real::malloc_usable_size(pointer)));
+        }
+        return ptr;
+    }
+    const auto trackNew = trackedCaller(__builtin_return_address(0));
 
     auto& tracker = lsan::getTracker();
     BENCH(std::lock_guard lock(tracker.mutex);, std::chrono::nanoseconds, lockingTime);
@@ -429,17 +779,40 @@ auto realloc(void * pointer, std::size_t size) -> void * {
     if (!ignored) {
         tracker.ignoreMalloc = true;
     }
+    const auto oldSize = ignored || pointer == nullptr ? 0 : lsan::real::malloc_usable_size(pointer);
     BENCH(void* ptr = lsan::real::realloc(pointer, size);, std::chrono::nanoseconds, sysTime);
     if (!ignored) {
+        const lsan::governor::Measurement measurement;
         BENCH({
             if (ptr != nullptr) {
-                if (pointer != ptr) {
-                    if (pointer != nullptr) {
-                        tracker.removeMalloc(pointer);
+                if (pointer != nullptr) {
+                    lsan::threadCounters::addDeallocation(oldSize);
+                }
+                const auto usableSize = lsan::real::malloc_usable_size(ptr);
+                lsan::threadCounters::addAllocation(usableSize);
+                LSAN_PROBE(realloc, pointer, ptr, size, lsan::callstackHelper::getStackId(lcs::callstack()), lsan::probes::threadId());
+                if (pointer != ptr && pointer != nullptr) {
+                    lsan::recorder::record(lsan::recorder::Op::FREE, pointer, 0, __builtin_return_address(0));
+                    lsan::hooks::deallocated(pointer);
+                }
+                lsan::recorder::record(lsan::recorder::Op::REALLOC, ptr, size, __builtin_return_address(0));
+                const auto wasTracked = pointer != nullptr && removeUntracked(pointer) != lsan::untracked::Result::REMOVED;
+                if (trackNew ? countUntracked(ptr, size) : exclude(ptr, size)) {
+                    lsan::hooks::allocated(lsan::recorder::Op::REALLOC, ptr, size);
+                    if (wasTracked) {
+                        tracker.removeMalloc(pointer, pointer != ptr);
                     }
-                    tracker.addMalloc(lsan::MallocInfo(ptr, size));
                 } else {
-                    tracker.changeMalloc(lsan::MallocInfo(ptr, size));
+                    auto info = lsan::MallocInfo(ptr, size, usableSize);
+                    lsan::hooks::allocated(lsan::recorder::Op::REALLOC, ptr, size, &info);
+                    if (pointer == ptr && wasTracked) {
+                        tracker.changeMalloc(std::move(info));
+                    } else {
+                        if (wasTracked) {
+                            tracker.removeMalloc(pointer, pointer != ptr);
+                        }
+                        tracker.addMalloc(std::move(info));
+                    }
                 }
             }
         }, std::chrono::nanoseconds, trackingTime);
@@ -456,7 +829,13 @@ auto realloc(void * pointer, std::size_t size) -> void * {
 }
 
 void free(void* pointer) {
-    if (lsan::LSan::finished) {
+    if (lsan::statsMode::active()) {
+        lsan::statsMode::deallocated(pointer);
+        lsan::real::free(pointer);
+        return;
+    }
+    // The dynamic loader frees `NULL` when a library fails to load while the backend is resolved.
+    if (lsan::LSan::finished || lsan::real::isBootstrap(pointer) || (pointer == nullptr && lsan::real::isResolving())) {
         lsan::real::free(pointer);
         return;
     }
@@ -467,18 +846,17 @@ void free(void* pointer) {
     auto ignored = tracker.ignoreMalloc;
     if (!ignored) {
         tracker.ignoreMalloc = true;
+        const lsan::governor::Measurement measurement;
         BENCH({
             if (pointer == nullptr && lsan::getBehaviour().freeNull()) {
                 lsan::warn("Free of NULL");
             } else if (pointer != nullptr) {
-                const auto& it = tracker.removeMalloc(pointer);
-                if (lsan::getBehaviour().invalidFree() && !it.first) {
-                    if (lsan::getBehaviour().invalidCrash()) {
-                        lsan::crash(createInvalidFreeMessage(pointer, static_cast<bool>(it.second)), it.second);
-                    } else {
-                        lsan::warn(createInvalidFreeMessage(pointer, static_cast<bool>(it.second)), it.second);
-                    }
-                }
+                const auto usableSize = lsan::real::malloc_usable_size(pointer);
+                LSAN_PROBE(free, pointer, usableSize, lsan::callstackHelper::getStackId(lcs::callstack()), lsan::probes::threadId());
+                lsan::recorder::record(lsan::recorder::Op::FREE, pointer, 0, __builtin_return_address(0));
+                lsan::hooks::deallocated(pointer);
+                lsan::threadCounters::addDeallocation(usableSize);
+                removeBlock(tracker, pointer);
             }
         }, std::chrono::nanoseconds, trackingTimeLocal);
         BENCH_ONLY(trackingTime = trackingTimeLocal;)
@@ -495,7 +873,6 @@ void free(void* pointer) {
     }
 }
 
-#ifndef __linux__
 auto posix_memalign(void** memPtr, std::size_t alignment, std::size_t size) -> int {
     void** checkPtr = memPtr;
     if (checkPtr == nullptr) {
@@ -504,12 +881,25 @@ auto posix_memalign(void** memPtr, std::size_t alignment, std::size_t size) -> i
 
     auto wasPtr = *memPtr;
     auto toReturn = lsan::real::posix_memalign(memPtr, alignment, size);
-    if (!lsan::LSan::finished) {
+    if (lsan::statsMode::active()) {
+        if (toReturn == 0) {
+            lsan::statsMode::counted(*memPtr);
+        }
+        return toReturn;
+    }
+    if (!trackedCaller(__builtin_return_address(0))) {
+        if (toReturn == 0) {
+            countedOnly(*memPtr, size);
+        }
+        return toReturn;
+    }
+    if (!lsan::real::isBootstrap(*memPtr) && !lsan::LSan::finished) {
         auto& tracker = lsan::getTracker();
         const std::lock_guard lock { tracker.mutex };
 
         if (!tracker.ignoreMalloc) {
             tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
 
             if (alignment == 0 || alignment % 2 != 0 || alignment % sizeof(void*) != 0) {
                 lsan::warn("posix_memalign with invalid alignment of " + std::to_string(alignment));
@@ -518,14 +908,66 @@ auto posix_memalign(void** memPtr, std::size_t alignment, std::size_t size) -> i
                 lsan::warn("Implementation-defined allocation of size 0");
             }
             if (*memPtr != wasPtr) {
-                tracker.addMalloc(lsan::MallocInfo(*memPtr, size));
+                const auto usableSize = lsan::real::malloc_usable_size(*memPtr);
+                lsan::threadCounters::addAllocation(usableSize);
+                lsan::recorder::record(lsan::recorder::Op::MEMALIGN, *memPtr, size, __builtin_return_address(0));
+                if (countUntracked(*memPtr, size)) {
+                    lsan::hooks::allocated(lsan::recorder::Op::MEMALIGN, *memPtr, size);
+                } else {
+                    auto info = lsan::MallocInfo(*memPtr, size, usableSize);
+                    LSAN_PROBE_ALLOCATION(malloc, info);
+                    lsan::hooks::allocated(lsan::recorder::Op::MEMALIGN, *memPtr, size, &info);
+                    tracker.addMalloc(std::move(info));
+                }
             }
             tracker.ignoreMalloc = false;
         }
     }
     return toReturn;
 }
-#endif
+
+#ifdef __linux__
+auto memalign(std::size_t alignment, std::size_t size) -> void* {
+    auto ptr = lsan::real::aligned_alloc(alignment, size);
+    if (lsan::statsMode::active()) {
+        return lsan::statsMode::counted(ptr);
+    }
+    if (!trackedCaller(__builtin_return_address(0))) {
+        return countedOnly(ptr, size);
+    }
+
+    if (ptr != nullptr && !lsan::real::isBootstrap(ptr) && !lsan::LSan::finished) {
+        auto& tracker = lsan::getTracker();
+        const std::lock_guard lock { tracker.mutex };
+
+        if (!tracker.ignoreMalloc) {
+            tracker.ignoreMalloc = true;
+            const lsan::governor::Measurement measurement;
+            const auto usableSize = lsan::real::malloc_usable_size(ptr);
+            lsan::threadCounters::addAllocation(usableSize);
+
+            if (lsan::getBehaviour().zeroAllocation() && size == 0) {
+                lsan::warn("Implementation-defined allocation of size 0");
+            }
+            lsan::recorder::record(lsan::recorder::Op::MEMALIGN, ptr, size, __builtin_return_address(0));
+            if (countUntracked(ptr, size)) {
+                lsan::hooks::allocated(lsan::recorder::Op::MEMALIGN, ptr, size);
+            } else {
+                auto info = lsan::MallocInfo(ptr, size, usableSize);
+                LSAN_PROBE_ALLOCATION(malloc, info);
+                lsan::hooks::allocated(lsan::recorder::Op::MEMALIGN, ptr, size, &info);
+                tracker.addMalloc(std::move(info));
+            }
+            tracker.ignoreMalloc = false;
+        }
+    }
+    return ptr;
+}
+
+auto malloc_usable_size(void* pointer) -> std::size_t {
+    return pointer == nullptr ? 0 : lsan::real::malloc_usable_size(pointer);
+}
+#endif /* __linux__ */
 
 #ifndef __linux__
 } /* namespace lsan */
@@ -537,9 +979,7 @@ INTERPOSE(lsan::realloc, realloc);
 INTERPOSE(lsan::free,    free);
 
 INTERPOSE(lsan::aligned_alloc,  aligned_alloc);
-#ifndef __linux__
 INTERPOSE(lsan::posix_memalign, posix_memalign);
-#endif
 
 #ifdef __APPLE__
 INTERPOSE(lsan::malloc_zone_malloc,   malloc_zone_malloc);
@@ -44,6 +44,13 @@ auto calloc(std::size_t, std::size_t) -> void *;
 auto realloc(void *, std::size_t)     -> void *;
 void free(void *);
 
+#ifdef __linux__
+extern "C" {
+auto memalign(std::size_t, std::size_t) -> void*;
+auto malloc_usable_size(void*) -> std::size_t;
+}
+#endif /* __linux__ */
+
 #ifndef __linux__
 } /* namespace lsan */
 #endif /* __linux__ */
@@ -26,6 +26,8 @@
 #include "ObjectPool.hpp"
 
 namespace lsan {
+std::atomic_size_t ObjectPool::totalBytes = 0;
+
 auto ObjectPool::allocate() -> void* {
     if (chunks != nullptr) {
         auto toReturn = chunks;
@@ -36,10 +38,11 @@ auto ObjectPool::allocate() -> void* {
         ++toReturn->block->allocCount;
         return reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(toReturn) + sizeof(MemoryBlock*));
     }
-    auto buffer = std::malloc((objectSize + sizeof(MemoryBlock*)) * (blockSize * factor) + sizeof(MemoryBlock));
+    auto buffer = std::malloc(blockBytes(blockSize * factor));
     if (buffer == nullptr) {
         return nullptr;
     }
+    totalBytes.fetch_add(blockBytes(blockSize * factor), std::memory_order_relaxed);
     auto newBlock = new(buffer) MemoryBlock(blockSize * factor);
 
     for (std::size_t i = 0; i < newBlock->blockSize; ++i) {
@@ -79,6 +82,8 @@ void ObjectPool::deallocate(void* pointer) {
             }
             if (element->next != nullptr) {
                 element->next->previous = element->previous;
+            } else if (element != chunks) {
+                chunks->previous = element->previous;
             }
             if (element == chunks) {
                 chunks = element->next;
@@ -88,6 +93,7 @@ void ObjectPool::deallocate(void* pointer) {
             }
             element->~MemoryChunk();
         }
+        totalBytes.fetch_sub(blockBytes(block->blockSize), std::memory_order_relaxed);
         delete block;
         if (factor > 1) {
             --factor;
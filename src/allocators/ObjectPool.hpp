@@ -22,6 +22,7 @@
 #ifndef ObjectPool_hpp
 #define ObjectPool_hpp
 
+#include <atomic>
 #include <cstddef>
 
 namespace lsan {
@@ -70,6 +71,19 @@ class ObjectPool {
     /** The list of available memory chunks.                */
     MemoryChunk* chunks = nullptr;
 
+    /** The total amount of bytes allocated by all pools.   */
+    static std::atomic_size_t totalBytes;
+
+    /**
+     * Returns the size in bytes of a memory block holding the given amount of objects.
+     *
+     * @param count the amount of objects
+     * @return the size of the memory block in bytes
+     */
+    constexpr inline auto blockBytes(std::size_t count) const -> std::size_t {
+        return (objectSize + sizeof(MemoryBlock*)) * count + sizeof(MemoryBlock);
+    }
+
 public:
     /**
      * @brief Constructs an object pool.
@@ -114,6 +128,15 @@ public:
         return objectSize;
     }
 
+    /**
+     * Returns the total amount of bytes currently allocated by all object pools.
+     *
+     * @return the amount of allocated bytes
+     */
+    static inline auto getTotalBytes() -> std::size_t {
+        return totalBytes.load(std::memory_order_relaxed);
+    }
+
     constexpr inline auto operator==(const ObjectPool& other) const noexcept -> bool {
         return objectSize == other.objectSize
             && blockSize == other.blockSize
@@ -53,6 +53,8 @@ struct PoolAllocator {
 
     inline PoolAllocator(): pools(std::allocate_shared<Pools>(RealAllocator<Pools>())) {}
 
+    constexpr inline PoolAllocator(const PoolAllocator& other) noexcept: pools(other.pools) {}
+
     template<typename U>
     constexpr inline PoolAllocator(const PoolAllocator<U>& other) noexcept: pools(other.getPools()) {}
 
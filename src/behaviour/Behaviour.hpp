@@ -28,6 +28,9 @@
 
 #include "helper.hpp"
 
+#include "../governor/governor.hpp"
+#include "../statistics/statsMode.hpp"
+
 namespace lsan::behaviour {
 /**
  * Represents the settings of the behaviours this sanitizer supports.
@@ -56,20 +59,44 @@ class Behaviour {
     /** Whether to print function names when line numbers are available. */
                               _printFunctions = get<bool>("LSAN_PRINT_FUNCTIONS"),
     /** Whether to relativate paths.                                     */
-                              _relativePaths  = get<bool>("LSAN_RELATIVE_PATHS");
+                              _relativePaths  = get<bool>("LSAN_RELATIVE_PATHS"),
+    /** Whether to record the usable sizes of the allocations.           */
+                              _trackSlack     = get<bool>("LSAN_TRACK_SLACK"),
+    /** Whether to record the recent allocation events of the threads.   */
+                              _flightRecorder = get<bool>("LSAN_FLIGHT_RECORDER"),
+    /** Whether to attribute the heap to the NUMA nodes.                 */
+                              _numaStats      = get<bool>("LSAN_NUMA_STATS"),
+    /** Whether to report the leaks of modules when they are unloaded.   */
+                              _reportOnUnload = get<bool>("LSAN_REPORT_ON_UNLOAD"),
+    /** Whether to print the live heap by dynamic type upon exit.        */
+                              _typeStats      = get<bool>("LSAN_TYPE_STATS");
 
     /** The amount of leaks to print.                                    */
     const std::optional<std::size_t> _leakCount           = get<std::size_t>("LSAN_LEAK_COUNT"),
     /** The amount of frames to print in callstacks.                     */
                                      _callstackSize       = get<std::size_t>("LSAN_CALLSTACK_SIZE"),
     /** The threshold for callstacks to be treated as user-relevant.     */
-                                     _firstPartyThreshold = get<std::size_t>("LSAN_FIRST_PARTY_THRESHOLD");
+                                     _firstPartyThreshold = get<std::size_t>("LSAN_FIRST_PARTY_THRESHOLD"),
+    /** The average amount of allocations per guarded allocation.        */
+                                     _guardedSampleRate   = get<std::size_t>("LSAN_GUARDED_SAMPLE_RATE"),
+    /** The amount of pages in the guarded pool.                         */
+                                     _guardedPoolSize     = get<std::size_t>("LSAN_GUARDED_POOL_SIZE"),
+    /** The size below which allocations are only counted.               */
+                                     _minTrackedSize      = get<std::size_t>("LSAN_MIN_TRACKED_SIZE"),
+    /** The amount of recorded events printed per other thread.          */
+                                     _recorderEvents      = get<std::size_t>("LSAN_RECORDER_EVENTS");
 
     /** The regex to detect first party binary names.                    */
-    const std::optional<const char*> _firstPartyRegex = getVariable("LSAN_FIRST_PARTY_REGEX");
+    const std::optional<const char*> _firstPartyRegex = getVariable("LSAN_FIRST_PARTY_REGEX"),
+    /** The key the printed leaks are ordered by.                        */
+                                     _leakOrder       = getVariable("LSAN_LEAK_ORDER");
 
     /** The time interval between the automatical statistics printing.   */
-    const std::optional<std::chrono::nanoseconds> _autoStats = get<std::chrono::nanoseconds>("LSAN_AUTO_STATS");
+    const std::optional<std::chrono::nanoseconds> _autoStats = get<std::chrono::nanoseconds>("LSAN_AUTO_STATS"),
+    /** The time interval between the copy-on-write scans after forks.   */
+                                                  _cowScan   = get<std::chrono::nanoseconds>("LSAN_COW_SCAN");
+    /** The overhead budget in percent.                                  */
+    const std::optional<double> _overheadBudget = get<double>("LSAN_OVERHEAD_BUDGET");
 
     /**
      * Returns whether the stats have been activated using an environment
@@ -92,18 +119,47 @@ public:
     ENV_OR_API(printFormatted)
     ENV_OR_API(invalidCrash)
     ENV_OR_API(invalidFree)
-    ENV_OR_API(freeNull)
-    ENV_OR_API(zeroAllocation)
     ENV_OR_API(printExitPoint)
     ENV_OR_API(printBinaries)
     ENV_OR_API(printFunctions)
     ENV_OR_API(relativePaths)
+    ENV_OR_API(trackSlack)
+    ENV_OR_API(flightRecorder)
+    ENV_OR_API(numaStats)
+    ENV_OR_API(reportOnUnload)
+    ENV_OR_API(typeStats)
 
     ENV_OR_API(leakCount)
     ENV_OR_API(callstackSize)
     ENV_OR_API(firstPartyThreshold)
+    ENV_OR_API(guardedSampleRate)
+    ENV_OR_API(guardedPoolSize)
+    ENV_OR_API(recorderEvents)
 
     ENV_OR_API(firstPartyRegex)
+    ENV_OR_API(leakOrder)
+
+    /**
+     * @brief Returns whether to check for `free`ing `NULL`.
+     *
+     * The check is suspended by the overhead governor while over budget.
+     *
+     * @return whether to check for `free`ing `NULL`
+     */
+    inline auto freeNull() const -> bool {
+        return (_freeNull ? *_freeNull : __lsan_freeNull) && governor::checkWarnings();
+    }
+
+    /**
+     * @brief Returns whether to check for zero allocations.
+     *
+     * The check is suspended by the overhead governor while over budget.
+     *
+     * @return whether to check for zero allocations
+     */
+    inline auto zeroAllocation() const -> bool {
+        return (_zeroAllocation ? *_zeroAllocation : __lsan_zeroAllocation) && governor::checkWarnings();
+    }
 
     /**
      * Returns whether the stats should be active.
@@ -111,7 +167,19 @@ public:
      * @return whether to activate the statistical book-keeping.
      */
     inline auto statsActive() const -> bool {
-        return statsActiveInternal() || _autoStats;
+        return statsActiveInternal() || _autoStats || trackSlack() || numaStats() || statsMode::active();
+    }
+
+    /**
+     * @brief Returns the size below which the allocations are only counted.
+     *
+     * Only settable using the environment variable, since the untracked blocks
+     * are recognized by their size when they are deallocated.
+     *
+     * @return the minimal tracked size, `0` if every allocation is tracked
+     */
+    inline auto minTrackedSize() const -> std::size_t {
+        return _minTrackedSize.value_or(0);
     }
 
     /**
@@ -123,6 +191,24 @@ public:
         return _autoStats;
     }
 
+    /**
+     * Returns the optionally set time interval between the copy-on-write scans of forked processes.
+     *
+     * @return the optional time interval
+     */
+    constexpr inline auto cowScan() const {
+        return _cowScan;
+    }
+
+    /**
+     * Returns the optionally set overhead budget in percent.
+     *
+     * @return the optional overhead budget
+     */
+    constexpr inline auto overheadBudget() const {
+        return _overheadBudget;
+    }
+
 #undef ENV_OR_API
 };
 }
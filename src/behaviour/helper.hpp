@@ -119,6 +119,20 @@ constexpr inline auto getFrom(const char* value) -> std::optional<bool> {
     return std::nullopt;
 }
 
+template<>
+inline auto getFrom(const char* value) -> std::optional<double> {
+    if (value == nullptr) {
+        return std::nullopt;
+    }
+
+    char* end = nullptr;
+    const auto toReturn = std::strtod(value, &end);
+    if (end == value || (*end != '\0' && strcmp(end, "%") != 0) || toReturn < 0) {
+        return std::nullopt;
+    }
+    return toReturn;
+}
+
 template<>
 inline auto getFrom(const char* value) -> std::optional<std::chrono::nanoseconds> {
     unsigned long count = 0;
@@ -0,0 +1,383 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+#include <dlfcn.h>
+#include <unwind.h>
+
+#ifdef __linux__
+ #include <link.h>
+ #include <unistd.h>
+#endif
+
+#ifdef __APPLE__
+ #include <mach-o/dyld.h>
+ #include <mach-o/loader.h>
+ #include <mach/vm_prot.h>
+#endif
+
+#include "callers.hpp"
+
+#include "../allocations/realAlloc.hpp"
+#include "../behaviour/helper.hpp"
+
+namespace lsan::callers {
+/**
+ * The kinds of modules an address can belong to.
+ */
+enum class Kind: std::uint8_t {
+    /** A module not listed.                                        */
+    OTHER,
+    /** A listed module.                                            */
+    TRACKED,
+    /** The C library, the C++ runtime or this sanitizer.           */
+    PASS_THROUGH
+};
+
+/**
+ * This structure represents the address range of the code of a module.
+ */
+struct Range {
+    /** The beginning of the range.        */
+    std::uintptr_t begin;
+    /** The end of the range, exclusively. */
+    std::uintptr_t end;
+    /** The kind of the module.            */
+    Kind kind;
+};
+
+/**
+ * This structure contains the sorted address ranges of the relevant modules.
+ */
+struct Table {
+    /** The amount of address ranges.                         */
+    std::size_t count;
+    /** The generation of the loaded modules it was built of. */
+    std::size_t generation;
+    /** The address ranges, sorted by their beginning.        */
+    Range ranges[1];
+};
+
+/** The maximal amount of frames inspected to find the caller outside of the pass-through modules. */
+static constexpr int maxDepth = 8;
+/** The amount of classifications of a thread between the checks for newly loaded modules.         */
+static constexpr std::size_t checkInterval = 4096;
+/** The beginnings of the file names of the modules the allocations are passed through.             */
+static constexpr const char* passThroughNames[] = {
+    "libc.so", "libc++", "libstdc++", "libsystem_c.dylib", "libsystem_malloc.dylib"
+};
+
+std::atomic_int state = -1;
+
+/** The current table, never freed since it might still be in use.    */
+static std::atomic<const Table*> table = nullptr;
+/** The mutex serializing the building of the tables.                 */
+static std::mutex buildMutex;
+/** The comma separated names of the listed modules.                  */
+static const char* list = nullptr;
+/** The path of this sanitizer.                                       */
+static const char* ownPath = nullptr;
+/** The countdown of the calling thread to the next check for loaded modules. */
+static thread_local std::size_t countdown __attribute__((tls_model("initial-exec"))) = checkInterval;
+
+/**
+ * Returns the file name of the given path.
+ *
+ * @param path the path
+ * @return the file name
+ */
+static inline auto fileName(const char* path) -> const char* {
+    const auto slash = std::strrchr(path, '/');
+    return slash == nullptr ? path : slash + 1;
+}
+
+/**
+ * @brief Returns whether the module at the given path matches the given name.
+ *
+ * A name containing a slash is compared to the whole path, otherwise to the
+ * file name. Version suffixes separated by a dot are ignored.
+ *
+ * @param path the path of the module
+ * @param name the name to be matched
+ * @param length the length of the name
+ * @return whether the module matches the name
+ */
+static inline auto matches(const char* path, const char* name, std::size_t length) -> bool {
+    if (length == 0) {
+        return false;
+    }
+    const auto file = std::memchr(name, '/', length) != nullptr ? path : fileName(path);
+    return std::strncmp(file, name, length) == 0 && (file[length] == '\0' || file[length] == '.');
+}
+
+/**
+ * Returns the kind of the module at the given path.
+ *
+ * @param path the path of the module
+ * @return the kind of the module
+ */
+static auto kindOf(const char* path) -> Kind {
+    for (auto name = list; *name != '\0';) {
+        const auto length = std::strcspn(name, ",");
+        if (matches(path, name, length)) {
+            return Kind::TRACKED;
+        }
+        name += length;
+        if (*name == ',') {
+            ++name;
+        }
+    }
+    if (ownPath != nullptr && std::strcmp(path, ownPath) == 0) {
+        return Kind::PASS_THROUGH;
+    }
+    const auto file = fileName(path);
+    for (const auto name : passThroughNames) {
+        if (std::strncmp(file, name, std::strlen(name)) == 0) {
+            return Kind::PASS_THROUGH;
+        }
+    }
+    return Kind::OTHER;
+}
+
+/**
+ * This structure collects the address ranges of the relevant modules.
+ */
+struct Collector {
+    /** The collected ranges, `nullptr` while only counting.   */
+    Range* ranges;
+    /** The amount of ranges that fit into the array.          */
+    std::size_t capacity;
+    /** The amount of found ranges.                            */
+    std::size_t count;
+
+    /**
+     * Adds the given address range.
+     *
+     * @param begin the beginning of the range
+     * @param end the end of the range
+     * @param kind the kind of the module
+     */
+    inline void add(std::uintptr_t begin, std::uintptr_t end, Kind kind) {
+        if (count < capacity) {
+            ranges[count] = { begin, end, kind };
+        }
+        ++count;
+    }
+};
+
+/**
+ * Returns the current generation of the loaded modules.
+ *
+ * @return a number changing whenever modules are loaded or unloaded
+ */
+static inline auto generation() -> std::size_t {
+#ifdef __APPLE__
+    return _dyld_image_count();
+#else
+    std::size_t toReturn = 0;
+    dl_iterate_phdr([](dl_phdr_info* info, std::size_t, void* data) {
+        *static_cast<std::size_t*>(data) = info->dlpi_adds + info->dlpi_subs;
+        return 1;
+    }, &toReturn);
+    return toReturn;
+#endif
+}
+
+/**
+ * Collects the code address ranges of the relevant modules.
+ *
+ * @param collector the collector to add the ranges to
+ */
+static void collect(Collector& collector) {
+#ifdef __APPLE__
+    for (std::uint32_t i = 0; i < _dyld_image_count(); ++i) {
+        const auto name = _dyld_get_image_name(i);
+        const auto kind = name == nullptr ? Kind::OTHER : kindOf(name);
+        if (kind == Kind::OTHER) continue;
+
+        const auto header = reinterpret_cast<const mach_header_64*>(_dyld_get_image_header(i));
+        const auto slide  = static_cast<std::uintptr_t>(_dyld_get_image_vmaddr_slide(i));
+        auto command      = reinterpret_cast<const load_command*>(header + 1);
+        for (std::uint32_t j = 0; j < header->ncmds; ++j) {
+            if (command->cmd == LC_SEGMENT_64) {
+                const auto segment = reinterpret_cast<const segment_command_64*>(command);
+                if (segment->vmsize > 0 && (segment->initprot & VM_PROT_EXECUTE) != 0) {
+                    collector.add(segment->vmaddr + slide, segment->vmaddr + slide + segment->vmsize, kind);
+                }
+            }
+            command = reinterpret_cast<const load_command*>(reinterpret_cast<const char*>(command) + command->cmdsize);
+        }
+    }
+#else
+    dl_iterate_phdr([](dl_phdr_info* info, std::size_t, void* data) {
+        static char executable[4096];
+
+        const char* path = info->dlpi_name;
+        if (path == nullptr || *path == '\0') {
+            const auto length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+            executable[length > 0 ? length : 0] = '\0';
+            path = executable;
+        }
+        const auto kind = kindOf(path);
+        if (kind == Kind::OTHER) return 0;
+
+        for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+            const auto& header = info->dlpi_phdr[i];
+            if (header.p_type == PT_LOAD && (header.p_flags & PF_X) != 0) {
+                static_cast<Collector*>(data)->add(info->dlpi_addr + header.p_vaddr,
+                                                   info->dlpi_addr + header.p_vaddr + header.p_memsz, kind);
+            }
+        }
+        return 0;
+    }, &collector);
+#endif
+}
+
+/**
+ * @brief Builds the table of the address ranges if the loaded modules have changed.
+ *
+ * Only uses the real allocator, since it is called from within the allocation
+ * functions. The previous table is never freed.
+ */
+static void build() noexcept {
+    // Skipped while another thread builds, the allocations might be made while the loader is locked.
+    std::unique_lock lock(buildMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    const auto current = table.load(std::memory_order_relaxed);
+    const auto currentGeneration = generation();
+    if (current != nullptr && current->generation == currentGeneration) {
+        return;
+    }
+
+    Collector collector { nullptr, 0, 0 };
+    collect(collector);
+    const auto capacity = collector.count;
+    const auto memory = real::malloc(sizeof(Table) + capacity * sizeof(Range));
+    if (memory == nullptr) {
+        return;
+    }
+    const auto newTable = static_cast<Table*>(memory);
+    collector = { newTable->ranges, capacity, 0 };
+    collect(collector);
+    newTable->count      = std::min(collector.count, capacity);
+    newTable->generation = currentGeneration;
+    std::sort(newTable->ranges, newTable->ranges + newTable->count, [](const Range& lhs, const Range& rhs) {
+        return lhs.begin < rhs.begin;
+    });
+    table.store(newTable, std::memory_order_release);
+}
+
+auto load() noexcept -> bool {
+    auto expected = -1;
+    // While loading, every allocation is tracked, including the ones made by the loading itself.
+    if (!state.compare_exchange_strong(expected, 2, std::memory_order_relaxed)) {
+        return expected != 0;
+    }
+    const auto& variable = behaviour::getVariable("LSAN_TRACK_MODULES");
+    if (!variable || **variable == '\0') {
+        state.store(0, std::memory_order_relaxed);
+        return false;
+    }
+    list = *variable;
+    Dl_info info;
+    if (dladdr(reinterpret_cast<const void*>(&load), &info) != 0) {
+        ownPath = info.dli_fname;
+    }
+    build();
+    state.store(1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * Returns the kind of the module containing the given address.
+ *
+ * @param table the table of the address ranges
+ * @param address the address
+ * @return the kind of the module the address belongs to
+ */
+static inline auto classify(const Table& table, std::uintptr_t address) -> Kind {
+    const auto end = table.ranges + table.count;
+    const auto it  = std::upper_bound(table.ranges, end, address, [](std::uintptr_t address, const Range& range) {
+        return address < range.begin;
+    });
+    return it == table.ranges || address >= (it - 1)->end ? Kind::OTHER : (it - 1)->kind;
+}
+
+/**
+ * This structure contains the state of a walk up the stack.
+ */
+struct Walk {
+    /** The table of the address ranges.                 */
+    const Table& table;
+    /** The amount of inspected frames.                  */
+    int depth;
+    /** Whether a frame of a listed module has been found. */
+    bool tracked;
+};
+
+/**
+ * Inspects the given stack frame.
+ *
+ * @param context the context of the stack frame
+ * @param data the walk state
+ * @return whether to continue the walk
+ */
+static auto inspect(_Unwind_Context* context, void* data) -> _Unwind_Reason_Code {
+    auto& walk = *static_cast<Walk*>(data);
+    switch (classify(walk.table, _Unwind_GetIP(context))) {
+        case Kind::TRACKED:
+            walk.tracked = true;
+            return _URC_END_OF_STACK;
+
+        case Kind::PASS_THROUGH: return ++walk.depth < maxDepth ? _URC_NO_REASON : _URC_END_OF_STACK;
+        default:                 return _URC_END_OF_STACK;
+    }
+}
+
+auto tracked(const void* caller) noexcept -> bool {
+    if (--countdown == 0) {
+        countdown = checkInterval;
+        if (state.load(std::memory_order_relaxed) == 1) {
+            build();
+        }
+    }
+    const auto current = table.load(std::memory_order_acquire);
+    if (current == nullptr) {
+        return true;
+    }
+    switch (classify(*current, reinterpret_cast<std::uintptr_t>(caller))) {
+        case Kind::TRACKED:      return true;
+        case Kind::OTHER:        return false;
+        case Kind::PASS_THROUGH: break;
+    }
+    // The frames of this sanitizer belong to the pass-through modules.
+    Walk walk { *current, 0, false };
+    _Unwind_Backtrace(inspect, &walk);
+    return walk.tracked;
+}
+}
@@ -0,0 +1,67 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef callers_hpp
+#define callers_hpp
+
+#include <atomic>
+
+/**
+ * @brief This namespace contains the allowlist of the modules whose allocations are tracked.
+ *
+ * When `LSAN_TRACK_MODULES` is set, only the allocations made by code of the
+ * listed modules are tracked, all other allocations are only counted. The
+ * listed modules are resolved into a sorted array of the address ranges of
+ * their code, which is rebuilt once modules have been loaded or unloaded. The
+ * allocations made by the C library, the C++ runtime or this sanitizer are
+ * attributed to the first caller outside of them, a few frames up the stack.
+ */
+namespace lsan::callers {
+/** Whether the allowlist is used, `-1` while not yet determined. */
+extern std::atomic_int state;
+
+/**
+ * Determines whether an allowlist of modules has been set.
+ *
+ * @return whether the allowlist is used
+ */
+auto load() noexcept -> bool;
+
+/**
+ * Returns whether only the allocations of the listed modules are tracked.
+ *
+ * @return whether the allowlist is used
+ */
+static inline auto active() noexcept -> bool {
+    const auto value = state.load(std::memory_order_relaxed);
+    return __builtin_expect(value < 0, false) ? load() : value != 0;
+}
+
+/**
+ * Returns whether the allocation made from the given return address is to be tracked.
+ *
+ * @param caller the return address of the allocation function
+ * @return whether the allocation is made by one of the listed modules
+ */
+auto tracked(const void* caller) noexcept -> bool;
+}
+
+#endif /* callers_hpp */
@@ -19,12 +19,23 @@
  * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cstdint>
 #include <map>
 #include <regex>
 #include <string>
 
+#include <dlfcn.h>
+#include <execinfo.h>
 #include <lsan_internals.h>
 
+#ifdef __APPLE__
+ #include <mach-o/loader.h>
+ #include <mach/vm_prot.h>
+#else
+ #include <link.h>
+#endif
+
 #define LCS_USE_UNSAFE_OPTIMIZATION 1
 #include <callstack.h>
 #include <callstack_internals.h>
@@ -33,6 +44,7 @@
 
 #include "../formatter.hpp"
 #include "../lsanMisc.hpp"
+#include "../governor/governor.hpp"
 
 namespace lsan::callstackHelper {
 /**
@@ -48,7 +60,10 @@ enum class Classification {
 };
 
 /** Caches the classifications of the file paths. */
-static std::map<const char*, Classification> cache;
+static std::map<std::string, Classification, std::less<>> cache;
+
+/** The translations used when formatting callstacks. */
+static const Translations* translations = nullptr;
 
 /**
  * Returns whether the given binary file name should be ignored totally.
@@ -174,6 +189,10 @@ static inline auto isFirstParty(const char* file) -> bool {
     return callstack_autoClearCaches ? isFirstPartyCore(file) : isFirstPartyCached(file);
 }
 
+void invalidateClassifications(const std::string& file) {
+    cache.erase(file);
+}
+
 auto getCallstackType(lcs::callstack & callstack) -> CallstackType {
     const auto& frames = callstack_autoClearCaches ? callstack_getBinaries(callstack)
                                                    : callstack_getBinariesCached(callstack);
@@ -269,47 +288,118 @@ static inline void formatShared(const callstack_frame& frame, std::ostream & out
     out << formatter::clear<S> << std::endl;
 }
 
-void format(lcs::callstack & callstack, std::ostream & stream) {
-    using formatter::Style;
+Translations::Translations(const std::vector<std::reference_wrapper<lcs::callstack>>& callstacks): previous(translations) {
+    std::vector<void*> addresses;
+    for (const auto& callstack : callstacks) {
+        const struct callstack* raw = callstack.get();
+        if (raw->translationStatus == TRANSLATED) continue;
+
+        addresses.insert(addresses.end(), raw->backtrace, raw->backtrace + raw->backtraceSize);
+    }
+    // Sorted, the return addresses of the same binary file are translated together.
+    std::sort(addresses.begin(), addresses.end());
+    addresses.erase(std::unique(addresses.begin(), addresses.end()), addresses.end());
 
+    for (std::size_t offset = 0; offset < addresses.size(); offset += CALLSTACK_BACKTRACE_SIZE) {
+        const auto amount = std::min<std::size_t>(CALLSTACK_BACKTRACE_SIZE, addresses.size() - offset);
+        auto& batch = batches.emplace_back(addresses.data() + offset, static_cast<int>(amount));
+        const auto translated = callstack_toArray(batch);
+        if (translated == nullptr) continue;
+
+        for (std::size_t i = 0; i < amount; ++i) {
+            frames.emplace(addresses[offset + i], translated + i);
+        }
+    }
+    translations = this;
+}
+
+Translations::~Translations() {
+    translations = previous;
+}
+
+/**
+ * @brief Looks up the prepared translations of the frames of the given callstack.
+ *
+ * Fails if any return address of the callstack has not been prepared.
+ *
+ * @param callstack the callstack
+ * @param frames the array to store the translated frames in
+ * @return whether all frames were found
+ */
+static inline auto lookUpTranslations(lcs::callstack& callstack, const callstack_frame** frames) -> bool {
+    const struct callstack* raw = callstack;
+    if (translations == nullptr || raw->translationStatus == TRANSLATED) return false;
+
+    for (std::size_t i = 0; i < raw->backtraceSize; ++i) {
+        if ((frames[i] = translations->find(raw->backtrace[i])) == nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Translates the given callstack.
+ *
+ * The prepared translations are used if available.
+ *
+ * @param callstack the callstack
+ * @param frames the array to store the translated frames in
+ * @return whether the callstack was translated
+ */
+static inline auto translate(lcs::callstack& callstack, const callstack_frame** frames) -> bool {
+    if (lookUpTranslations(callstack, frames)) {
+        return true;
+    }
     if (!callstack_autoClearCaches) {
         // Make sure to use the cached values and
         // potentially fail early.
         //
         //                          - mhahnFr
         if (callstack_getBinariesCached(callstack) == nullptr) {
-            stream << formatter::format<Style::RED>("LSan: Error: Failed to translate the callstack.") << std::endl;
-            return;
+            return false;
         }
     }
-    const auto& frames = callstack_toArray(callstack);
-    const auto& size   = callstack_getFrameCount(callstack);
+    const auto translated = callstack_toArray(callstack);
+    if (translated == nullptr) {
+        return false;
+    }
+    for (std::size_t i = 0; i < callstack_getFrameCount(callstack); ++i) {
+        frames[i] = translated + i;
+    }
+    return true;
+}
+
+void format(lcs::callstack & callstack, std::ostream & stream) {
+    using formatter::Style;
 
-    if (frames == nullptr) {
+    const callstack_frame* frames[CALLSTACK_BACKTRACE_SIZE];
+    if (!translate(callstack, frames)) {
         stream << formatter::format<Style::RED>("LSan: Error: Failed to translate the callstack.") << std::endl;
         return;
     }
+    const auto& size = callstack_getFrameCount(callstack);
 
     bool firstHit   = true,
          firstPrint = true;
     std::size_t i, printed;
     for (i = printed = 0; i < size && printed < getBehaviour().callstackSize(); ++i) {
-        const auto binaryFile = frames[i].binaryFile;
+        const auto binaryFile = frames[i]->binaryFile;
         
-        if (binaryFile == nullptr || (firstPrint && frames[i].binaryFileIsSelf)) {
+        if (binaryFile == nullptr || (firstPrint && frames[i]->binaryFileIsSelf)) {
             continue;
         } else if (firstHit && isFirstParty(binaryFile)) {
             stream << formatter::get<Style::GREYED>
                    << formatter::format<Style::ITALIC>(firstPrint ? "At: " : "at: ");
-            formatShared<Style::GREYED>(frames[i], stream);
+            formatShared<Style::GREYED>(*frames[i], stream);
         } else if (firstHit) {
             firstHit = false;
             stream << formatter::get<Style::BOLD>
                    << formatter::format<Style::ITALIC>(firstPrint ? "In: " : "in: ");
-            formatShared<Style::BOLD>(frames[i], stream);
+            formatShared<Style::BOLD>(*frames[i], stream);
         } else {
             stream << formatter::format<Style::ITALIC>(firstPrint ? "At: " : "at: ");
-            formatShared<Style::NONE>(frames[i], stream);
+            formatShared<Style::NONE>(*frames[i], stream);
         }
         firstPrint = false;
         ++printed;
@@ -319,4 +409,105 @@ void format(lcs::callstack & callstack, std::ostream & stream) {
         getInstance().setCallstackSizeExceeded(true);
     }
 }
+
+auto getFrameNames(lcs::callstack& callstack) -> std::vector<std::string> {
+    const callstack_frame* frames[CALLSTACK_BACKTRACE_SIZE];
+    if (!translate(callstack, frames)) {
+        return {};
+    }
+    std::vector<std::string> toReturn;
+    toReturn.reserve(callstack_getFrameCount(callstack));
+    for (std::size_t i = 0; i < callstack_getFrameCount(callstack); ++i) {
+        const auto& binary = getCallstackFrameName(*frames[i]);
+        toReturn.push_back(frames[i]->function == nullptr ? binary : frames[i]->function + (" (" + binary + ")"));
+    }
+    return toReturn;
+}
+
+/** The amount of frames of this sanitizer expected at most on top of a captured callstack. */
+static constexpr std::size_t internalFrames = 8;
+
+/**
+ * @brief Returns the address range of the code of this sanitizer.
+ *
+ * The range is determined once, it does not allocate afterwards.
+ *
+ * @return the beginning and the end of the executable segment containing this sanitizer
+ */
+static auto getOwnCode() -> std::pair<std::uintptr_t, std::uintptr_t> {
+    static const auto range = [] {
+        auto toReturn = std::pair<std::uintptr_t, std::uintptr_t>(0, 0);
+        const auto address = reinterpret_cast<std::uintptr_t>(&capture);
+#ifdef __APPLE__
+        Dl_info info;
+        if (dladdr(reinterpret_cast<const void*>(&capture), &info) == 0) {
+            return toReturn;
+        }
+        const auto header = static_cast<const mach_header_64*>(info.dli_fbase);
+        auto command      = reinterpret_cast<const load_command*>(header + 1);
+        std::uintptr_t slide = 0;
+        for (std::uint32_t i = 0; i < header->ncmds; ++i) {
+            if (command->cmd == LC_SEGMENT_64) {
+                const auto segment = reinterpret_cast<const segment_command_64*>(command);
+                if (segment->fileoff == 0 && segment->filesize != 0) {
+                    slide = reinterpret_cast<std::uintptr_t>(header) - segment->vmaddr;
+                }
+                if (segment->vmsize > 0 && (segment->initprot & VM_PROT_EXECUTE) != 0) {
+                    toReturn = { segment->vmaddr + slide, segment->vmaddr + slide + segment->vmsize };
+                }
+            }
+            command = reinterpret_cast<const load_command*>(reinterpret_cast<const char*>(command) + command->cmdsize);
+        }
+#else
+        struct Search {
+            std::uintptr_t address;
+            std::pair<std::uintptr_t, std::uintptr_t>& range;
+        } search { address, toReturn };
+        dl_iterate_phdr([](dl_phdr_info* info, std::size_t, void* data) {
+            auto& search = *static_cast<Search*>(data);
+            for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+                const auto& header = info->dlpi_phdr[i];
+                const auto begin   = info->dlpi_addr + header.p_vaddr;
+                if (header.p_type == PT_LOAD && (header.p_flags & PF_X) != 0
+                    && search.address >= begin && search.address < begin + header.p_memsz) {
+                    search.range = { begin, begin + header.p_memsz };
+                    return 1;
+                }
+            }
+            return 0;
+        }, &search);
+#endif
+        return toReturn;
+    }();
+    return range;
+}
+
+auto capture() -> lcs::callstack {
+    const auto depth = governor::getCaptureDepth();
+    if (depth >= CALLSTACK_BACKTRACE_SIZE) {
+        return lcs::callstack();
+    }
+    // The frames of this sanitizer are skipped before the depth is applied.
+    void* trace[CALLSTACK_BACKTRACE_SIZE];
+    const auto size = backtrace(trace, static_cast<int>(std::min(depth + internalFrames, std::size_t(CALLSTACK_BACKTRACE_SIZE))));
+    const auto [begin, end] = getOwnCode();
+    int skipped = 0;
+    while (skipped < size && reinterpret_cast<std::uintptr_t>(trace[skipped]) >= begin
+                          && reinterpret_cast<std::uintptr_t>(trace[skipped]) < end) {
+        ++skipped;
+    }
+    return lcs::callstack(trace + skipped, std::min(static_cast<int>(depth), size - skipped));
+}
+
+auto getStackId(lcs::callstack& callstack) -> std::uint64_t {
+    const struct callstack* raw = callstack;
+
+    // FNV-1a over the return addresses
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for (std::size_t i = 0; i < raw->backtraceSize; ++i) {
+        hash ^= reinterpret_cast<std::uintptr_t>(raw->backtrace[i]);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
 }
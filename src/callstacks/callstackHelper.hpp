@@ -22,7 +22,13 @@
 #ifndef callstackHelper_hpp
 #define callstackHelper_hpp
 
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
 #include <ostream>
+#include <string>
+#include <vector>
 
 #include <callstack.h>
 
@@ -65,6 +71,100 @@ void format(lcs::callstack & callstack, std::ostream & stream);
 static inline void format(lcs::callstack && callstack, std::ostream & out) {
     format(callstack, out);
 }
+
+/**
+ * @brief Returns the names of the frames of the given callstack.
+ *
+ * A frame is named by its function and its binary file. The prepared
+ * translations are used if available.
+ *
+ * @param callstack the callstack
+ * @return the names of the frames or an empty vector if the callstack could not be translated
+ */
+auto getFrameNames(lcs::callstack& callstack) -> std::vector<std::string>;
+
+/**
+ * Removes the cached classification of the given binary file.
+ *
+ * @param file the path of the unloaded binary file
+ */
+void invalidateClassifications(const std::string& file);
+
+/**
+ * @brief This class translates the return addresses of many callstacks at once.
+ *
+ * Every distinct return address is translated only once. While an instance
+ * exists, the formatted callstacks use its translations. Already translated
+ * callstacks keep their own translation.
+ */
+class Translations {
+    /** The translated frames mapped to their return addresses. */
+    std::map<void*, const callstack_frame*> frames;
+    /** The callstacks owning the translated frames.            */
+    std::deque<lcs::callstack> batches;
+    /** The previously used translations.                       */
+    const Translations* previous;
+
+public:
+    /**
+     * Translates the return addresses of the given callstacks.
+     *
+     * @param callstacks the callstacks to be translated
+     */
+    explicit Translations(const std::vector<std::reference_wrapper<lcs::callstack>>& callstacks);
+   ~Translations();
+
+    Translations(const Translations&) = delete;
+    Translations(Translations&&)      = delete;
+
+    auto operator=(const Translations&) -> Translations& = delete;
+    auto operator=(Translations&&)      -> Translations& = delete;
+
+    /**
+     * Returns the translated frame of the given return address.
+     *
+     * @param address the return address
+     * @return the translated frame or `nullptr` if the address has not been translated
+     */
+    inline auto find(void* address) const -> const callstack_frame* {
+        const auto& it = frames.find(address);
+        return it == frames.end() ? nullptr : it->second;
+    }
+};
+
+/**
+ * @brief Creates a callstack of the point this function is called.
+ *
+ * The frames of this sanitizer are skipped, of the remaining frames at most as
+ * many are captured as currently allowed by the overhead governor.
+ *
+ * @return the captured callstack
+ */
+auto capture() -> lcs::callstack;
+
+/**
+ * @brief Calculates the identifier of the given callstack.
+ *
+ * Callstacks consisting of the same return addresses share the same identifier.
+ * The callstack is not translated.
+ *
+ * @param callstack the callstack
+ * @return the identifier of the callstack
+ */
+auto getStackId(lcs::callstack& callstack) -> std::uint64_t;
+
+/**
+ * @brief Calculates the identifier of the given callstack.
+ *
+ * Callstacks consisting of the same return addresses share the same identifier.
+ * The callstack is not translated.
+ *
+ * @param callstack the callstack
+ * @return the identifier of the callstack
+ */
+static inline auto getStackId(lcs::callstack&& callstack) -> std::uint64_t {
+    return getStackId(callstack);
+}
 }
 
 #endif /* callstackHelper_hpp */
@@ -0,0 +1,386 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "cow.hpp"
+
+#include "../lsanMisc.hpp"
+
+namespace lsan::cow {
+auto pageSize() -> std::size_t {
+    static const auto size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+#ifdef __linux__
+namespace {
+/** The flag of the pagemap entries of present pages.                */
+constexpr std::uint64_t present   = std::uint64_t(1) << 63;
+/** The flag of the pagemap entries of exclusively mapped pages.     */
+constexpr std::uint64_t exclusive = std::uint64_t(1) << 56;
+/** The maximum amount of pages checked by a scan.                   */
+constexpr std::size_t chunkSize   = 16384;
+
+/**
+ * Reads the pagemap entries of the given sorted pages.
+ *
+ * Consecutive pages are read at once. The entries of unreadable pages are zero.
+ *
+ * @param fd the file descriptor of the pagemap
+ * @param pages the pages to be read
+ * @param count the amount of pages
+ * @param entries the array to store the entries in
+ */
+static inline void readEntries(int fd, const std::uintptr_t* pages, std::size_t count, std::uint64_t* entries) {
+    const auto size = pageSize();
+    for (std::size_t i = 0; i < count;) {
+        std::size_t run = 1;
+        while (i + run < count && pages[i + run] == pages[i] + run * size) ++run;
+
+        const auto bytes = run * sizeof(std::uint64_t);
+        if (pread(fd, entries + i, bytes, static_cast<off_t>(pages[i] / size * sizeof(std::uint64_t))) != static_cast<ssize_t>(bytes)) {
+            std::fill(entries + i, entries + i + run, 0);
+        }
+        i += run;
+    }
+}
+
+/**
+ * Scans the copy-on-write breakage of a forked process.
+ */
+class Scanner {
+    /** Whether the scanning thread is allowed to run.               */
+    bool run = true;
+    /** The interval between the scans.                              */
+    const std::chrono::nanoseconds interval;
+    /** The file descriptor of the pagemap of this process.          */
+    const int fd;
+
+    /** The scanning thread.                                         */
+    std::thread scanThread;
+    /** The mutex protecting the scan results.                       */
+    std::mutex mutex;
+    /** The condition variable for the scanning thread to wait on.   */
+    std::condition_variable cv;
+
+    /** Whether the shared pages have been recorded.                 */
+    bool recorded = false;
+    /** The pages shared with the parent at the first scan, sorted.  */
+    std::vector<std::uintptr_t> pages;
+    /** Whether the respective page has been copied since the fork.  */
+    std::vector<bool> broken;
+    /** The index of the page the next scan starts at.               */
+    std::size_t cursor = 0;
+    /** The trackers left locked by threads not surviving the fork.  */
+    const std::vector<ATracker*> skipped;
+
+    /**
+     * @brief Records the pages of the tracked blocks shared with the parent.
+     *
+     * Pages already copied are counted as broken, assuming they were shared
+     * at the fork.
+     */
+    void record() {
+        const auto size = pageSize();
+
+        std::vector<std::uintptr_t> candidates;
+        getInstance().forEachTracker([this, &candidates, size](ATracker& tracker) {
+            if (std::find(skipped.begin(), skipped.end(), &tracker) != skipped.end()) return;
+
+            tracker.forEachRecord([&candidates, size](const MallocInfo& info) {
+                if (info.deleted || info.size == 0) return;
+
+                const auto begin = reinterpret_cast<std::uintptr_t>(info.pointer);
+                for (auto page = begin / size * size; page < begin + info.size; page += size) {
+                    candidates.push_back(page);
+                }
+            });
+        });
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        std::vector<std::uint64_t> entries(candidates.size());
+        readEntries(fd, candidates.data(), candidates.size(), entries.data());
+        for (std::size_t i = 0; i < candidates.size(); ++i) {
+            if ((entries[i] & present) == 0) continue;
+
+            pages.push_back(candidates[i]);
+            broken.push_back((entries[i] & exclusive) != 0);
+        }
+        recorded = true;
+    }
+
+    /**
+     * Checks the given amount of the shared pages for having been copied.
+     *
+     * @param count the maximum amount of pages to check
+     */
+    void scan(std::size_t count) {
+        count = std::min(count, pages.size());
+        std::vector<std::uint64_t> entries(std::min(count, chunkSize));
+        for (std::size_t done = 0; done < count;) {
+            if (cursor == pages.size()) {
+                cursor = 0;
+            }
+            const auto amount = std::min({ count - done, entries.size(), pages.size() - cursor });
+            readEntries(fd, pages.data() + cursor, amount, entries.data());
+            for (std::size_t i = 0; i < amount; ++i) {
+                if ((entries[i] & (present | exclusive)) == (present | exclusive)) {
+                    broken[cursor + i] = true;
+                }
+            }
+            cursor += amount;
+            done   += amount;
+        }
+    }
+
+    /**
+     * @brief The loop of the scanning thread.
+     *
+     * The shared pages are only recorded after the first interval, so that
+     * processes replaced by `exec` right after the fork are not scanned.
+     */
+    void scanner() {
+        getTracker().ignoreMalloc = true;
+
+        std::unique_lock lock { mutex };
+        while (true) {
+            cv.wait_for(lock, interval, [this] { return !run; });
+            if (!run) {
+                return;
+            }
+            if (recorded) {
+                scan(chunkSize);
+            } else {
+                record();
+            }
+        }
+    }
+
+public:
+    /**
+     * Constructs and starts a scanner.
+     *
+     * @param interval the interval between the scans
+     * @param skipped the trackers whose records cannot be read
+     */
+    inline Scanner(std::chrono::nanoseconds interval, std::vector<ATracker*>&& skipped):
+        interval(interval), fd(open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC)), skipped(std::move(skipped)) {
+        if (fd >= 0) {
+            scanThread = std::thread(&Scanner::scanner, this);
+        }
+    }
+
+    /**
+     * Returns whether the scanning thread has been started.
+     *
+     * @return whether this scanner is running
+     */
+    inline auto isRunning() const -> bool {
+        return fd >= 0;
+    }
+
+    /**
+     * Stops the scanning thread after a final complete scan.
+     */
+    inline void stop() {
+        {
+            std::lock_guard lock { mutex };
+            if (!run) return;
+
+            run = false;
+        }
+        cv.notify_all();
+        scanThread.join();
+
+        std::lock_guard lock { mutex };
+        if (recorded) {
+            scan(pages.size());
+        }
+        close(fd);
+    }
+
+    /**
+     * Returns the copy-on-write breakage found so far.
+     *
+     * @return the found breakage
+     */
+    inline auto getBreakage() -> Breakage {
+        std::lock_guard lock { mutex };
+
+        Breakage toReturn;
+        toReturn.sharedPages = pages.size();
+        for (std::size_t i = 0; i < pages.size(); ++i) {
+            if (broken[i]) {
+                toReturn.brokenPages.push_back(pages[i]);
+            }
+        }
+        return toReturn;
+    }
+};
+
+/**
+ * @brief The scanner of this process.
+ *
+ * It is never destroyed, as the copy-on-write breakage is reported after the
+ * static objects have been destroyed. An inherited scanner has no thread in
+ * the forked process and is left behind.
+ */
+Scanner* scanner = nullptr;
+
+/** The trackers whose info mutexes are held across the fork, never destroyed. */
+std::vector<ATracker*>* locked = nullptr;
+/** Whether the forking thread ignored allocations before the fork.              */
+thread_local bool ignored = false;
+
+/**
+ * Releases the allocation records locked before forking.
+ */
+void release() {
+    for (const auto& tracker : *locked) {
+        tracker->getInfoMutex().unlock();
+    }
+    locked->clear();
+}
+
+/**
+ * Attempts to lock the info mutexes of all allocation trackers.
+ *
+ * @return whether all of them have been locked
+ */
+static inline auto tryLockTrackers() -> bool {
+    bool success = true;
+    getInstance().forEachTracker([&success](ATracker& tracker) {
+        if (!success) return;
+
+        if (tracker.getInfoMutex().try_lock()) {
+            locked->push_back(&tracker);
+        } else {
+            success = false;
+        }
+    });
+    if (!success) {
+        release();
+    }
+    return success;
+}
+
+/**
+ * @brief Locks the allocation records of all threads before forking.
+ *
+ * The mutexes are only tried to be locked, since the allocating threads may
+ * hold more than one of them. The forking thread ignores its allocations until
+ * the mutexes are released again.
+ */
+void prepare() {
+    auto& tracker = getTracker();
+    ignored = tracker.ignoreMalloc;
+    tracker.ignoreMalloc = true;
+    if (locked == nullptr) {
+        locked = new std::vector<ATracker*>();
+    }
+    while (!tryLockTrackers()) {
+        std::this_thread::yield();
+    }
+}
+
+/**
+ * Releases the allocation records in the parent process.
+ */
+void parent() {
+    release();
+    getTracker().ignoreMalloc = ignored;
+}
+
+/**
+ * @brief Starts the scanning in the forked process.
+ *
+ * The trackers registered after the records have been locked may still be
+ * locked by a thread not surviving the fork; their records are not scanned.
+ */
+void forked() {
+    std::vector<ATracker*> skipped;
+    getInstance().forEachTracker([&skipped](ATracker& tracker) {
+        if (std::find(locked->begin(), locked->end(), &tracker) != locked->end()) return;
+
+        if (tracker.getInfoMutex().try_lock()) {
+            tracker.getInfoMutex().unlock();
+        } else {
+            skipped.push_back(&tracker);
+        }
+    });
+    release();
+
+    scanner = new Scanner(*getBehaviour().cowScan(), std::move(skipped));
+    if (!scanner->isRunning()) {
+        delete scanner;
+        scanner = nullptr;
+    }
+    getTracker().ignoreMalloc = ignored;
+}
+}
+
+void registerHandlers() {
+    static std::once_flag flag;
+    std::call_once(flag, [] {
+        pthread_atfork(prepare, parent, forked);
+    });
+}
+
+auto active() -> bool {
+    return scanner != nullptr;
+}
+
+void stop() {
+    if (scanner != nullptr) {
+        scanner->stop();
+    }
+}
+
+auto getBreakage() -> Breakage {
+    return scanner == nullptr ? Breakage() : scanner->getBreakage();
+}
+#else
+void registerHandlers() {}
+
+auto active() -> bool {
+    return false;
+}
+
+void stop() {}
+
+auto getBreakage() -> Breakage {
+    return Breakage();
+}
+#endif
+}
@@ -0,0 +1,84 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef cow_hpp
+#define cow_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief This namespace contains the copy-on-write breakage attribution of forked processes.
+ *
+ * If a scan interval is set, a background thread is started in every forked
+ * process. It records which of the pages of the tracked blocks are still shared
+ * with the parent process and periodically checks a part of them for having
+ * been copied by a write. Only available on Linux.
+ */
+namespace lsan::cow {
+/**
+ * This structure contains the copy-on-write breakage found by the scans.
+ */
+struct Breakage {
+    /** The amount of pages shared with the parent at the first scan.       */
+    std::size_t sharedPages = 0;
+    /** The sorted addresses of the shared pages copied since the fork.      */
+    std::vector<std::uintptr_t> brokenPages;
+};
+
+/**
+ * @brief Registers the handlers starting the scans in forked processes.
+ *
+ * The records of all threads are locked across a fork while the handlers are
+ * registered. Should only be called if a scan interval is set.
+ */
+void registerHandlers();
+
+/**
+ * Returns whether the calling process is a forked one being scanned.
+ *
+ * @return whether the copy-on-write breakage is scanned
+ */
+auto active() -> bool;
+
+/**
+ * Stops the scanning thread after a final complete scan.
+ */
+void stop();
+
+/**
+ * Returns the copy-on-write breakage found so far.
+ *
+ * @return the found breakage
+ */
+auto getBreakage() -> Breakage;
+
+/**
+ * Returns the size of the pages in bytes.
+ *
+ * @return the page size
+ */
+auto pageSize() -> std::size_t;
+}
+
+#endif /* cow_hpp */
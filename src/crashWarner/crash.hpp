@@ -60,6 +60,49 @@ void crash(const std::string & message);
                                const std::optional<std::string>& reason,
                                      lcs::callstack&&            callstack);
 
+/**
+ * @brief Terminates the linked program and prints the given message, the optionally given
+ * reason, the given callstack and the information of the given allocation record.
+ *
+ * This function performs the termination in any case.
+ *
+ * @param message the message to be printed
+ * @param reason the optional reason
+ * @param info the allocation record of the affected allocation
+ * @param callstack the callstack
+ */
+[[ noreturn ]] void crashForce(const std::string&                message,
+                               const std::optional<std::string>& reason,
+                               const MallocInfo&                 info,
+                                     lcs::callstack&&            callstack);
+
+/**
+ * Prints the given message, the optionally given reason and the given callstack
+ * as a crash report without terminating the linked program.
+ *
+ * @param message the message to be printed
+ * @param reason the optional reason
+ * @param callstack the callstack
+ */
+void printCrash(const std::string&                message,
+                const std::optional<std::string>& reason,
+                      lcs::callstack&&            callstack);
+
+/**
+ * Prints the given message, the optionally given reason, the given callstack and
+ * the information of the given allocation record as a crash report without
+ * terminating the linked program.
+ *
+ * @param message the message to be printed
+ * @param reason the optional reason
+ * @param info the allocation record of the affected allocation
+ * @param callstack the callstack
+ */
+void printCrash(const std::string&                message,
+                const std::optional<std::string>& reason,
+                const MallocInfo&                 info,
+                      lcs::callstack&&            callstack);
+
 /**
  * @brief Terminates the linked program and prints the given message, the information
  * provided by the optional allocation record and a callstack.
@@ -28,6 +28,7 @@
 #include "../lsanMisc.hpp"
 #include "../formatter.hpp"
 #include "../callstacks/callstackHelper.hpp"
+#include "../probes/probes.hpp"
 
 namespace lsan {
 /**
@@ -79,15 +80,17 @@ constexpr static inline void printer(const std::string & message, lcs::callstack
  * @param message the message to be printed
  * @param info the optional allocation record
  * @param callstack the callstack to be printed
+ * @param reason the optional reason for the message
  * @tparam Warning whether to use warning formatting
  */
 template<bool Warning>
 constexpr static inline void printer(const std::string&                     message,
                                      const std::optional<MallocInfo::CRef>& info,
-                                     lcs::callstack&                        callstack) {
+                                     lcs::callstack&                        callstack,
+                                     const std::optional<std::string>&      reason = std::nullopt) {
     using formatter::Style;
     
-    printer<Warning, false>(message, callstack);
+    printer<Warning, false>(message, callstack, reason);
 
     if (info.has_value()) {
         constexpr const auto colour = Warning ? Style::MAGENTA : Style::RED;
@@ -125,6 +128,7 @@ static inline void withCallstack(const F & function) {
 
 void warn(const std::string & message) {
     withCallstack([&] (auto & callstack) {
+        LSAN_PROBE(warning, message.c_str(), static_cast<void*>(nullptr), callstackHelper::getStackId(callstack), probes::threadId());
         printer<true>(message, callstack);
     });
 }
@@ -132,6 +136,8 @@ void warn(const std::string & message) {
 void warn(const std::string& message,
           const std::optional<MallocInfo::CRef>& info) {
     withCallstack([&] (auto& callstack) {
+        LSAN_PROBE(warning, message.c_str(), info ? info->get().pointer : nullptr,
+                   callstackHelper::getStackId(callstack), probes::threadId());
         printer<true>(message, info, callstack);
     });
 }
@@ -148,8 +154,21 @@ void crashForce(const std::string & message) {
     abort();
 }
 
-void crashForce(const std::string& message, const std::optional<std::string>& reason, lcs::callstack&& callstack) {
+void printCrash(const std::string& message, const std::optional<std::string>& reason, lcs::callstack&& callstack) {
     printer<false>(message, callstack, reason);
+}
+
+void printCrash(const std::string& message, const std::optional<std::string>& reason, const MallocInfo& info, lcs::callstack&& callstack) {
+    printer<false>(message, std::cref(info), callstack, reason);
+}
+
+void crashForce(const std::string& message, const std::optional<std::string>& reason, lcs::callstack&& callstack) {
+    printCrash(message, reason, std::move(callstack));
+    abort();
+}
+
+void crashForce(const std::string& message, const std::optional<std::string>& reason, const MallocInfo& info, lcs::callstack&& callstack) {
+    printCrash(message, reason, info, std::move(callstack));
     abort();
 }
 
@@ -19,7 +19,6 @@
  * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <cxxabi.h>
 #include <exception>
 #include <sstream>
 #include <typeinfo>
@@ -30,25 +29,9 @@
 #include "exceptionHandler.hpp"
 
 #include "../lsanMisc.hpp"
+#include "../utils.hpp"
 
 namespace lsan {
-/**
- * Demangles the given C string.
- *
- * @param string the string to be demangled
- * @return the possibly demangled string
- */
-static inline auto demangle(const char * string) noexcept -> std::string {
-    int status;
-    const char * result = abi::__cxa_demangle(string, nullptr, nullptr, &status);
-    if (result == nullptr || result == string) {
-        return string;
-    }
-    std::string toReturn = result;
-    std::free(const_cast<char *>(result));
-    return toReturn;
-}
-
 /**
  * Handles the given standard exception.
  *
@@ -56,7 +39,7 @@ static inline auto demangle(const char * string) noexcept -> std::string {
  */
 [[ noreturn ]] static inline void handleException(std::exception & exception) noexcept {
     std::stringstream stream;
-    stream << "Uncaught exception of type " << demangle(typeid(exception).name()) << ": \"" << exception.what() << "\"";
+    stream << "Uncaught exception of type " << utils::demangle(typeid(exception).name()) << ": \"" << exception.what() << "\"";
     
     crashForce(stream.str());
 }
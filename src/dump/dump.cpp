@@ -0,0 +1,335 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+ #include <mach-o/dyld.h>
+ #include <mach-o/loader.h>
+#else
+ #include <link.h>
+#endif
+
+#include <lsan_dump.h>
+
+#include "dump.hpp"
+
+#include "../callstacks/callstackHelper.hpp"
+#include "../recorder/recorder.hpp"
+
+namespace lsan::dump {
+/**
+ * This class writes a file sequentially using a buffer.
+ */
+class Writer {
+    /** The file descriptor to write to.          */
+    const int fd;
+    /** The buffered bytes.                       */
+    std::vector<char> buffer;
+    /** The amount of bytes written so far.       */
+    std::uint64_t offset = 0;
+    /** Whether writing has failed.               */
+    bool failed = false;
+
+    /**
+     * Writes the buffered bytes to the file.
+     */
+    void flushBuffer() {
+        for (std::size_t written = 0; !failed && written < buffer.size();) {
+            const auto count = ::write(fd, buffer.data() + written, buffer.size() - written);
+            if (count < 0) {
+                failed = true;
+            } else {
+                written += static_cast<std::size_t>(count);
+            }
+        }
+        buffer.clear();
+    }
+
+public:
+    /** The size of the buffer. */
+    static constexpr std::size_t bufferSize = 1 << 16;
+
+    inline explicit Writer(int fd): fd(fd) {
+        buffer.reserve(bufferSize);
+    }
+
+    /**
+     * Appends the given bytes.
+     *
+     * @param data the bytes to be written
+     * @param size the amount of bytes
+     */
+    void write(const void* data, std::size_t size) {
+        const auto bytes = static_cast<const char*>(data);
+        offset += size;
+        if (buffer.size() + size > bufferSize) {
+            flushBuffer();
+        }
+        if (size > bufferSize) {
+            buffer.assign(bytes, bytes + size);
+            flushBuffer();
+        } else {
+            buffer.insert(buffer.end(), bytes, bytes + size);
+        }
+    }
+
+    /**
+     * Appends the given records.
+     *
+     * @param records the records to be written
+     */
+    template<typename T>
+    inline void write(const std::vector<T>& records) {
+        write(records.data(), records.size() * sizeof(T));
+    }
+
+    /**
+     * Pads the written bytes to a multiple of eight.
+     */
+    inline void align() {
+        static constexpr char zeros[8] {};
+        write(zeros, (8 - offset % 8) % 8);
+    }
+
+    /**
+     * Writes the buffered bytes to the file.
+     *
+     * @return whether all bytes have been written successfully
+     */
+    inline auto finish() -> bool {
+        flushBuffer();
+        return !failed;
+    }
+
+    /**
+     * Returns the amount of bytes written so far.
+     *
+     * @return the offset of the next byte
+     */
+    constexpr inline auto getOffset() const -> std::uint64_t {
+        return offset;
+    }
+};
+
+/**
+ * This class contains the string table of a dump.
+ */
+class Strings {
+    /** The offsets of the already added strings. */
+    std::unordered_map<std::string, std::uint64_t> offsets;
+    /** The string table.                         */
+    std::string table;
+
+public:
+    /**
+     * Adds the given string to the table.
+     *
+     * @param string the string to be added
+     * @return the offset of the string in the table
+     */
+    auto add(const std::string& string) -> std::uint64_t {
+        const auto& [it, inserted] = offsets.try_emplace(string, table.size());
+        if (inserted) {
+            table.append(string.c_str(), string.size() + 1);
+        }
+        return it->second;
+    }
+
+    /**
+     * Returns the string table.
+     *
+     * @return the string table
+     */
+    constexpr inline auto get() const -> const std::string& {
+        return table;
+    }
+};
+
+/**
+ * Returns the amount of ticks of the recorder clock per second.
+ *
+ * @return the measured ticks per second
+ */
+static inline auto measureTicksPerSecond() -> std::uint64_t {
+    using namespace std::chrono;
+
+    const auto start      = steady_clock::now();
+    const auto startTicks = recorder::timestamp();
+    std::this_thread::sleep_for(milliseconds(10));
+    const auto ticks   = recorder::timestamp() - startTicks;
+    const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    return elapsed <= 0 ? 0 : static_cast<std::uint64_t>(static_cast<double>(ticks) * 1e9 / static_cast<double>(elapsed));
+}
+
+/**
+ * Collects the loaded modules.
+ *
+ * @param strings the string table to add the paths to
+ * @return the loaded modules
+ */
+static inline auto collectModules(Strings& strings) -> std::vector<__lsan_dumpModule> {
+    std::vector<__lsan_dumpModule> modules;
+#ifdef __APPLE__
+    for (std::uint32_t i = 0; i < _dyld_image_count(); ++i) {
+        const auto header = reinterpret_cast<const mach_header_64*>(_dyld_get_image_header(i));
+        const auto slide  = static_cast<std::uint64_t>(_dyld_get_image_vmaddr_slide(i));
+        auto command      = reinterpret_cast<const load_command*>(header + 1);
+        std::uint64_t begin = UINT64_MAX, end = 0;
+        for (std::uint32_t j = 0; j < header->ncmds; ++j) {
+            if (command->cmd == LC_SEGMENT_64) {
+                const auto segment = reinterpret_cast<const segment_command_64*>(command);
+                if (segment->vmsize > 0 && std::strcmp(segment->segname, SEG_PAGEZERO) != 0) {
+                    begin = std::min(begin, segment->vmaddr + slide);
+                    end   = std::max(end,   segment->vmaddr + slide + segment->vmsize);
+                }
+            }
+            command = reinterpret_cast<const load_command*>(reinterpret_cast<const char*>(command) + command->cmdsize);
+        }
+        if (begin < end) {
+            modules.push_back({ begin, end, strings.add(_dyld_get_image_name(i)) });
+        }
+    }
+#else
+    std::vector<std::pair<std::pair<std::uint64_t, std::uint64_t>, std::string>> found;
+    dl_iterate_phdr([](dl_phdr_info* info, std::size_t, void* data) {
+        std::uint64_t begin = UINT64_MAX, end = 0;
+        for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+            const auto& header = info->dlpi_phdr[i];
+            if (header.p_type != PT_LOAD) continue;
+
+            begin = std::min<std::uint64_t>(begin, info->dlpi_addr + header.p_vaddr);
+            end   = std::max<std::uint64_t>(end,   info->dlpi_addr + header.p_vaddr + header.p_memsz);
+        }
+        if (begin < end) {
+            std::string path = info->dlpi_name == nullptr ? "" : info->dlpi_name;
+            if (path.empty()) {
+                char buffer[4096];
+                const auto length = readlink("/proc/self/exe", buffer, sizeof(buffer));
+                path = length > 0 ? std::string(buffer, static_cast<std::size_t>(length)) : "<< Unknown >>";
+            }
+            static_cast<decltype(found)*>(data)->push_back({ { begin, end }, path });
+        }
+        return 0;
+    }, &found);
+    for (const auto& [range, path] : found) {
+        modules.push_back({ range.first, range.second, strings.add(path) });
+    }
+#endif
+    return modules;
+}
+
+auto write(LSan& instance, const char* path, bool contents) -> bool {
+    const auto fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    __lsan_dumpHeader header {};
+    std::memcpy(header.magic, LSAN_DUMP_MAGIC, sizeof(header.magic));
+    header.version        = LSAN_DUMP_VERSION;
+    header.flags          = contents ? LSAN_DUMP_CONTENTS : 0;
+    header.ticksPerSecond = measureTicksPerSecond();
+
+    Writer writer(fd);
+    writer.write(&header, sizeof(header));
+
+    std::vector<__lsan_dumpBlock> blocks;
+    std::vector<lcs::callstack> callstacks;
+    std::vector<std::uint64_t> ids;
+    std::unordered_map<std::uint64_t, std::uint32_t> stacks;
+    header.timestamp = recorder::timestamp();
+    instance.forEachRecordOfAllTrackers([&](const MallocInfo& info) {
+        if (info.deleted) return;
+
+        const auto id = info.getStackId();
+        const auto& [it, inserted] = stacks.try_emplace(id, static_cast<std::uint32_t>(callstacks.size()));
+        if (inserted) {
+            callstacks.push_back(info.createdCallstack);
+            ids.push_back(id);
+        }
+        auto offset = UINT64_MAX;
+        if (contents) {
+            // The block cannot be deallocated while the info mutex of its tracker is held.
+            offset = writer.getOffset();
+            writer.write(info.pointer, info.size);
+            writer.align();
+        }
+        blocks.push_back({
+            reinterpret_cast<std::uintptr_t>(info.pointer), info.size, info.timestamp, offset, it->second, info.thread
+        });
+    });
+    std::sort(blocks.begin(), blocks.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.address < rhs.address;
+    });
+
+    Strings strings;
+    std::vector<__lsan_dumpStack> stackRecords;
+    std::vector<__lsan_dumpFrame> frames;
+    {
+        std::vector<std::reference_wrapper<lcs::callstack>> references(callstacks.begin(), callstacks.end());
+        const callstackHelper::Translations translations { references };
+        for (std::size_t i = 0; i < callstacks.size(); ++i) {
+            const struct callstack* raw = callstacks[i];
+            const auto& names = callstackHelper::getFrameNames(callstacks[i]);
+            stackRecords.push_back({ ids[i], static_cast<std::uint32_t>(frames.size()), static_cast<std::uint32_t>(raw->backtraceSize) });
+            for (std::size_t j = 0; j < raw->backtraceSize; ++j) {
+                frames.push_back({
+                    reinterpret_cast<std::uintptr_t>(raw->backtrace[j]),
+                    strings.add(j < names.size() ? names[j] : "<< Unknown >>")
+                });
+            }
+        }
+    }
+    const auto& modules = collectModules(strings);
+
+    header.blockCount  = blocks.size();
+    header.blockOffset = writer.getOffset();
+    writer.write(blocks);
+    header.stackCount  = stackRecords.size();
+    header.stackOffset = writer.getOffset();
+    writer.write(stackRecords);
+    header.frameCount  = frames.size();
+    header.frameOffset = writer.getOffset();
+    writer.write(frames);
+    header.moduleCount  = modules.size();
+    header.moduleOffset = writer.getOffset();
+    writer.write(modules);
+    header.stringsSize   = strings.get().size();
+    header.stringsOffset = writer.getOffset();
+    writer.write(strings.get().data(), strings.get().size());
+    writer.align();
+
+    auto success = writer.finish() && pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+    success = close(fd) == 0 && success;
+    return success;
+}
+}
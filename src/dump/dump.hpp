@@ -0,0 +1,46 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef dump_hpp
+#define dump_hpp
+
+#include "../LeakSani.hpp"
+
+/**
+ * @brief This namespace contains the writing of the heap dumps.
+ *
+ * The format is described in `lsan_dump.h`.
+ */
+namespace lsan::dump {
+/**
+ * @brief Writes the live allocations of all trackers of the given instance to the file at the given path.
+ *
+ * The info mutexes of the trackers are locked while their records are written.
+ *
+ * @param instance the sanitizer instance
+ * @param path the path of the file to be written
+ * @param contents whether to include the contents of the blocks
+ * @return whether the dump was written successfully
+ */
+auto write(LSan& instance, const char* path, bool contents) -> bool;
+}
+
+#endif /* dump_hpp */
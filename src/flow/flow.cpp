@@ -0,0 +1,252 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <pthread.h>
+
+#ifdef __APPLE__
+ #include <libproc.h>
+#else
+ #include <sys/syscall.h>
+#endif
+
+#include "flow.hpp"
+
+namespace lsan::flow {
+thread_local std::uint8_t  slot       = 0;
+thread_local std::uint16_t generation = 0;
+
+std::atomic<std::uint64_t> counts[capacity][capacity] {};
+std::atomic<std::uint64_t> bytes[capacity][capacity] {};
+
+/** The indices not owned by a running thread, one bit each.   */
+static std::atomic<std::uint64_t> available = ~std::uint64_t(0) >> (64 - (capacity - 1));
+/** The highest index handed out so far plus one.              */
+static std::atomic_size_t used = 0;
+/** The key used to release the indices of the exiting threads. */
+static pthread_key_t key;
+/** Ensures the key is only created once.                      */
+static pthread_once_t keyOnce = PTHREAD_ONCE_INIT;
+/** The amount of times the indices have been assigned.        */
+static std::atomic<std::uint16_t> generations[capacity] {};
+/** The system identifiers of the threads by index.            */
+static std::atomic<std::uint64_t> ids[capacity] {};
+/** The names of the threads whose counts have been added.     */
+static char names[capacity][64] {};
+/** The name of the last exited thread by index.               */
+static char exitedNames[capacity][64] {};
+/** The generation of the last exited thread by index.         */
+static std::uint16_t exitedGenerations[capacity] {};
+/** The mutex protecting the names of the threads.             */
+static std::mutex namesMutex;
+
+std::atomic<std::uint16_t> named[capacity] {};
+std::atomic_bool shared[capacity] {};
+
+/**
+ * Returns the system identifier of the calling thread.
+ *
+ * @return the identifier of the calling thread
+ */
+static inline auto currentId() noexcept -> std::uint64_t {
+#ifdef __APPLE__
+    std::uint64_t id = 0;
+    pthread_threadid_np(nullptr, &id);
+    return id;
+#else
+    return static_cast<std::uint64_t>(syscall(SYS_gettid));
+#endif
+}
+
+/**
+ * Looks up the name of the thread with the given system identifier.
+ *
+ * @param id the system identifier of the thread
+ * @param buffer the buffer to store the name in
+ * @param size the size of the buffer
+ * @return whether the thread was found
+ */
+static inline auto lookupName(std::uint64_t id, char* buffer, std::size_t size) -> bool {
+#ifdef __APPLE__
+    proc_threadinfo info;
+    if (proc_pidinfo(getpid(), PROC_PIDTHREADID64INFO, id, &info, sizeof(info)) != sizeof(info)) {
+        return false;
+    }
+    std::snprintf(buffer, size, "%s", info.pth_name);
+    return true;
+#else
+    char path[64];
+    std::snprintf(path, sizeof(path), "/proc/self/task/%llu/comm", static_cast<unsigned long long>(id));
+    const auto fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    const auto count = read(fd, buffer, size - 1);
+    close(fd);
+    if (count < 0) {
+        return false;
+    }
+    buffer[count] = '\0';
+    if (count > 0 && buffer[count - 1] == '\n') {
+        buffer[count - 1] = '\0';
+    }
+    return true;
+#endif
+}
+
+/**
+ * Releases the index of an exiting thread, remembering its name.
+ *
+ * @param value the index of the thread plus one
+ */
+static void release(void* value) {
+    const auto index = reinterpret_cast<std::uintptr_t>(value) - 1;
+    slot = 0;
+    {
+        std::lock_guard lock(namesMutex);
+        if (!lookupName(ids[index].load(std::memory_order_acquire), exitedNames[index], sizeof(exitedNames[index]))) {
+            exitedNames[index][0] = '\0';
+        }
+        exitedGenerations[index] = generation;
+        if (named[index].load(std::memory_order_relaxed) == generation) {
+            std::snprintf(names[index], sizeof(names[index]), "%s", exitedNames[index]);
+        }
+    }
+    available.fetch_or(std::uint64_t(1) << index, std::memory_order_release);
+}
+
+/**
+ * Creates the key used to release the indices of the exiting threads.
+ */
+static void createKey() {
+    pthread_key_create(&key, release);
+}
+
+auto assignIndex() noexcept -> std::uint8_t {
+    std::size_t index = capacity - 1;
+    auto free = available.load(std::memory_order_relaxed);
+    while (free != 0) {
+        if (available.compare_exchange_weak(free, free & (free - 1), std::memory_order_acquire, std::memory_order_relaxed)) {
+            index = static_cast<std::size_t>(__builtin_ctzll(free));
+            break;
+        }
+    }
+    auto expected = used.load(std::memory_order_relaxed);
+    while (index >= expected && !used.compare_exchange_weak(expected, index + 1, std::memory_order_relaxed));
+
+    generation = static_cast<std::uint16_t>(generations[index].fetch_add(1, std::memory_order_relaxed) + 1);
+    slot       = static_cast<std::uint8_t>(index + 1);
+    if (index < capacity - 1) {
+        ids[index].store(currentId(), std::memory_order_release);
+        pthread_once(&keyOnce, createKey);
+        pthread_setspecific(key, reinterpret_cast<void*>(index + 1));
+    }
+    return static_cast<std::uint8_t>(index);
+}
+
+/**
+ * Returns the name of the thread with the given index.
+ *
+ * @param index the index of the thread
+ * @return the name of the thread
+ */
+static inline auto nameOf(std::size_t index) -> std::string {
+    if (index == capacity - 1) {
+        return "other threads";
+    }
+    if (shared[index].load(std::memory_order_relaxed)) {
+        return std::to_string(generations[index].load(std::memory_order_relaxed)) + " threads";
+    }
+    std::lock_guard lock(namesMutex);
+    // Only the running owner of the named generation is looked up again.
+    if (const auto id = ids[index].load(std::memory_order_acquire);
+        id != 0 && generations[index].load(std::memory_order_relaxed) == named[index].load(std::memory_order_relaxed)
+        && (available.load(std::memory_order_relaxed) & std::uint64_t(1) << index) == 0) {
+        lookupName(id, names[index], sizeof(names[index]));
+    }
+    return names[index][0] != '\0' ? names[index] : "exited thread";
+}
+
+/**
+ * Remembers the name of the given generation of the given index, or marks
+ * the index as shared if the counts of another generation have already been added.
+ *
+ * @param index the index of the thread
+ * @param generation the generation of the index
+ */
+static inline void rememberName(std::uint8_t index, std::uint16_t generation) {
+    if (index == capacity - 1 || shared[index].load(std::memory_order_relaxed)) return;
+
+    const auto current = named[index].load(std::memory_order_relaxed);
+    if (current == generation) return;
+    if (current != 0) {
+        shared[index].store(true, std::memory_order_relaxed);
+        return;
+    }
+    named[index].store(generation, std::memory_order_relaxed);
+    if (generations[index].load(std::memory_order_relaxed) == generation) {
+        if (!lookupName(ids[index].load(std::memory_order_acquire), names[index], sizeof(names[index]))) {
+            names[index][0] = '\0';
+        }
+    } else if (exitedGenerations[index] == generation) {
+        std::snprintf(names[index], sizeof(names[index]), "%s", exitedNames[index]);
+    } else {
+        names[index][0] = '\0';
+    }
+}
+
+void rememberNames(std::uint8_t from, std::uint16_t fromGeneration, std::uint8_t to, std::uint16_t toGeneration) {
+    std::lock_guard lock(namesMutex);
+    rememberName(from, fromGeneration);
+    rememberName(to, toGeneration);
+}
+
+auto collect() -> std::vector<Flow> {
+    std::vector<std::string> threadNames(capacity);
+    const auto count = used.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < count; ++i) {
+        threadNames[i] = nameOf(i);
+    }
+
+    std::vector<Flow> toReturn;
+    for (std::size_t from = 0; from < capacity; ++from) {
+        for (std::size_t to = 0; to < capacity; ++to) {
+            const auto count = counts[from][to].load(std::memory_order_relaxed);
+            if (count == 0) continue;
+
+            toReturn.push_back({
+                from, to, threadNames[from], threadNames[to],
+                count, bytes[from][to].load(std::memory_order_relaxed)
+            });
+        }
+    }
+    std::sort(toReturn.begin(), toReturn.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.bytes > rhs.bytes;
+    });
+    return toReturn;
+}
+}
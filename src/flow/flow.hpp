@@ -0,0 +1,166 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef flow_hpp
+#define flow_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief This namespace contains the heap flow between the threads.
+ *
+ * Every thread is given an index on its first allocation, which is stored in
+ * the allocation records. A block deallocated by another thread than the one
+ * that allocated it is counted in a matrix indexed by the allocating and the
+ * deallocating thread. The counters are updated without locking.
+ *
+ * The index of an exited thread is given to the next thread needing one, so
+ * the counters of an index sum up all threads that have had it. The threads
+ * having had the same index are told apart by the generation of the index.
+ */
+namespace lsan::flow {
+/** The amount of indices, the threads beyond share the last one. */
+static constexpr std::size_t capacity = 64;
+
+/** The index of the calling thread plus one or zero if not yet assigned. */
+extern thread_local std::uint8_t  slot       __attribute__((tls_model("initial-exec")));
+/** The generation of the index of the calling thread.                   */
+extern thread_local std::uint16_t generation __attribute__((tls_model("initial-exec")));
+
+/** The amount of deallocated blocks by allocating and deallocating thread. */
+extern std::atomic<std::uint64_t> counts[capacity][capacity];
+/** The deallocated bytes by allocating and deallocating thread.            */
+extern std::atomic<std::uint64_t> bytes[capacity][capacity];
+
+/**
+ * Assigns the lowest free index to the calling thread, which is
+ * released again when the thread exits.
+ *
+ * @return the assigned index
+ */
+auto assignIndex() noexcept -> std::uint8_t;
+
+/**
+ * Returns the index of the calling thread.
+ *
+ * @return the index of the calling thread
+ */
+static inline auto threadIndex() noexcept -> std::uint8_t {
+    return slot != 0 ? slot - 1 : assignIndex();
+}
+
+/**
+ * @brief Returns the generation of the index of the calling thread.
+ *
+ * Tells apart the threads that have had the same index, including the ones
+ * sharing the last index. Only meaningful once the calling thread has an index.
+ *
+ * @return the generation of the index of the calling thread
+ */
+static inline auto threadGeneration() noexcept -> std::uint16_t {
+    return generation;
+}
+
+/** The generation of each index whose counts have been added first, zero if none. */
+extern std::atomic<std::uint16_t> named[capacity];
+/** Whether the counts of more than one generation have been added by index.        */
+extern std::atomic_bool shared[capacity];
+
+/**
+ * Remembers the names of the threads with the given indices and generations.
+ *
+ * @param from the index of the allocating thread
+ * @param fromGeneration the generation of the index of the allocating thread
+ * @param to the index of the deallocating thread
+ * @param toGeneration the generation of the index of the deallocating thread
+ */
+void rememberNames(std::uint8_t from, std::uint16_t fromGeneration, std::uint8_t to, std::uint16_t toGeneration);
+
+/**
+ * Returns whether the counts of the given generation of the given index are
+ * already attributed to a name.
+ *
+ * @param index the index of the thread
+ * @param generation the generation of the index
+ * @return whether the name is known
+ */
+static inline auto isNamed(std::uint8_t index, std::uint16_t generation) noexcept -> bool {
+    return index == capacity - 1 || shared[index].load(std::memory_order_relaxed)
+        || named[index].load(std::memory_order_relaxed) == generation;
+}
+
+/**
+ * @brief Counts the deallocation of a block by another thread than the allocating one.
+ *
+ * The names of the two threads are remembered together with the generation
+ * of their index when their counts are added first, so they are known even
+ * after the threads have exited. An index whose counts were added by more
+ * than one thread is reported by the amount of threads that have had it.
+ *
+ * @param from the index of the allocating thread
+ * @param fromGeneration the generation of the index of the allocating thread
+ * @param to the index of the deallocating thread
+ * @param toGeneration the generation of the index of the deallocating thread
+ * @param size the size of the deallocated block
+ */
+static inline void add(std::uint8_t from, std::uint16_t fromGeneration, std::uint8_t to, std::uint16_t toGeneration, std::size_t size) {
+    bytes[from][to].fetch_add(size, std::memory_order_relaxed);
+    counts[from][to].fetch_add(1, std::memory_order_relaxed);
+    if (!isNamed(from, fromGeneration) || !isNamed(to, toGeneration)) {
+        rememberNames(from, fromGeneration, to, toGeneration);
+    }
+}
+
+/**
+ * This structure contains the blocks of one thread deallocated by another one.
+ */
+struct Flow {
+    /** The index of the allocating thread.   */
+    std::size_t from;
+    /** The index of the deallocating thread. */
+    std::size_t to;
+    /** The name of the allocating thread.    */
+    std::string fromName;
+    /** The name of the deallocating thread.  */
+    std::string toName;
+    /** The amount of deallocated blocks.     */
+    std::uint64_t count;
+    /** The deallocated bytes.                */
+    std::uint64_t bytes;
+};
+
+/**
+ * @brief Collects the heap flow between the threads, sorted by the bytes.
+ *
+ * The names of the threads still running are refreshed, the exited
+ * threads keep the name they had when it was last looked up. The indices
+ * shared by more than one thread are named by the amount of threads.
+ *
+ * @return the heap flow between the threads
+ */
+auto collect() -> std::vector<Flow>;
+}
+
+#endif /* flow_hpp */
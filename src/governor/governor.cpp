@@ -0,0 +1,353 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#include <callstack.h>
+
+#ifdef __APPLE__
+ #include <mach/mach.h>
+#else
+ #include <fcntl.h>
+ #include <unistd.h>
+#endif
+
+#include "governor.hpp"
+
+#include "../lsanMisc.hpp"
+#include "../allocators/ObjectPool.hpp"
+
+namespace lsan::governor {
+std::atomic_bool started = false;
+std::atomic_bool active = false;
+std::atomic<std::uint64_t> hookTime = 0;
+std::atomic_size_t captureDepth = CALLSTACK_BACKTRACE_SIZE;
+std::atomic_size_t sampleFactor = 1;
+std::atomic_bool deletionStacks = true;
+std::atomic_bool warnings = true;
+thread_local std::uint32_t hookCalls = 0;
+
+namespace {
+/** The interval between two checks of the overhead.          */
+static constexpr auto interval = std::chrono::milliseconds(500);
+/** The smallest amount of frames captured for the callstacks. */
+static constexpr std::size_t minimalDepth = 16;
+/** The largest factor the guarded sample rate is scaled with. */
+static constexpr std::size_t maximalFactor = 16;
+
+/**
+ * Returns the CPU time consumed by this process so far.
+ *
+ * @return the consumed CPU time in nanoseconds
+ */
+static inline auto cpuTime() -> std::uint64_t {
+    timespec time;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time) != 0) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>(time.tv_sec) * 1000000000 + static_cast<std::uint64_t>(time.tv_nsec);
+}
+
+/**
+ * @brief Returns the size of the resident set of this process.
+ *
+ * Does not allocate.
+ *
+ * @return the resident set size in bytes or zero if unavailable
+ */
+static inline auto residentBytes() -> std::size_t {
+#ifdef __APPLE__
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.resident_size;
+#else
+    const auto fd = open("/proc/self/statm", O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    char buffer[128];
+    const auto length = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (length <= 0) {
+        return 0;
+    }
+    buffer[length] = '\0';
+
+    // The second field contains the resident pages.
+    std::size_t i = 0;
+    while (i < static_cast<std::size_t>(length) && buffer[i] != ' ') ++i;
+    std::size_t pages = 0;
+    for (++i; i < static_cast<std::size_t>(length) && buffer[i] >= '0' && buffer[i] <= '9'; ++i) {
+        pages = pages * 10 + static_cast<std::size_t>(buffer[i] - '0');
+    }
+    return pages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+/**
+ * Controls the overhead of the tracking using a background thread.
+ */
+class Governor {
+    /** Whether the governor thread is allowed to run.              */
+    bool run = true;
+    /** The overhead budget in percent.                             */
+    double budget = 0;
+
+    /** The governor thread.                                        */
+    std::thread governorThread;
+    /** The mutex to synchronize with the governor thread.          */
+    std::mutex mutex;
+    /** The condition variable for the governor thread to wait on.  */
+    std::condition_variable cv;
+    /** Whether the governor thread is actually running.            */
+    bool threadRunning = false;
+
+    /** The mutex protecting the recorded adjustments.              */
+    std::mutex adjustmentMutex;
+    /** The most recent adjustments.                                */
+    Adjustment adjustments[adjustmentCapacity];
+    /** The total amount of adjustments made.                       */
+    std::size_t adjustmentCount = 0;
+    /** The most recently measured hook overhead in percent.        */
+    double overhead = 0;
+    /** The most recently measured internal memory in percent.      */
+    double memory = 0;
+
+    /**
+     * Records the given adjustment.
+     *
+     * @param knob the adjusted setting
+     * @param from the previous value
+     * @param to the new value
+     */
+    inline void record(Knob knob, std::size_t from, std::size_t to) {
+        std::lock_guard lock { adjustmentMutex };
+        adjustments[adjustmentCount++ % adjustmentCapacity] = { std::chrono::system_clock::now(), knob, from, to, overhead, memory };
+    }
+
+    /**
+     * @brief Degrades the tracking by one step.
+     *
+     * The guarded sampling is thinned out first, followed by the deallocation
+     * callstacks, the capture depth and finally the warning checks.
+     */
+    inline void degrade() {
+        if (const auto factor = getSampleFactor(); getBehaviour().guardedSampleRate() != 0 && factor < maximalFactor) {
+            sampleFactor.store(factor * 2, std::memory_order_relaxed);
+            record(Knob::SAMPLE_RATE, factor, factor * 2);
+        } else if (captureDeletions()) {
+            deletionStacks.store(false, std::memory_order_relaxed);
+            record(Knob::DELETION_STACKS, true, false);
+        } else if (const auto depth = getCaptureDepth(); depth > minimalDepth) {
+            captureDepth.store(std::max(depth / 2, minimalDepth), std::memory_order_relaxed);
+            record(Knob::CAPTURE_DEPTH, depth, std::max(depth / 2, minimalDepth));
+        } else if (checkWarnings()) {
+            warnings.store(false, std::memory_order_relaxed);
+            record(Knob::WARNINGS, true, false);
+        }
+    }
+
+    /**
+     * Restores the tracking by one step, in the reverse order of the degradation.
+     */
+    inline void recover() {
+        if (!checkWarnings()) {
+            warnings.store(true, std::memory_order_relaxed);
+            record(Knob::WARNINGS, false, true);
+        } else if (const auto depth = getCaptureDepth(); depth < CALLSTACK_BACKTRACE_SIZE) {
+            const auto newDepth = std::min<std::size_t>(depth * 2, CALLSTACK_BACKTRACE_SIZE);
+            captureDepth.store(newDepth, std::memory_order_relaxed);
+            record(Knob::CAPTURE_DEPTH, depth, newDepth);
+        } else if (!captureDeletions()) {
+            deletionStacks.store(true, std::memory_order_relaxed);
+            record(Knob::DELETION_STACKS, false, true);
+        } else if (const auto factor = getSampleFactor(); factor > 1) {
+            sampleFactor.store(factor / 2, std::memory_order_relaxed);
+            record(Knob::SAMPLE_RATE, factor, factor / 2);
+        }
+    }
+
+    /**
+     * The loop of the governor thread.
+     */
+    inline void governor() {
+        auto lastCpu  = cpuTime();
+        auto lastHook = hookTime.load(std::memory_order_relaxed);
+        while (true) {
+            {
+                std::unique_lock lock { mutex };
+                cv.wait_for(lock, interval, [this] { return !run; });
+                if (!run) {
+                    return;
+                }
+            }
+            const auto cpu  = cpuTime();
+            const auto hook = hookTime.load(std::memory_order_relaxed);
+            const auto resident = residentBytes();
+            {
+                std::lock_guard lock { adjustmentMutex };
+                overhead = cpu > lastCpu ? static_cast<double>(hook - lastHook) / static_cast<double>(cpu - lastCpu) * 100 : 0;
+                memory   = resident != 0 ? static_cast<double>(ObjectPool::getTotalBytes()) / static_cast<double>(resident) * 100 : 0;
+            }
+            lastCpu  = cpu;
+            lastHook = hook;
+
+            if (overhead > budget || memory > budget) {
+                degrade();
+            } else if (overhead < budget / 2 && memory < budget / 2) {
+                recover();
+            }
+        }
+    }
+
+public:
+    inline Governor() {
+        if (auto overheadBudget = getBehaviour().overheadBudget()) {
+            budget = *overheadBudget;
+            try {
+                governorThread = std::thread(&Governor::governor, this);
+                threadRunning = true;
+                active.store(true, std::memory_order_relaxed);
+            } catch (const std::system_error&) {
+                // Without its thread, the governor simply stays inactive.
+            }
+        }
+    }
+
+    /**
+     * Stops the governor thread and waits for it to finish.
+     */
+    inline void stop() {
+        active.store(false, std::memory_order_relaxed);
+        {
+            std::lock_guard lock { mutex };
+            run = false;
+        }
+        cv.notify_all();
+        if (threadRunning) {
+            governorThread.join();
+            threadRunning = false;
+        }
+    }
+
+    /**
+     * Copies the most recent adjustments into the given buffer, oldest first.
+     *
+     * @param buffer the buffer to copy into
+     * @return the amount of copied adjustments
+     */
+    inline auto copyAdjustments(Adjustment (&buffer)[adjustmentCapacity]) -> std::size_t {
+        std::lock_guard lock { adjustmentMutex };
+        const auto count = std::min(adjustmentCount, adjustmentCapacity);
+        for (std::size_t i = 0; i < count; ++i) {
+            buffer[i] = adjustments[(adjustmentCount - count + i) % adjustmentCapacity];
+        }
+        return count;
+    }
+
+    /**
+     * Returns the total amount of adjustments made.
+     *
+     * @return the amount of adjustments
+     */
+    inline auto getCount() -> std::size_t {
+        std::lock_guard lock { adjustmentMutex };
+        return adjustmentCount;
+    }
+
+    /**
+     * Returns the most recently measured overhead and internal memory.
+     *
+     * @return the overhead and the internal memory in percent
+     */
+    inline auto getMeasured() -> std::pair<double, double> {
+        std::lock_guard lock { adjustmentMutex };
+        return { overhead, memory };
+    }
+};
+
+/**
+ * The hidden global variable of the overhead governor, created on its first use.
+ * It is never deallocated, as hooks may still run while the process exits.
+ */
+static Governor* governorInstance = nullptr;
+/** Ensures the governor is only created once.                              */
+static std::once_flag governorFlag;
+
+/**
+ * Returns the governor if it has been created.
+ *
+ * @return the governor or `nullptr` if not created
+ */
+static inline auto getGovernor() -> Governor* {
+    return started.load(std::memory_order_acquire) ? governorInstance : nullptr;
+}
+}
+
+void start() {
+    std::call_once(governorFlag, [] {
+        governorInstance = new Governor();
+        started.store(true, std::memory_order_release);
+    });
+}
+
+void stop() {
+    // Prevents the governor from being created afterwards.
+    std::call_once(governorFlag, [] { started.store(true, std::memory_order_release); });
+    if (const auto governor = getGovernor()) {
+        governor->stop();
+    }
+}
+
+auto getAdjustments(Adjustment (&buffer)[adjustmentCapacity]) -> std::size_t {
+    const auto governor = getGovernor();
+    return governor != nullptr ? governor->copyAdjustments(buffer) : 0;
+}
+
+auto getAdjustmentCount() -> std::size_t {
+    const auto governor = getGovernor();
+    return governor != nullptr ? governor->getCount() : 0;
+}
+
+auto getMeasurement() -> std::pair<double, double> {
+    const auto governor = getGovernor();
+    return governor != nullptr ? governor->getMeasured() : std::pair(0.0, 0.0);
+}
+
+auto toString(Knob knob) -> const char* {
+    switch (knob) {
+        case Knob::SAMPLE_RATE:     return "Guarded sample rate divisor";
+        case Knob::DELETION_STACKS: return "Deallocation callstacks";
+        case Knob::CAPTURE_DEPTH:   return "Callstack capture depth";
+        case Knob::WARNINGS:        return "Allocation warnings";
+    }
+    return "Unknown";
+}
+}
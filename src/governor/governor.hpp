@@ -0,0 +1,213 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef governor_hpp
+#define governor_hpp
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * @brief This namespace contains the adaptive overhead governor.
+ *
+ * If an overhead budget is set, a background thread periodically compares
+ * the measured overhead of the allocation hooks and the memory used
+ * internally by this sanitizer against it. While over budget, the governor
+ * degrades the tracking step by step, it restores the tracking once the
+ * overhead has settled well within the budget again.
+ */
+namespace lsan::governor {
+/**
+ * This enumeration contains the settings adjusted by the governor.
+ */
+enum class Knob {
+    SAMPLE_RATE, DELETION_STACKS, CAPTURE_DEPTH, WARNINGS
+};
+
+/**
+ * This structure represents an adjustment made by the governor.
+ */
+struct Adjustment {
+    /** The time the adjustment was made at.                         */
+    std::chrono::system_clock::time_point timestamp;
+    /** The adjusted setting.                                        */
+    Knob knob;
+    /** The previous value of the adjusted setting.                  */
+    std::size_t from;
+    /** The new value of the adjusted setting.                       */
+    std::size_t to;
+    /** The measured hook overhead in percent of the CPU time.       */
+    double overhead;
+    /** The measured internal memory in percent of the resident set. */
+    double memory;
+};
+
+/** The amount of adjustments that are kept for the statistics.            */
+static constexpr std::size_t adjustmentCapacity = 32;
+/** The average amount of hook calls per measured hook call.               */
+static constexpr std::uint32_t measureInterval = 64;
+
+/** Indicates whether the governor has been created.                       */
+extern std::atomic_bool started;
+/** Indicates whether the governor is running.                              */
+extern std::atomic_bool active;
+/** The estimated total time spent inside of the allocation hooks in ns.    */
+extern std::atomic<std::uint64_t> hookTime;
+/** The amount of frames to be captured for the allocation callstacks.      */
+extern std::atomic_size_t captureDepth;
+/** The factor the average amount of allocations per guarded one is scaled. */
+extern std::atomic_size_t sampleFactor;
+/** Whether to capture the callstacks of deallocations.                     */
+extern std::atomic_bool deletionStacks;
+/** Whether to check for implementation-defined allocation behaviour.       */
+extern std::atomic_bool warnings;
+/** The amount of hook calls of the calling thread.                         */
+extern thread_local std::uint32_t hookCalls __attribute__((tls_model("initial-exec")));
+
+/**
+ * @brief Creates and starts the governor if not done yet.
+ *
+ * Called by the first measured allocation hook, so the behaviour is only read
+ * once the sanitizer is set up.
+ */
+void start();
+
+/**
+ * Stops the governor. It cannot be started again afterwards.
+ */
+void stop();
+
+/**
+ * Returns whether the governor is running, creating it on the first call.
+ *
+ * @return whether the governor is running
+ */
+static inline auto isActive() noexcept -> bool {
+    if (__builtin_expect(!started.load(std::memory_order_relaxed), false)) {
+        start();
+    }
+    return active.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Measures the duration of an allocation hook.
+ *
+ * On average, only every `measureInterval`th hook call of a thread is
+ * measured while the governor is running, the measured duration is extrapolated.
+ */
+class Measurement {
+    /** Whether this hook call is measured.       */
+    const bool measured;
+    /** The time point this measurement began at. */
+    std::chrono::steady_clock::time_point begin;
+
+public:
+    // The calls are selected using a Weyl sequence, so periodically alternating hooks are sampled evenly.
+    inline Measurement() noexcept:
+        measured(isActive() && ++hookCalls * 0x9e3779b9u < UINT32_MAX / measureInterval) {
+        if (measured) {
+            begin = std::chrono::steady_clock::now();
+        }
+    }
+
+    inline ~Measurement() noexcept {
+        if (measured) {
+            const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+            hookTime.fetch_add(static_cast<std::uint64_t>(duration.count()) * measureInterval, std::memory_order_relaxed);
+        }
+    }
+
+    Measurement(const Measurement&) = delete;
+    auto operator=(const Measurement&) -> Measurement& = delete;
+};
+
+/**
+ * Returns the amount of frames to be captured for the allocation callstacks.
+ *
+ * @return the capture depth
+ */
+static inline auto getCaptureDepth() noexcept -> std::size_t {
+    return captureDepth.load(std::memory_order_relaxed);
+}
+
+/**
+ * Returns the factor the configured guarded sample rate is to be scaled with.
+ *
+ * @return the sample rate factor
+ */
+static inline auto getSampleFactor() noexcept -> std::size_t {
+    return sampleFactor.load(std::memory_order_relaxed);
+}
+
+/**
+ * Returns whether the callstacks of deallocations should be captured.
+ *
+ * @return whether to capture deallocation callstacks
+ */
+static inline auto captureDeletions() noexcept -> bool {
+    return deletionStacks.load(std::memory_order_relaxed);
+}
+
+/**
+ * Returns whether the checks for implementation-defined allocation behaviour are enabled.
+ *
+ * @return whether to check for implementation-defined behaviour
+ */
+static inline auto checkWarnings() noexcept -> bool {
+    return warnings.load(std::memory_order_relaxed);
+}
+
+/**
+ * Returns the most recent adjustments of the governor, oldest first.
+ *
+ * @param buffer the buffer to copy the adjustments into
+ * @return the amount of copied adjustments
+ */
+auto getAdjustments(Adjustment (&buffer)[adjustmentCapacity]) -> std::size_t;
+
+/**
+ * Returns the total amount of adjustments the governor made.
+ *
+ * @return the amount of adjustments
+ */
+auto getAdjustmentCount() -> std::size_t;
+
+/**
+ * Returns the most recently measured hook overhead and internal memory in percent.
+ *
+ * @return the overhead and the internal memory
+ */
+auto getMeasurement() -> std::pair<double, double>;
+
+/**
+ * Returns a human-readable name of the given setting.
+ *
+ * @param knob the setting
+ * @return the name of the setting
+ */
+auto toString(Knob knob) -> const char*;
+}
+
+#endif /* governor_hpp */
@@ -0,0 +1,197 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+#include "hooks.hpp"
+
+#include "../lsanMisc.hpp"
+#include "../MallocInfo.hpp"
+#include "../callstacks/callstackHelper.hpp"
+#include "../reclamation/epoch.hpp"
+
+namespace lsan::hooks {
+std::atomic<const Hook*> current = nullptr;
+std::atomic_size_t sampledBlocks = 0;
+thread_local std::size_t countdown = 0;
+
+/**
+ * This structure contains a part of the sampled blocks.
+ */
+struct Shard {
+    /** The mutex protecting the blocks.  */
+    std::mutex mutex;
+    /** The sampled blocks of this shard. */
+    std::unordered_set<const void*> blocks;
+};
+
+/** The amount of shards of the sampled blocks.                        */
+static constexpr std::size_t shardCount = 16;
+/** The sampled blocks, allocated with the first hook and never freed. */
+static Shard* shards = nullptr;
+/** The mutex serializing the setting of the hook.                     */
+static std::mutex hookMutex;
+/** The hook currently called by the calling thread.                   */
+static thread_local const Hook* delivering = nullptr;
+
+/**
+ * Returns the shard responsible for the given block.
+ *
+ * @param pointer the block
+ * @return the according shard
+ */
+static inline auto shardOf(const void* pointer) -> Shard& {
+    return shards[std::hash<const void*>()(pointer) % shardCount];
+}
+
+/**
+ * Returns the identifier of the callstack of the calling thread.
+ *
+ * @return the stack identifier
+ */
+static inline auto currentStackId() -> std::uint64_t {
+    return callstackHelper::getStackId(lcs::callstack());
+}
+
+/**
+ * Loads the current hook and counts a call of it.
+ *
+ * @return the current hook or `nullptr` if none is set
+ */
+static inline auto acquire() -> const Hook* {
+    const epoch::Guard guard;
+    const auto hook = current.load(std::memory_order_acquire);
+    if (hook != nullptr) {
+        hook->calls.fetch_add(1, std::memory_order_acquire);
+    }
+    return hook;
+}
+
+/**
+ * Ends a call of the given hook, destroying it if it has been replaced meanwhile by its last call.
+ *
+ * @param hook the hook whose call has ended
+ */
+static inline void release(const Hook* hook) {
+    if (hook->calls.fetch_sub(1, std::memory_order_acq_rel) == 1 && hook->replaced.load(std::memory_order_acquire)) {
+        delete hook;
+    }
+}
+
+/**
+ * Calls the given acquired hook with the given event and releases it.
+ *
+ * @param hook the hook to be called
+ * @param pointer the allocated or deallocated block
+ * @param size the requested size or zero for deallocations
+ * @param op the allocation operation
+ * @param stackId the identifier of the callstack of the operation
+ */
+static inline void call(const Hook* hook, const void* pointer, std::size_t size, __lsan_allocationOp op, std::uint64_t stackId) {
+    delivering = hook;
+    hook->callback(pointer, size, op, stackId, hook->context);
+    delivering = nullptr;
+    release(hook);
+}
+
+void deliverAllocation(recorder::Op op, const void* pointer, std::size_t size, const MallocInfo* info) {
+    const auto hook = acquire();
+    if (hook == nullptr) return;
+
+    countdown = hook->sampleRate;
+    {
+        auto& shard = shardOf(pointer);
+        std::lock_guard lock(shard.mutex);
+        if (shard.blocks.insert(pointer).second) {
+            sampledBlocks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    const auto stackId = info != nullptr ? info->getStackId() : currentStackId();
+    call(hook, pointer, size, static_cast<__lsan_allocationOp>(op), stackId);
+}
+
+void deliverDeallocation(const void* pointer) {
+    const auto hook = acquire();
+    if (hook == nullptr) return;
+
+    {
+        auto& shard = shardOf(pointer);
+        std::lock_guard lock(shard.mutex);
+        if (shard.blocks.erase(pointer) == 0) {
+            release(hook);
+            return;
+        }
+    }
+    sampledBlocks.fetch_sub(1, std::memory_order_relaxed);
+    call(hook, pointer, 0, __lsan_opFree, currentStackId());
+}
+}
+
+static_assert(static_cast<int>(lsan::recorder::Op::MALLOC)   == __lsan_opMalloc
+           && static_cast<int>(lsan::recorder::Op::CALLOC)   == __lsan_opCalloc
+           && static_cast<int>(lsan::recorder::Op::REALLOC)  == __lsan_opRealloc
+           && static_cast<int>(lsan::recorder::Op::FREE)     == __lsan_opFree
+           && static_cast<int>(lsan::recorder::Op::MEMALIGN) == __lsan_opMemalign,
+              "The allocation operations of the hook must match the recorded ones");
+
+void __lsan_setAllocationHook(__lsan_allocationHook callback, std::size_t sampleRate, void* context) {
+    using namespace lsan;
+
+    auto& tracker = getTracker();
+    const auto ignore = tracker.ignoreMalloc;
+    tracker.ignoreMalloc = true;
+
+    const hooks::Hook* previous;
+    {
+        std::lock_guard lock(hooks::hookMutex);
+        if (hooks::shards == nullptr) {
+            hooks::shards = new hooks::Shard[hooks::shardCount];
+        }
+        const auto hook = callback == nullptr ? nullptr : new hooks::Hook { callback, sampleRate, context };
+        previous = hooks::current.exchange(hook, std::memory_order_acq_rel);
+    }
+    if (previous != nullptr) {
+        // Afterwards, no thread can start calling the previous hook anymore.
+        epoch::synchronize(epoch::current());
+        // A call of the hook replacing itself is still in progress, it destroys the hook when it returns.
+        const std::size_t own = hooks::delivering == previous ? 1 : 0;
+        while (previous->calls.load(std::memory_order_acquire) > own) {
+            std::this_thread::yield();
+        }
+        if (own == 0) {
+            delete previous;
+        } else {
+            previous->replaced.store(true, std::memory_order_release);
+        }
+    }
+    if (callback == nullptr) {
+        for (std::size_t i = 0; i < hooks::shardCount; ++i) {
+            std::lock_guard shardLock(hooks::shards[i].mutex);
+            hooks::sampledBlocks.fetch_sub(hooks::shards[i].blocks.size(), std::memory_order_relaxed);
+            hooks::shards[i].blocks.clear();
+        }
+    }
+
+    tracker.ignoreMalloc = ignore;
+}
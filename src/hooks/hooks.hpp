@@ -0,0 +1,125 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef hooks_hpp
+#define hooks_hpp
+
+#include <atomic>
+#include <cstddef>
+
+#include <lsan_hooks.h>
+
+#include "../recorder/recorder.hpp"
+
+namespace lsan {
+struct MallocInfo;
+}
+
+/**
+ * @brief This namespace contains the delivery of the sampled allocation events
+ * to the allocation hook set by the user.
+ *
+ * The hook is called inline by the allocating or deallocating thread. The
+ * sampled blocks are remembered until their deallocation has been delivered.
+ *
+ * The hook is loaded inside of an epoch guard, but called after it has been
+ * left, so the hook can be replaced from within itself. The calls in progress
+ * are counted, a replaced hook is only destroyed once they have returned.
+ */
+namespace lsan::hooks {
+/**
+ * This structure contains the allocation hook set by the user.
+ */
+struct Hook {
+    /** The function to be called.                     */
+    __lsan_allocationHook callback;
+    /** The amount of allocations per sampled one.     */
+    std::size_t sampleRate;
+    /** The context passed to the function.            */
+    void* context;
+    /** The amount of calls of this hook in progress.  */
+    mutable std::atomic_size_t calls = 0;
+    /** Whether this hook has been replaced.           */
+    mutable std::atomic_bool replaced = false;
+};
+
+/** The current hook, `nullptr` if none is set.                         */
+extern std::atomic<const Hook*> current;
+/** The amount of sampled blocks whose deallocation is to be delivered. */
+extern std::atomic_size_t sampledBlocks;
+/** The countdown to the next sampled allocation of the calling thread. */
+extern thread_local std::size_t countdown __attribute__((tls_model("initial-exec")));
+
+/**
+ * @brief Delivers the given allocation to the current hook and resets the countdown of the calling thread.
+ *
+ * The stack identifier of the given allocation record is delivered, or the
+ * one of the current callstack if the block is not tracked.
+ *
+ * @param op the allocation operation
+ * @param pointer the allocated block
+ * @param size the requested size
+ * @param info the allocation record of the block or `nullptr` if it is not tracked
+ */
+void deliverAllocation(recorder::Op op, const void* pointer, std::size_t size, const MallocInfo* info);
+
+/**
+ * Delivers the deallocation of the given block to the current hook if its allocation was sampled.
+ *
+ * @param pointer the deallocated block
+ */
+void deliverDeallocation(const void* pointer);
+
+/**
+ * Samples the given allocation for the allocation hook.
+ *
+ * @param op the allocation operation
+ * @param pointer the allocated block
+ * @param size the requested size
+ * @param info the allocation record of the block or `nullptr` if it is not tracked
+ */
+static inline void allocated(recorder::Op op, const void* pointer, std::size_t size, const MallocInfo* info = nullptr) {
+    if (__builtin_expect(current.load(std::memory_order_relaxed) == nullptr, true)) {
+        return;
+    }
+    if (countdown > 1) {
+        --countdown;
+        return;
+    }
+    deliverAllocation(op, pointer, size, info);
+}
+
+/**
+ * Delivers the deallocation of the given block if its allocation has been sampled.
+ *
+ * @param pointer the block to be deallocated
+ */
+static inline void deallocated(const void* pointer) {
+    if (__builtin_expect(current.load(std::memory_order_relaxed) == nullptr, true)) {
+        return;
+    }
+    if (sampledBlocks.load(std::memory_order_relaxed) > 0) {
+        deliverDeallocation(pointer);
+    }
+}
+}
+
+#endif /* hooks_hpp */
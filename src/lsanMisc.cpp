@@ -28,13 +28,19 @@
 #endif
 
 #include <lsan_internals.h>
+#include <lsan_stats.h>
 #include <callstack.h>
 
 #include "lsanMisc.hpp"
 
+#include "bytePrinter.hpp"
 #include "formatter.hpp"
 #include "TLSTracker.hpp"
 #include "callstacks/callstackHelper.hpp"
+#include "cow/cow.hpp"
+#include "governor/governor.hpp"
+#include "statistics/statsMode.hpp"
+#include "untracked/untracked.hpp"
 
 #ifndef VERSION
  #define VERSION "clean build"
@@ -102,9 +108,35 @@ void exitHook() {
         out << formatter::format<Style::ITALIC>(", stacktrace:") << std::endl;
         callstackHelper::format(lcs::callstack(), out);
     }
-    out << std::endl     << std::endl
-        << getInstance() << std::endl
-        << printInformation;
+    out << std::endl     << std::endl;
+    if (statsMode::active()) {
+        out << formatter::format<Style::ITALIC>("No leaks tracked in the stats-only mode.") << std::endl << std::endl;
+        __lsan_printStats();
+    } else {
+        out << getInstance() << std::endl;
+        if (const auto count = untracked::totalCount.load(std::memory_order_relaxed)) {
+            out << "Note: " << formatter::format<Style::GREYED>("Allocations below LSAN_MIN_TRACKED_SIZE were only counted: ")
+                << count << " blocks with " << bytesToString(untracked::totalBytes.load(std::memory_order_relaxed))
+                << ", of which " << untracked::liveCount.load(std::memory_order_relaxed) << " blocks with "
+                << bytesToString(untracked::liveBytes.load(std::memory_order_relaxed)) << " are still allocated and were not checked for leaks."
+                << std::endl << std::endl;
+        }
+    }
+    if (getBehaviour().trackSlack()) {
+        __lsan_printSlackStats();
+    }
+    if (getBehaviour().numaStats()) {
+        __lsan_printNumaStats();
+    }
+    if (getBehaviour().typeStats()) {
+        __lsan_printTypeStats();
+    }
+    if (cow::active()) {
+        cow::stop();
+        __lsan_printCowStats();
+    }
+    governor::stop();
+    out << printInformation;
     internalCleanUp();
 }
 
@@ -136,22 +168,15 @@ auto has(const std::string & var) -> bool {
 
 auto getTracker() -> ATracker& {
     auto& globalInstance = getInstance();
-    if (globalInstance.finished || getBehaviour().statsActive()) return globalInstance;
+    if (globalInstance.finished || LSan::threadExiting || getBehaviour().statsActive()) return globalInstance;
 
     const auto& key = globalInstance.saniKey;
     auto tlv = pthread_getspecific(key);
     if (tlv == nullptr) {
         pthread_setspecific(key, std::addressof(globalInstance));
-        TLSTracker* tlsTracker;
-        {
-            std::lock_guard lock(globalInstance.mutex);
-            auto ignore = globalInstance.ignoreMalloc;
-            globalInstance.ignoreMalloc = true;
-            tlsTracker = new TLSTracker();
-            pthread_setspecific(key, tlsTracker);
-            globalInstance.ignoreMalloc = ignore;
-        }
-        return *tlsTracker;
+        auto& tlsTracker = globalInstance.acquireTracker();
+        pthread_setspecific(key, std::addressof(tlsTracker));
+        return tlsTracker;
     }
     return *static_cast<ATracker*>(tlv);
 }
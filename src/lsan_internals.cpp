@@ -46,8 +46,18 @@ bool __lsan_printBinaries    = get<bool>("LSAN_PRINT_BINARIES") .value_or(true);
 bool __lsan_printFunctions   = get<bool>("LSAN_PRINT_FUNCTIONS").value_or(true);
 bool __lsan_relativePaths    = get<bool>("LSAN_RELATIVE_PATHS") .value_or(true);
 
+bool __lsan_trackSlack       = get<bool>("LSAN_TRACK_SLACK")    .value_or(false);
+bool __lsan_flightRecorder   = get<bool>("LSAN_FLIGHT_RECORDER").value_or(true);
+bool __lsan_numaStats        = get<bool>("LSAN_NUMA_STATS")     .value_or(false);
+bool __lsan_reportOnUnload   = get<bool>("LSAN_REPORT_ON_UNLOAD").value_or(false);
+bool __lsan_typeStats        = get<bool>("LSAN_TYPE_STATS")     .value_or(false);
+
 std::size_t __lsan_leakCount           = get<std::size_t>("LSAN_LEAK_COUNT")           .value_or(100);
 std::size_t __lsan_callstackSize       = get<std::size_t>("LSAN_CALLSTACK_SIZE")       .value_or(20);
 std::size_t __lsan_firstPartyThreshold = get<std::size_t>("LSAN_FIRST_PARTY_THRESHOLD").value_or(3);
+std::size_t __lsan_guardedSampleRate   = get<std::size_t>("LSAN_GUARDED_SAMPLE_RATE")  .value_or(0);
+std::size_t __lsan_guardedPoolSize     = get<std::size_t>("LSAN_GUARDED_POOL_SIZE")    .value_or(64);
+std::size_t __lsan_recorderEvents      = get<std::size_t>("LSAN_RECORDER_EVENTS")      .value_or(16);
 
 const char * __lsan_firstPartyRegex = getVariable("LSAN_FIRST_PARTY_REGEX").value_or(nullptr);
+const char * __lsan_leakOrder       = getVariable("LSAN_LEAK_ORDER")       .value_or("size");
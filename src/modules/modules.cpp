@@ -0,0 +1,220 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+
+#include <dlfcn.h>
+
+#ifdef __linux__
+ #include <link.h>
+#endif
+
+#ifdef __APPLE__
+ #include <mach-o/dyld.h>
+#endif
+
+#define LCS_USE_UNSAFE_OPTIMIZATION 1
+#include <callstack.h>
+#include <callstack_internals.h>
+
+#include "modules.hpp"
+
+#include "../LeakSani.hpp"
+#include "../bytePrinter.hpp"
+#include "../formatter.hpp"
+#include "../lsanMisc.hpp"
+#include "../allocations/interpose.hpp"
+#include "../callstacks/callstackHelper.hpp"
+
+namespace lsan::modules {
+/**
+ * Returns the base address and the name of the module with the given handle.
+ *
+ * @param handle the handle of the module
+ * @param name the name of the module
+ * @return the base address or `nullptr` if the module was not found
+ */
+static inline auto baseOf(void* handle, const char*& name) -> const void* {
+#ifdef __linux__
+    link_map* map = nullptr;
+    if (dlinfo(handle, RTLD_DI_LINKMAP, &map) != 0 || map == nullptr) {
+        return nullptr;
+    }
+    // The dynamic section lies within the module, so its base can be looked up.
+    Dl_info info;
+    if (dladdr(map->l_ld, &info) == 0) {
+        return nullptr;
+    }
+    name = map->l_name;
+    return info.dli_fbase;
+#else
+    for (std::uint32_t i = 0; i < _dyld_image_count(); ++i) {
+        const auto imageName = _dyld_get_image_name(i);
+        const auto other = dlopen(imageName, RTLD_LAZY | RTLD_NOLOAD);
+        if (other == nullptr) continue;
+
+        dlclose(other);
+        if (other == handle) {
+            name = imageName;
+            return _dyld_get_image_header(i);
+        }
+    }
+    return nullptr;
+#endif
+}
+
+auto unloading(void* handle) -> std::optional<Module> {
+    const char* name = nullptr;
+    const auto base = baseOf(handle, name);
+    // The main program is never unloaded.
+    if (base == nullptr || name == nullptr || *name == '\0') return std::nullopt;
+
+    std::map<void*, bool> addresses;
+    const auto goesThrough = [&](lcs::callstack& callstack) {
+        const struct callstack* raw = callstack;
+        for (std::size_t i = 0; i < raw->backtraceSize; ++i) {
+            const auto& [it, inserted] = addresses.try_emplace(raw->backtrace[i], false);
+            if (inserted) {
+                Dl_info info;
+                it->second = dladdr(raw->backtrace[i], &info) != 0 && info.dli_fbase == base;
+            }
+            if (it->second) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    const auto report = getBehaviour().reportOnUnload();
+    Module module { name, {} };
+
+    const auto autoClearCaches = callstack_autoClearCaches;
+    callstack_autoClearCaches = false;
+    getInstance().forEachRecordOfAllTrackers([&](MallocInfo& info) {
+        const auto created = goesThrough(info.createdCallstack);
+        if (created) {
+            callstack_toArray(info.createdCallstack);
+        }
+        if (info.deletedCallstack.has_value() && goesThrough(*info.deletedCallstack)) {
+            callstack_toArray(*info.deletedCallstack);
+        }
+        if (!report || !created || info.deleted
+            || callstackHelper::getCallstackType(info.createdCallstack) != callstackHelper::CallstackType::USER) {
+            return;
+        }
+        module.leaks.push_back(info.pointer);
+    });
+    callstack_clearCaches();
+    callstack_autoClearCaches = autoClearCaches;
+
+    std::sort(module.leaks.begin(), module.leaks.end());
+    return module;
+}
+
+void unloaded(const Module& module) {
+    using formatter::Style;
+
+    // Only a reference has been dropped if the module can still be found.
+    if (const auto handle = dlopen(module.name.c_str(), RTLD_LAZY | RTLD_NOLOAD); handle != nullptr) {
+        dlclose(handle);
+        return;
+    }
+    callstackHelper::invalidateClassifications(module.name);
+    if (module.leaks.empty()) return;
+
+    auto& out = getOutputStream();
+    std::size_t count   = 0,
+                printed = 0,
+                bytes   = 0;
+
+    const auto autoClearCaches = callstack_autoClearCaches;
+    callstack_autoClearCaches = false;
+    getInstance().forEachRecordOfAllTrackers([&](MallocInfo& info) {
+        if (info.deleted || !std::binary_search(module.leaks.begin(), module.leaks.end(), info.pointer)) {
+            return;
+        }
+        if (count == 0) {
+            out << std::endl << formatter::format<Style::ITALIC>("Leaks of the unloaded module ")
+                << formatter::format<Style::BOLD>(module.name)
+                << formatter::format<Style::ITALIC>(":") << std::endl << std::endl;
+        }
+        ++count;
+        bytes += info.size;
+        if (printed < getBehaviour().leakCount()) {
+            out << info << std::endl;
+            ++printed;
+        }
+    });
+    if (count > 0) {
+        out << formatter::format<Style::BOLD>("Summary: ");
+        if (printed < count) {
+            out << "showing " << formatter::format<Style::ITALIC>(std::to_string(printed)) << " of ";
+        }
+        out << formatter::format<Style::BOLD>(std::to_string(count)) << " leaks, "
+            << formatter::format<Style::BOLD>(bytesToString(bytes)) << " lost." << std::endl << std::endl;
+    }
+    callstack_clearCaches();
+    callstack_autoClearCaches = autoClearCaches;
+}
+}
+
+#ifdef __linux__
+extern "C" auto dlclose(void* handle) -> int {
+    static const auto real = reinterpret_cast<int (*)(void*)>(dlsym(RTLD_NEXT, "dlclose"));
+#else
+namespace lsan {
+auto dlclose(void* handle) -> int {
+    static const auto real = &::dlclose;
+#endif
+    std::optional<lsan::modules::Module> module;
+    if (!lsan::LSan::finished) {
+        auto& tracker = lsan::getTracker();
+        const std::lock_guard lock { tracker.mutex };
+
+        if (!tracker.ignoreMalloc) {
+            tracker.ignoreMalloc = true;
+            module = lsan::modules::unloading(handle);
+            tracker.ignoreMalloc = false;
+        }
+    }
+    const auto result = real(handle);
+    if (module.has_value()) {
+        auto& tracker = lsan::getTracker();
+        const std::lock_guard lock { tracker.mutex };
+
+        const auto ignored = tracker.ignoreMalloc;
+        tracker.ignoreMalloc = true;
+        if (result == 0 && !lsan::LSan::finished) {
+            lsan::modules::unloaded(*module);
+        }
+        module.reset();
+        tracker.ignoreMalloc = ignored;
+    }
+    return result;
+}
+#ifndef __linux__
+}
+
+INTERPOSE(lsan::dlclose, dlclose);
+#endif
@@ -0,0 +1,71 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef modules_hpp
+#define modules_hpp
+
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief This namespace contains the handling of unloaded modules.
+ *
+ * Once a module is unloaded, the return addresses pointing into it can no
+ * longer be translated. Therefore, the callstacks going through a module are
+ * translated right before it is closed, as it is not known beforehand whether
+ * only a reference to it is dropped.
+ */
+namespace lsan::modules {
+/**
+ * This structure describes a module about to be closed.
+ */
+struct Module {
+    /** The path of the module.                                     */
+    std::string name;
+    /** The sorted addresses of the leaks allocated by the module.  */
+    std::vector<const void*> leaks;
+};
+
+/**
+ * @brief Prepares the unloading of the module with the given handle.
+ *
+ * Translates the callstacks of the allocation records going through the
+ * module and collects the leaks of the module if they are to be reported.
+ *
+ * @param handle the handle of the module as returned by `dlopen`
+ * @return the module or nothing if it was not found
+ */
+auto unloading(void* handle) -> std::optional<Module>;
+
+/**
+ * @brief Finishes the unloading of the given closed module.
+ *
+ * If the module has actually been unloaded, its collected leaks are reported
+ * and its cached classification is removed.
+ *
+ * @param module the module returned by `unloading`
+ */
+void unloaded(const Module& module);
+}
+
+#endif /* modules_hpp */
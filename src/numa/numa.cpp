@@ -0,0 +1,98 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+
+#ifdef __linux__
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/syscall.h>
+#endif
+
+#include "numa.hpp"
+
+namespace lsan::numa {
+thread_local std::uint32_t frees = 0;
+
+/** The amount of pages queried using one system call. */
+static constexpr std::size_t batchSize = 256;
+
+auto currentNode() noexcept -> int {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+        return static_cast<int>(node);
+    }
+#endif
+    return 0;
+}
+
+void nodesOf(const void* const* addresses, int* nodes, std::size_t count) noexcept {
+#if defined(__linux__) && defined(SYS_move_pages)
+    const auto pageSize = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    void* pages[batchSize];
+    for (std::size_t offset = 0; offset < count; offset += batchSize) {
+        const auto amount = std::min(batchSize, count - offset);
+        for (std::size_t i = 0; i < amount; ++i) {
+            pages[i] = reinterpret_cast<void*>(reinterpret_cast<std::uintptr_t>(addresses[offset + i]) & ~(pageSize - 1));
+        }
+        // Without passing target nodes, the current nodes of the pages are reported.
+        if (syscall(SYS_move_pages, 0, amount, pages, nullptr, nodes + offset, 0) != 0) {
+            std::fill(nodes + offset, nodes + offset + amount, 0);
+            continue;
+        }
+        std::replace_if(nodes + offset, nodes + offset + amount, [](int node) { return node < 0; }, -1);
+    }
+#else
+    std::fill(nodes, nodes + count, 0);
+#endif
+}
+
+auto nodeCount() noexcept -> int {
+#ifdef __linux__
+    const auto fd = open("/sys/devices/system/node/possible", O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+    char buffer[64];
+    const auto length = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (length <= 0) {
+        return 1;
+    }
+
+    // The format is a list of ranges such as "0-1,3", the last number is the highest node.
+    int highest = 0, number = 0;
+    for (ssize_t i = 0; i < length; ++i) {
+        if (buffer[i] >= '0' && buffer[i] <= '9') {
+            number = number * 10 + (buffer[i] - '0');
+        } else {
+            highest = std::max(highest, number);
+            number  = 0;
+        }
+    }
+    return std::max(highest, number) + 1;
+#else
+    return 1;
+#endif
+}
+}
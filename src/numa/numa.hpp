@@ -0,0 +1,89 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef numa_hpp
+#define numa_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief This namespace contains the helper functions for the NUMA node attribution.
+ *
+ * On systems without NUMA support, every address and every CPU is attributed
+ * to the node `0`.
+ */
+namespace lsan::numa {
+/** The amount of deallocations per sampled deallocation of a thread. */
+static constexpr std::uint32_t sampleInterval = 16;
+
+/** The amount of deallocations of the calling thread.              */
+extern thread_local std::uint32_t frees __attribute__((tls_model("initial-exec")));
+
+/**
+ * Returns whether the current deallocation of the calling thread is sampled.
+ *
+ * @return whether to sample the deallocation
+ */
+static inline auto sampleFree() noexcept -> bool {
+    return ++frees % sampleInterval == 0;
+}
+
+/**
+ * Returns the NUMA node of the CPU the calling thread is running on.
+ *
+ * @return the NUMA node of the calling thread
+ */
+auto currentNode() noexcept -> int;
+
+/**
+ * @brief Queries the NUMA nodes the pages of the given addresses are physically placed on.
+ *
+ * A node of `-1` indicates that the page has not been placed yet.
+ *
+ * @param addresses the addresses to be queried
+ * @param nodes the array to store the nodes in
+ * @param count the amount of addresses
+ */
+void nodesOf(const void* const* addresses, int* nodes, std::size_t count) noexcept;
+
+/**
+ * Returns the NUMA node the page of the given address is physically placed on.
+ *
+ * @param address the address to be queried
+ * @return the NUMA node or `-1` if the page has not been placed yet
+ */
+static inline auto nodeOf(const void* address) noexcept -> int {
+    int node;
+    nodesOf(&address, &node, 1);
+    return node;
+}
+
+/**
+ * Returns the amount of NUMA nodes of this system.
+ *
+ * @return the amount of nodes, at least one
+ */
+auto nodeCount() noexcept -> int;
+}
+
+#endif /* numa_hpp */
@@ -0,0 +1,50 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <sys/mman.h>
+
+#include "presence.hpp"
+
+namespace lsan::presence {
+std::atomic<Leaf*> leaves[std::size_t(1) << (addressBits - leafBits)];
+std::atomic_bool exhausted = false;
+
+auto leafOf(std::uintptr_t address) noexcept -> Leaf* {
+    auto& slot = leaves[address >> leafBits];
+    auto leaf = slot.load(std::memory_order_acquire);
+    if (leaf != nullptr) {
+        return leaf;
+    }
+    const auto memory = mmap(nullptr, sizeof(Leaf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED) {
+        exhausted.store(true, std::memory_order_relaxed);
+        return nullptr;
+    }
+    // The mapping is zero-filled, that is, all atomics are initialized to zero.
+    const auto created = static_cast<Leaf*>(memory);
+    if (!slot.compare_exchange_strong(leaf, created, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        munmap(memory, sizeof(Leaf));
+        return leaf;
+    }
+    return created;
+}
+}
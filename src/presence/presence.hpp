@@ -0,0 +1,122 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef presence_hpp
+#define presence_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief This namespace contains the presence filter of the allocation records.
+ *
+ * A bit is kept for every granule of the address space that might be the
+ * start of a tracked allocation. The bits are stored in lazily mapped leaves
+ * of one gigabyte of address space each, the untouched pages of a leaf are
+ * never backed by memory.
+ *
+ * A cleared bit guarantees that no allocation record exists for the
+ * addresses of the granule, a set bit only indicates that one might exist.
+ * Once a leaf could not be mapped, unmapped leaves are treated as possibly
+ * containing every address.
+ */
+namespace lsan::presence {
+/** The binary logarithm of the size of a granule.                     */
+static constexpr std::size_t granuleBits = alignof(std::max_align_t) == 16 ? 4 : 3;
+/** The binary logarithm of the address space covered by a leaf.       */
+static constexpr std::size_t leafBits    = 30;
+/** The binary logarithm of the address space covered by the filter. */
+static constexpr std::size_t addressBits = 48;
+/** The amount of words in a leaf.                                     */
+static constexpr std::size_t leafWords   = std::size_t(1) << (leafBits - granuleBits - 6);
+
+/** The type of a leaf.                                                */
+using Leaf = std::atomic<std::uint64_t>[leafWords];
+
+/** The leaves, indexed by the upper bits of the addresses.            */
+extern std::atomic<Leaf*> leaves[std::size_t(1) << (addressBits - leafBits)];
+/** Whether a leaf could not be mapped.                                */
+extern std::atomic_bool exhausted;
+
+/**
+ * Returns the leaf covering the given address, mapping it if necessary.
+ *
+ * @param address the address
+ * @return the leaf or `nullptr` if it could not be mapped
+ */
+auto leafOf(std::uintptr_t address) noexcept -> Leaf*;
+
+/**
+ * Marks the given pointer as possibly tracked.
+ *
+ * @param pointer the pointer to be marked
+ */
+static inline void add(const void* pointer) noexcept {
+    const auto address = reinterpret_cast<std::uintptr_t>(pointer);
+    if (address >> addressBits != 0) return;
+
+    const auto leaf = leafOf(address);
+    if (leaf == nullptr) return;
+
+    const auto granule = (address >> granuleBits) & ((std::uintptr_t(1) << (leafBits - granuleBits)) - 1);
+    (*leaf)[granule >> 6].fetch_or(std::uint64_t(1) << (granule & 63), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Marks the given pointer as not tracked.
+ *
+ * May only be called once the last allocation record of the pointer has been removed
+ * and before the block can be reused, that is, before it is deallocated.
+ *
+ * @param pointer the pointer to be unmarked
+ */
+static inline void remove(const void* pointer) noexcept {
+    const auto address = reinterpret_cast<std::uintptr_t>(pointer);
+    if (address >> addressBits != 0) return;
+
+    const auto leaf = leaves[address >> leafBits].load(std::memory_order_acquire);
+    if (leaf == nullptr) return;
+
+    const auto granule = (address >> granuleBits) & ((std::uintptr_t(1) << (leafBits - granuleBits)) - 1);
+    (*leaf)[granule >> 6].fetch_and(~(std::uint64_t(1) << (granule & 63)), std::memory_order_relaxed);
+}
+
+/**
+ * Returns whether an allocation record might exist for the given pointer.
+ *
+ * @param pointer the pointer to be checked
+ * @return whether the pointer might be tracked
+ */
+static inline auto mayContain(const void* pointer) noexcept -> bool {
+    const auto address = reinterpret_cast<std::uintptr_t>(pointer);
+    if (address >> addressBits != 0) return true;
+
+    const auto leaf = leaves[address >> leafBits].load(std::memory_order_acquire);
+    if (leaf == nullptr) return exhausted.load(std::memory_order_relaxed);
+
+    const auto granule = (address >> granuleBits) & ((std::uintptr_t(1) << (leafBits - granuleBits)) - 1);
+    return ((*leaf)[granule >> 6].load(std::memory_order_relaxed) >> (granule & 63)) & 1;
+}
+}
+
+#endif /* presence_hpp */
@@ -0,0 +1,44 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "probes.hpp"
+
+#ifdef LSAN_PROBES
+
+/**
+ * Defines the semaphore of the probe with the given name.
+ *
+ * @param name the name of the probe
+ */
+#define LSAN_SEMAPHORE(name) \
+volatile unsigned short lsan_##name##_semaphore __attribute__((section(".probes"), used)) = 0
+
+extern "C" {
+LSAN_SEMAPHORE(malloc);
+LSAN_SEMAPHORE(calloc);
+LSAN_SEMAPHORE(realloc);
+LSAN_SEMAPHORE(free);
+LSAN_SEMAPHORE(leak);
+LSAN_SEMAPHORE(warning);
+}
+
+#endif /* LSAN_PROBES */
@@ -0,0 +1,119 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef probes_hpp
+#define probes_hpp
+
+/*
+ * The USDT probes are available on Linux if the SystemTap header is available.
+ * They can be disabled at compile time by defining LSAN_NO_PROBES.
+ */
+#if defined(__linux__) && !defined(LSAN_NO_PROBES) && defined(__has_include)
+ #if __has_include(<sys/sdt.h>)
+  #define LSAN_PROBES 1
+ #endif
+#endif
+
+#ifdef LSAN_PROBES
+
+#include <cstdint>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#include "../callstacks/callstackHelper.hpp"
+
+extern "C" {
+/*
+ * The semaphores are incremented by the tracers attaching to the probes,
+ * they have to be named after the provider and the probe.
+ */
+/** The semaphore of the allocation probe.                  */
+extern volatile unsigned short lsan_malloc_semaphore;
+/** The semaphore of the zero-initialized allocation probe. */
+extern volatile unsigned short lsan_calloc_semaphore;
+/** The semaphore of the reallocation probe.                */
+extern volatile unsigned short lsan_realloc_semaphore;
+/** The semaphore of the deallocation probe.                */
+extern volatile unsigned short lsan_free_semaphore;
+/** The semaphore of the leak probe.                        */
+extern volatile unsigned short lsan_leak_semaphore;
+/** The semaphore of the warning probe.                     */
+extern volatile unsigned short lsan_warning_semaphore;
+}
+
+/**
+ * Returns whether a tracer is attached to the probe of the given name.
+ *
+ * @param name the name of the probe
+ */
+#define LSAN_PROBE_ENABLED(name) __builtin_expect(lsan_##name##_semaphore != 0, 0)
+
+/**
+ * @brief Fires the probe of the given name with the given arguments.
+ *
+ * The arguments are only evaluated if a tracer is attached to the probe.
+ *
+ * @param name the name of the probe
+ */
+#define LSAN_PROBE(name, ...)                  \
+do {                                           \
+    if (LSAN_PROBE_ENABLED(name)) {            \
+        STAP_PROBEV(lsan, name, __VA_ARGS__);  \
+    }                                          \
+} while (false)
+
+/**
+ * This namespace contains the helper functions for the arguments of the probes.
+ */
+namespace lsan::probes {
+/**
+ * Returns the identifier of the calling thread as seen by the kernel.
+ *
+ * @return the thread identifier
+ */
+static inline auto threadId() noexcept -> long {
+    return syscall(SYS_gettid);
+}
+}
+
+#else
+
+#define LSAN_PROBE_ENABLED(name) false
+#define LSAN_PROBE(name, ...) do {} while (false)
+
+#endif /* LSAN_PROBES */
+
+/**
+ * Fires the allocation probe of the given name for the given allocation record.
+ *
+ * @param name the name of the probe
+ * @param info the allocation record
+ */
+#define LSAN_PROBE_ALLOCATION(name, info)                                                \
+LSAN_PROBE(name, (info).pointer, (info).size,                                            \
+           (info).getStackId(), lsan::probes::threadId())
+
+#endif /* probes_hpp */
@@ -0,0 +1,196 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <thread>
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "epoch.hpp"
+
+namespace lsan::epoch {
+/**
+ * @brief This structure represents the epoch announcement of one thread.
+ *
+ * It occupies a cache line of its own, so announcing an epoch does not
+ * contend with other threads.
+ */
+struct alignas(64) Slot {
+    /** The announced epoch shifted by one and tagged with one, zero outside of critical sections. */
+    std::atomic<Epoch> state = 0;
+    /** Indicates whether a thread currently owns this slot.                                        */
+    std::atomic_bool inUse = false;
+    /** The next slot in the global list.                                                           */
+    Slot* next = nullptr;
+};
+
+/** The amount of slots mapped at once.                                  */
+static constexpr std::size_t slotsPerChunk = 64;
+
+/** The global epoch.                                                   */
+static std::atomic<Epoch> globalEpoch { 0 };
+/** The first one of the registered slots.                              */
+static std::atomic<Slot*> slots = nullptr;
+/**
+ * The amount of threads without a slot inside a critical section, indexed by epoch.
+ * Only used by exiting threads and if no slot could be mapped.
+ */
+static std::atomic_size_t readers[3] {};
+
+/** The slot of the calling thread, `nullptr` if not yet acquired.       */
+static thread_local Slot* slot __attribute__((tls_model("initial-exec"))) = nullptr;
+/** The nesting depth of the critical sections of the calling thread.    */
+static thread_local std::size_t depth __attribute__((tls_model("initial-exec"))) = 0;
+/** Indicates whether the calling thread cannot use a slot anymore.      */
+static thread_local bool unavailable __attribute__((tls_model("initial-exec"))) = false;
+
+/** The key used to release the slots of exiting threads.               */
+static pthread_key_t key;
+/** Ensures the key is only created once.                               */
+static pthread_once_t keyOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * Releases the given slot of an exiting thread.
+ *
+ * @param value the slot
+ */
+static void release(void* value) {
+    slot        = nullptr;
+    unavailable = true;
+    static_cast<Slot*>(value)->inUse.store(false, std::memory_order_release);
+}
+
+/**
+ * Creates the key used to release the slots.
+ */
+static void createKey() {
+    pthread_key_create(&key, release);
+}
+
+/**
+ * @brief Acquires a slot for the calling thread.
+ *
+ * A slot released by an exited thread is reused if available.
+ *
+ * @return the acquired slot or `nullptr` if none can be used
+ */
+static auto acquire() noexcept -> Slot* {
+    if (unavailable) return nullptr;
+
+    Slot* toReturn = nullptr;
+    for (auto element = slots.load(std::memory_order_acquire); element != nullptr; element = element->next) {
+        bool expected = false;
+        if (element->inUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            toReturn = element;
+            break;
+        }
+    }
+    if (toReturn == nullptr) {
+        // Mapped directly, as the slots are needed while deallocating.
+        void* memory = mmap(nullptr, slotsPerChunk * sizeof(Slot), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            unavailable = true;
+            return nullptr;
+        }
+        const auto chunk = static_cast<Slot*>(memory);
+        for (std::size_t i = 0; i < slotsPerChunk; ++i) {
+            new (chunk + i) Slot();
+            if (i > 0) {
+                chunk[i - 1].next = chunk + i;
+            }
+        }
+        chunk->inUse.store(true, std::memory_order_relaxed);
+        auto& last = chunk[slotsPerChunk - 1];
+        auto first = slots.load(std::memory_order_relaxed);
+        do {
+            last.next = first;
+        } while (!slots.compare_exchange_weak(first, chunk, std::memory_order_release, std::memory_order_relaxed));
+        toReturn = chunk;
+    }
+    slot = toReturn;
+
+    pthread_once(&keyOnce, createKey);
+    pthread_setspecific(key, toReturn);
+    return toReturn;
+}
+
+auto enter() noexcept -> Epoch {
+    auto own = slot;
+    if (__builtin_expect(own == nullptr, false) && (own = acquire()) == nullptr) {
+        while (true) {
+            const auto epoch = globalEpoch.load();
+            readers[epoch % 3].fetch_add(1);
+            if (globalEpoch.load() == epoch) {
+                return epoch;
+            }
+            // The epoch advanced in between, the counter might already have been checked.
+            readers[epoch % 3].fetch_sub(1);
+        }
+    }
+    if (depth++ > 0) {
+        return own->state.load(std::memory_order_relaxed) >> 1;
+    }
+    const auto epoch = globalEpoch.load(std::memory_order_acquire);
+    own->state.store(epoch << 1 | 1, std::memory_order_relaxed);
+    // Orders the announcement before the loads of the critical section, pairs with the fences
+    // of `current()` and `tryAdvance()`.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch;
+}
+
+void leave(Epoch epoch) noexcept {
+    const auto own = slot;
+    if (own == nullptr) {
+        readers[epoch % 3].fetch_sub(1);
+    } else if (--depth == 0) {
+        own->state.store(0, std::memory_order_release);
+    }
+}
+
+auto current() noexcept -> Epoch {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return globalEpoch.load(std::memory_order_acquire);
+}
+
+auto tryAdvance() noexcept -> Epoch {
+    auto epoch = globalEpoch.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (auto element = slots.load(std::memory_order_acquire); element != nullptr; element = element->next) {
+        const auto state = element->state.load(std::memory_order_acquire);
+        if ((state & 1) != 0 && state >> 1 != epoch) {
+            return epoch;
+        }
+    }
+    if (readers[(epoch + 2) % 3].load() == 0 && globalEpoch.compare_exchange_strong(epoch, epoch + 1)) {
+        return epoch + 1;
+    }
+    return epoch;
+}
+
+void synchronize(Epoch retired) noexcept {
+    while (!isReclaimable(retired)) {
+        std::this_thread::yield();
+    }
+}
+}
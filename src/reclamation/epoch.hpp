@@ -0,0 +1,109 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef epoch_hpp
+#define epoch_hpp
+
+#include <cstdint>
+
+/**
+ * @brief This namespace contains the epoch-based reclamation of allocation records.
+ *
+ * Records that might still be referenced by other threads are retired together
+ * with the epoch they were retired in. They may only be destroyed once the
+ * global epoch has advanced twice since then, as only then no thread can be
+ * inside a critical section that has started before the record was retired.
+ */
+namespace lsan::epoch {
+/** The type used to represent an epoch. */
+using Epoch = std::uint64_t;
+
+/**
+ * Enters a read-side critical section.
+ *
+ * @return the epoch the critical section has been entered in
+ */
+auto enter() noexcept -> Epoch;
+
+/**
+ * Leaves the read-side critical section entered in the given epoch.
+ *
+ * @param epoch the epoch returned by the corresponding call to `enter()`
+ */
+void leave(Epoch epoch) noexcept;
+
+/**
+ * Returns the current global epoch.
+ *
+ * @return the current global epoch
+ */
+auto current() noexcept -> Epoch;
+
+/**
+ * @brief Attempts to advance the global epoch.
+ *
+ * The epoch is only advanced if no thread is inside a critical section
+ * entered in the previous epoch.
+ *
+ * @return the global epoch after the attempt
+ */
+auto tryAdvance() noexcept -> Epoch;
+
+/**
+ * Returns whether something retired in the given epoch can safely be destroyed.
+ *
+ * @param retired the epoch the object has been retired in
+ * @return whether the object can be destroyed
+ */
+static inline auto isReclaimable(Epoch retired) noexcept -> bool {
+    return tryAdvance() >= retired + 2;
+}
+
+/**
+ * Blocks until everything retired in the given epoch can safely be destroyed.
+ *
+ * @param retired the epoch to wait for
+ */
+void synchronize(Epoch retired) noexcept;
+
+/**
+ * @brief This class represents a read-side critical section.
+ *
+ * As long as an instance exists, allocation records that have been visible
+ * when it was created are not destroyed.
+ */
+class Guard {
+    /** The epoch the critical section has been entered in. */
+    const Epoch epoch;
+
+public:
+    inline Guard() noexcept: epoch(enter()) {}
+    inline ~Guard() noexcept { leave(epoch); }
+
+    Guard(const Guard&) = delete;
+    Guard(Guard&&)      = delete;
+
+    auto operator=(const Guard&) -> Guard& = delete;
+    auto operator=(Guard&&)      -> Guard& = delete;
+};
+}
+
+#endif /* epoch_hpp */
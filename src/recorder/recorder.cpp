@@ -0,0 +1,247 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <new>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef __linux__
+ #include <sys/syscall.h>
+#endif
+
+#include "recorder.hpp"
+
+#include "../lsanMisc.hpp"
+
+namespace lsan::recorder {
+thread_local Ring* ring = nullptr;
+
+/** Indicates whether the calling thread cannot record any more events. */
+static thread_local bool unavailable __attribute__((tls_model("initial-exec"))) = false;
+
+/** The first one of the registered rings.                */
+static std::atomic<Ring*> rings = nullptr;
+/** The key used to release the rings of exiting threads. */
+static pthread_key_t key;
+/** Ensures the key is only created once.                 */
+static pthread_once_t keyOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * Returns the identifier of the calling thread.
+ *
+ * @return the thread identifier
+ */
+static inline auto threadId() noexcept -> std::uint64_t {
+#ifdef __linux__
+    return static_cast<std::uint64_t>(syscall(SYS_gettid));
+#else
+    std::uint64_t id = 0;
+    pthread_threadid_np(nullptr, &id);
+    return id;
+#endif
+}
+
+/**
+ * Releases the given ring of an exiting thread.
+ *
+ * @param value the ring
+ */
+static void release(void* value) {
+    ring        = nullptr;
+    unavailable = true;
+    static_cast<Ring*>(value)->inUse.store(false, std::memory_order_release);
+}
+
+/**
+ * Creates the key used to release the rings.
+ */
+static void createKey() {
+    pthread_key_create(&key, release);
+}
+
+auto acquire() noexcept -> Ring* {
+    if (unavailable || !getBehaviour().flightRecorder()) {
+        return nullptr;
+    }
+
+    Ring* toReturn = nullptr;
+    for (auto element = rings.load(std::memory_order_acquire); element != nullptr; element = element->next) {
+        bool expected = false;
+        if (element->inUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            element->head.store(0, std::memory_order_relaxed);
+            toReturn = element;
+            break;
+        }
+    }
+    if (toReturn == nullptr) {
+        // Mapped directly, as the allocator might be the one being recorded.
+        void* memory = mmap(nullptr, sizeof(Ring), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            unavailable = true;
+            return nullptr;
+        }
+        toReturn = new (memory) Ring();
+        auto first = rings.load(std::memory_order_relaxed);
+        do {
+            toReturn->next = first;
+        } while (!rings.compare_exchange_weak(first, toReturn, std::memory_order_release, std::memory_order_relaxed));
+    }
+    toReturn->thread = threadId();
+    ring = toReturn;
+
+    pthread_once(&keyOnce, createKey);
+    pthread_setspecific(key, toReturn);
+    return toReturn;
+}
+
+/**
+ * @brief This class writes formatted text to a file descriptor.
+ *
+ * It only uses async-signal-safe functions.
+ */
+class Writer {
+    /** The file descriptor to write to.        */
+    const int fd;
+    /** The buffer of the text to be written.   */
+    char buffer[512];
+    /** The amount of used bytes of the buffer. */
+    std::size_t used = 0;
+
+public:
+    inline explicit Writer(int fd) noexcept: fd(fd) {}
+    inline ~Writer() noexcept { flush(); }
+
+    Writer(const Writer&) = delete;
+    auto operator=(const Writer&) -> Writer& = delete;
+
+    /**
+     * Writes the buffered text to the file descriptor.
+     */
+    void flush() noexcept {
+        std::size_t written = 0;
+        while (written < used) {
+            const auto result = write(fd, buffer + written, used - written);
+            if (result <= 0) break;
+            written += static_cast<std::size_t>(result);
+        }
+        used = 0;
+    }
+
+    auto operator<<(const char* string) noexcept -> Writer& {
+        for (; *string != '\0'; ++string) {
+            if (used == sizeof(buffer)) {
+                flush();
+            }
+            buffer[used++] = *string;
+        }
+        return *this;
+    }
+
+    auto operator<<(std::uint64_t number) noexcept -> Writer& {
+        char digits[21];
+        std::size_t i = sizeof(digits) - 1;
+        digits[i] = '\0';
+        do {
+            digits[--i] = static_cast<char>('0' + number % 10);
+            number /= 10;
+        } while (number != 0);
+        return *this << digits + i;
+    }
+
+    auto operator<<(const void* pointer) noexcept -> Writer& {
+        constexpr const char* const hex = "0123456789abcdef";
+
+        auto value = reinterpret_cast<std::uintptr_t>(pointer);
+        char digits[2 * sizeof(value) + 3];
+        std::size_t i = sizeof(digits) - 1;
+        digits[i] = '\0';
+        do {
+            digits[--i] = hex[value & 0xf];
+            value >>= 4;
+        } while (value != 0);
+        digits[--i] = 'x';
+        digits[--i] = '0';
+        return *this << digits + i;
+    }
+};
+
+/**
+ * Returns the name of the given allocation operation.
+ *
+ * @param op the allocation operation
+ * @return the name
+ */
+static constexpr inline auto getName(Op op) noexcept -> const char* {
+    switch (op) {
+        case Op::MALLOC:   return "malloc  ";
+        case Op::CALLOC:   return "calloc  ";
+        case Op::REALLOC:  return "realloc ";
+        case Op::FREE:     return "free    ";
+        case Op::MEMALIGN: return "memalign";
+    }
+    return "unknown ";
+}
+
+/**
+ * Writes the events recorded in the given ring.
+ *
+ * @param out the writer to write to
+ * @param ring the ring
+ * @param now the timestamp the ages of the events are calculated from
+ * @param crashed whether the ring belongs to the crashed thread
+ * @param limit the maximum amount of the most recent events to be written
+ */
+static inline void dumpRing(Writer& out, const Ring& ring, std::uint64_t now, bool crashed, std::size_t limit) noexcept {
+    const auto head  = ring.head.load(std::memory_order_acquire);
+    const auto count = std::min<std::uint64_t>({ head, Ring::capacity, limit });
+    if (count == 0) return;
+
+    out << "\nLast " << count << " allocation events of thread " << ring.thread
+        << (crashed ? " (crashed):\n" : ":\n");
+    for (auto i = head - count; i < head; ++i) {
+        const auto& event = ring.events[i & (Ring::capacity - 1)];
+        out << "  " << getName(event.op) << " " << event.pointer;
+        if (event.op != Op::FREE) {
+            out << " (" << static_cast<std::uint64_t>(event.size) << " B)";
+        }
+        out << " from " << event.caller << ", " << (now - event.timestamp) << " ticks ago\n";
+    }
+}
+
+void dump(int fd, std::size_t others) noexcept {
+    Writer out(fd);
+
+    const auto now = timestamp();
+    const auto own = ring;
+    if (own != nullptr) {
+        dumpRing(out, *own, now, true, Ring::capacity);
+    }
+    for (auto element = rings.load(std::memory_order_acquire); element != nullptr; element = element->next) {
+        if (element == own || !element->inUse.load(std::memory_order_acquire)) continue;
+
+        dumpRing(out, *element, now, false, others);
+    }
+}
+}
@@ -0,0 +1,157 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef recorder_hpp
+#define recorder_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+ #include <x86intrin.h>
+#else
+ #include <ctime>
+#endif
+
+/**
+ * @brief This namespace contains the allocation flight recorder.
+ *
+ * Every thread records its most recent allocation events into a fixed-size
+ * ring. The rings are registered globally and are never deallocated, so the
+ * crash handlers can dump the events of all threads without allocating or
+ * locking anything.
+ */
+namespace lsan::recorder {
+/**
+ * This enumeration contains the recorded allocation operations.
+ */
+enum class Op: std::uint8_t {
+    MALLOC, CALLOC, REALLOC, FREE, MEMALIGN
+};
+
+/**
+ * This structure represents a recorded allocation event.
+ */
+struct Event {
+    /** The timestamp of the event in ticks.                   */
+    std::uint64_t timestamp;
+    /** The pointer the event refers to.                       */
+    const void* pointer;
+    /** The size of the allocation, zero for deallocations.    */
+    std::size_t size;
+    /** The return address of the caller, the compact stack id. */
+    const void* caller;
+    /** The recorded allocation operation.                     */
+    Op op;
+};
+
+/**
+ * This structure represents the ring of recent events of one thread.
+ */
+struct Ring {
+    /** The amount of events a ring can hold, needs to be a power of two. */
+    static constexpr std::size_t capacity = 4096;
+
+    /** The next ring in the global list.                                 */
+    Ring* next = nullptr;
+    /** Indicates whether a thread is currently recording into this ring. */
+    std::atomic_bool inUse = true;
+    /** The identifier of the thread recording into this ring.           */
+    std::uint64_t thread = 0;
+    /** The total amount of events recorded into this ring.              */
+    std::atomic<std::uint64_t> head = 0;
+    /** The recorded events.                                             */
+    Event events[capacity];
+};
+
+/** The ring of the calling thread, `nullptr` if not yet acquired. */
+extern thread_local Ring* ring __attribute__((tls_model("initial-exec")));
+
+/**
+ * @brief Acquires a ring for the calling thread.
+ *
+ * A ring released by an exited thread is reused if available.
+ *
+ * @return the acquired ring or `nullptr` if none can be used
+ */
+auto acquire() noexcept -> Ring*;
+
+/**
+ * Returns the current timestamp in ticks of the fastest available clock.
+ *
+ * @return the current timestamp
+ */
+static inline auto timestamp() noexcept -> std::uint64_t {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t ticks;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+#else
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<std::uint64_t>(time.tv_sec) * 1000000000 + static_cast<std::uint64_t>(time.tv_nsec);
+#endif
+}
+
+/**
+ * @brief Records the given allocation event for the calling thread.
+ *
+ * Only the owning thread writes into its ring, so recording an event does
+ * not need any synchronization.
+ *
+ * @param op the allocation operation
+ * @param pointer the pointer the event refers to
+ * @param size the size of the allocation
+ * @param caller the return address of the caller of the allocator
+ */
+static inline void record(Op op, const void* pointer, std::size_t size, const void* caller) noexcept {
+    auto current = ring;
+    if (__builtin_expect(current == nullptr, false) && (current = acquire()) == nullptr) {
+        return;
+    }
+    const auto index = current->head.load(std::memory_order_relaxed);
+    auto& event = current->events[index & (Ring::capacity - 1)];
+    event.timestamp = timestamp();
+    event.pointer   = pointer;
+    event.size      = size;
+    event.caller    = caller;
+    event.op        = op;
+    current->head.store(index + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Writes the recorded events of all threads to the given file descriptor.
+ *
+ * The events of the calling thread are written first. Only async-signal-safe
+ * functions are used. The events of the other threads might still be changing
+ * while they are written.
+ *
+ * @param fd the file descriptor to write to
+ * @param others the maximum amount of the most recent events written per other thread
+ */
+void dump(int fd, std::size_t others) noexcept;
+}
+
+#endif /* recorder_hpp */
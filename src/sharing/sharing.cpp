@@ -0,0 +1,87 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "sharing.hpp"
+
+namespace lsan::sharing {
+auto analyze(std::vector<Block>& blocks) -> Result {
+    std::sort(blocks.begin(), blocks.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.begin < rhs.begin;
+    });
+
+    // The boundary lines in address order, as the blocks do not overlap.
+    std::vector<std::pair<std::uintptr_t, const Block*>> lines;
+    lines.reserve(blocks.size() * 2);
+    for (const auto& block : blocks) {
+        if (block.size == 0) continue;
+
+        const auto first = block.begin / lineSize,
+                   last  = (block.begin + block.size - 1) / lineSize;
+        lines.emplace_back(first, &block);
+        if (last != first) {
+            lines.emplace_back(last, &block);
+        }
+    }
+
+    Result toReturn;
+    std::map<std::pair<std::size_t, std::size_t>, std::size_t> pairs;
+    std::vector<std::pair<std::size_t, std::size_t>> linePairs;
+    for (std::size_t i = 0; i < lines.size();) {
+        std::size_t end = i + 1;
+        while (end < lines.size() && lines[end].first == lines[i].first) ++end;
+
+        ++toReturn.lines;
+        linePairs.clear();
+        for (std::size_t a = i; a < end; ++a) {
+            for (std::size_t b = a + 1; b < end; ++b) {
+                const auto& lhs = *lines[a].second;
+                const auto& rhs = *lines[b].second;
+                if (lhs.owner != rhs.owner) {
+                    linePairs.push_back(std::minmax(lhs.site, rhs.site));
+                }
+            }
+        }
+        if (!linePairs.empty()) {
+            ++toReturn.sharedLines;
+            std::sort(linePairs.begin(), linePairs.end());
+            linePairs.erase(std::unique(linePairs.begin(), linePairs.end()), linePairs.end());
+            for (const auto& pair : linePairs) {
+                ++pairs[pair];
+            }
+        }
+        i = end;
+    }
+
+    toReturn.pairs.reserve(pairs.size());
+    for (const auto& [sites, count] : pairs) {
+        toReturn.pairs.push_back({ sites.first, sites.second, count });
+    }
+    std::sort(toReturn.pairs.begin(), toReturn.pairs.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.lines > rhs.lines;
+    });
+    return toReturn;
+}
+}
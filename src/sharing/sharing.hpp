@@ -0,0 +1,92 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef sharing_hpp
+#define sharing_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief This namespace contains the detection of potential false sharing between heap blocks.
+ *
+ * A cache line holding blocks allocated by different threads is potentially
+ * written to by these threads concurrently. The threads writing to a block are
+ * not known, the allocating thread stands in for them.
+ */
+namespace lsan::sharing {
+/** The assumed size of the cache lines in bytes. */
+static constexpr std::uintptr_t lineSize = 64;
+
+/**
+ * This structure represents a live block.
+ */
+struct Block {
+    /** The address of the block.                             */
+    std::uintptr_t begin;
+    /** The size of the block.                                */
+    std::size_t size;
+    /** The identity of the allocating thread.                */
+    std::uint32_t owner;
+    /** The index of the allocation site of the block.        */
+    std::size_t site;
+};
+
+/**
+ * This structure contains the cache lines shared by the blocks of two allocation sites.
+ */
+struct SitePair {
+    /** The index of the first allocation site.                        */
+    std::size_t first;
+    /** The index of the second allocation site.                       */
+    std::size_t second;
+    /** The amount of cache lines shared by different threads.         */
+    std::size_t lines;
+};
+
+/**
+ * This structure contains the result of the false sharing analysis.
+ */
+struct Result {
+    /** The amount of cache lines holding blocks of multiple threads. */
+    std::size_t sharedLines = 0;
+    /** The amount of cache lines holding the start or end of a block. */
+    std::size_t lines = 0;
+    /** The pairs of allocation sites, sorted by their shared lines.   */
+    std::vector<SitePair> pairs;
+};
+
+/**
+ * @brief Finds the cache lines holding blocks allocated by different threads.
+ *
+ * Only the first and the last cache line of the blocks are considered, as the
+ * lines in between belong to a single block. For small blocks, these are all of
+ * their lines. The blocks are sorted by their address.
+ *
+ * @param blocks the live blocks
+ * @return the found shared cache lines by pair of allocation sites
+ */
+auto analyze(std::vector<Block>& blocks) -> Result;
+}
+
+#endif /* sharing_hpp */
@@ -24,6 +24,8 @@
 #include <optional>
 #include <string>
 
+#include <unistd.h>
+
 #ifdef __APPLE__
  #define _XOPEN_SOURCE
  #include <ucontext.h>
@@ -41,7 +43,9 @@
 #include "../MallocInfo.hpp"
 #include "../utils.hpp"
 #include "../callstacks/callstackHelper.hpp"
+#include "../allocations/guarded.hpp"
 #include "../crashWarner/crash.hpp"
+#include "../recorder/recorder.hpp"
 
 namespace lsan::signals::handlers {
 /**
@@ -340,18 +344,53 @@ static inline auto stringifyReason(const int signalCode, const int code) -> std:
     return std::nullopt;
 }
 
+/**
+ * Prints the crash report if the given signal has been caused by an invalid
+ * access of a block in the guarded pool.
+ *
+ * @param signalCode the signal code
+ * @param info the signal information
+ * @param ptr the pointer to the execution context
+ * @return whether the crash report has been printed
+ */
+static inline auto maybePrintGuarded(int signalCode, siginfo_t* info, void* ptr) -> bool {
+    using formatter::Style;
+
+    const auto& access = guarded::describe(info->si_addr);
+    if (!access.has_value()) return false;
+
+    const auto& [kind, record] = *access;
+    const auto address = reinterpret_cast<std::uintptr_t>(info->si_addr),
+               begin   = reinterpret_cast<std::uintptr_t>(record->pointer),
+               end     = begin + record->size;
+    const auto position = address >= end  ? std::to_string(address - end)   + " bytes after the end of"
+                        : address < begin ? std::to_string(begin - address) + " bytes before"
+                        :                   std::to_string(address - begin) + " bytes inside of";
+    printCrash(formatter::formatString<Style::BOLD, Style::RED>(kind)
+               + " (" + stringify(signalCode) + ") on address " + formatter::formatString<Style::BOLD>(utils::toString(info->si_addr)),
+               formatter::formatString<Style::RED>(position + " the block of " + std::to_string(record->size) + " bytes")
+               + " (" + stringifyReason(signalCode, info->si_code).value_or("Unknown reason") + ")",
+               *record,
+               createCallstackFor(ptr));
+    return true;
+}
+
 [[ noreturn ]] void crashWithTrace(int signalCode, siginfo_t* info, void* ptr) {
     using formatter::Style;
 
     getTracker().ignoreMalloc = true;
-    const auto reason = getReason(signalCode, info->si_code);
-    crashForce(formatter::formatString<Style::BOLD, Style::RED>(getDescriptionFor(signalCode))
-               + " (" + stringify(signalCode) + ")"
-               + (hasAddress(signalCode) ? " on address " + formatter::formatString<Style::BOLD>(utils::toString(info->si_addr)) : ""),
-               reason.has_value()
-                ? std::optional(formatter::formatString<Style::RED>(*reason) + " (" + stringifyReason(signalCode, info->si_code).value_or("Unknown reason") + ")")
-                : std::nullopt,
-               createCallstackFor(ptr));
+    if (!hasAddress(signalCode) || !maybePrintGuarded(signalCode, info, ptr)) {
+        const auto reason = getReason(signalCode, info->si_code);
+        printCrash(formatter::formatString<Style::BOLD, Style::RED>(getDescriptionFor(signalCode))
+                   + " (" + stringify(signalCode) + ")"
+                   + (hasAddress(signalCode) ? " on address " + formatter::formatString<Style::BOLD>(utils::toString(info->si_addr)) : ""),
+                   reason.has_value()
+                    ? std::optional(formatter::formatString<Style::RED>(*reason) + " (" + stringifyReason(signalCode, info->si_code).value_or("Unknown reason") + ")")
+                    : std::nullopt,
+                   createCallstackFor(ptr));
+    }
+    recorder::dump(STDERR_FILENO, getBehaviour().recorderEvents());
+    lsan::abort();
 }
 
 void callstack(int, siginfo_t*, void* context) {
@@ -0,0 +1,75 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+
+#include "SiteSketch.hpp"
+
+namespace lsan {
+void SiteSketch::Candidates::offer(std::uint64_t id, const Cell& estimate, const lcs::callstack& callstack) {
+    const auto key = byBytes ? estimate.bytes : estimate.count;
+    if (sites.size() == capacity && key <= keys[minimum]) return;
+
+    std::size_t index = 0;
+    for (; index < sites.size() && ids[index] != id; ++index);
+    if (index < sites.size()) {
+        sites[index].count = estimate.count;
+        sites[index].bytes = estimate.bytes;
+    } else if (sites.size() < capacity) {
+        sites.push_back({ id, estimate.count, estimate.bytes, callstack });
+    } else {
+        index = minimum;
+        sites[index] = { id, estimate.count, estimate.bytes, callstack };
+    }
+    ids[index]  = id;
+    keys[index] = key;
+
+    minimum = 0;
+    for (std::size_t i = 1; i < sites.size(); ++i) {
+        if (keys[i] < keys[minimum]) {
+            minimum = i;
+        }
+    }
+}
+
+auto SiteSketch::Candidates::get() const -> std::vector<Site> {
+    auto toReturn = sites;
+    std::sort(toReturn.begin(), toReturn.end(), [this](const auto& lhs, const auto& rhs) {
+        return byBytes ? lhs.bytes > rhs.bytes : lhs.count > rhs.count;
+    });
+    return toReturn;
+}
+
+void SiteSketch::add(std::uint64_t id, std::size_t size, const lcs::callstack& callstack) {
+    Cell estimate { SIZE_MAX, SIZE_MAX };
+    for (std::size_t row = 0; row < depth; ++row) {
+        auto& cell = cells[row][indexOf(id, row)];
+        ++cell.count;
+        cell.bytes += size;
+
+        estimate.count = std::min(estimate.count, cell.count);
+        estimate.bytes = std::min(estimate.bytes, cell.bytes);
+    }
+    byCount.offer(id, estimate, callstack);
+    byBytes.offer(id, estimate, callstack);
+}
+}
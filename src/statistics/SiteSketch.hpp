@@ -0,0 +1,154 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SiteSketch_hpp
+#define SiteSketch_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <callstack.h>
+
+namespace lsan {
+/**
+ * @brief This class estimates the heaviest allocation sites within a fixed amount of memory.
+ *
+ * The allocations are counted in a count-min sketch, the sites with the
+ * highest estimated counts and bytes are kept as candidates. The estimates
+ * are never lower than the actual values.
+ */
+class SiteSketch {
+public:
+    /** The amount of rows of the sketch.                    */
+    static constexpr std::size_t depth     = 4;
+    /** The binary logarithm of the amount of cells per row. */
+    static constexpr std::size_t widthBits = 10;
+    /** The amount of cells per row.                         */
+    static constexpr std::size_t width     = std::size_t(1) << widthBits;
+    /** The amount of candidates kept per ranking.           */
+    static constexpr std::size_t capacity  = 16;
+
+    /**
+     * This structure contains the estimates of an allocation site.
+     */
+    struct Site {
+        /** The identifier of the callstack of this site.        */
+        std::uint64_t id;
+        /** The estimated amount of allocations.                 */
+        std::size_t count,
+        /** The estimated amount of allocated bytes.             */
+                    bytes;
+        /** The callstack of the first counted allocation.       */
+        lcs::callstack callstack;
+    };
+
+private:
+    /**
+     * This structure represents a cell of the sketch.
+     */
+    struct Cell {
+        /** The counted allocations.      */
+        std::size_t count = 0,
+        /** The counted allocated bytes. */
+                    bytes = 0;
+    };
+
+    /**
+     * This class keeps the allocation sites with the highest estimates.
+     */
+    class Candidates {
+        /** Whether to rank by the allocated bytes.          */
+        bool byBytes;
+        /** The index of the candidate with the lowest key. */
+        std::size_t minimum = 0;
+        /** The identifiers of the candidates.              */
+        std::uint64_t ids[capacity] {};
+        /** The ranking keys of the candidates.             */
+        std::size_t keys[capacity] {};
+        /** The candidates.                                 */
+        std::vector<Site> sites;
+
+    public:
+        inline explicit Candidates(bool byBytes): byBytes(byBytes) {}
+
+        /**
+         * Offers the given estimates of an allocation site to be kept.
+         *
+         * @param id the identifier of the allocation site
+         * @param estimate the estimates of the allocation site
+         * @param callstack the callstack of the allocation site
+         */
+        void offer(std::uint64_t id, const Cell& estimate, const lcs::callstack& callstack);
+
+        /**
+         * Returns the candidates sorted by their key in descending order.
+         *
+         * @return the sorted candidates
+         */
+        auto get() const -> std::vector<Site>;
+    };
+
+    /** The cells of the sketch.                        */
+    Cell cells[depth][width];
+    /** The sites with the highest allocation counts.   */
+    Candidates byCount { false },
+    /** The sites with the highest allocated bytes.     */
+               byBytes { true };
+
+    /**
+     * Returns the index of the cell of the given site in the given row.
+     *
+     * @param id the identifier of the allocation site
+     * @param row the row
+     * @return the index of the cell
+     */
+    static inline auto indexOf(std::uint64_t id, std::size_t row) noexcept -> std::size_t {
+        constexpr std::uint64_t seeds[depth] = {
+            0x9e3779b97f4a7c15, 0xc2b2ae3d27d4eb4f, 0x165667b19e3779f9, 0xd6e8feb86659fd93
+        };
+        return static_cast<std::size_t>((id * seeds[row]) >> (64 - widthBits));
+    }
+
+public:
+    /**
+     * Counts an allocation of the given allocation site.
+     *
+     * @param id the identifier of the allocation site
+     * @param size the size of the allocation
+     * @param callstack the callstack of the allocation
+     */
+    void add(std::uint64_t id, std::size_t size, const lcs::callstack& callstack);
+
+    /**
+     * Returns the allocation sites with the highest estimated counts or bytes.
+     *
+     * @param bytes whether to rank by the allocated bytes instead of the counts
+     * @return the heaviest allocation sites in descending order
+     */
+    inline auto getTopSites(bool bytes) const -> std::vector<Site> {
+        return bytes ? byBytes.get() : byCount.get();
+    }
+};
+}
+
+#endif /* SiteSketch_hpp */
@@ -28,7 +28,13 @@ Stats::Stats(const Stats & other)
       currentBytes(other.currentBytes),
       totalBytes(other.totalBytes),
       peekBytes(other.peekBytes),
-      freeCount(other.freeCount)
+      freeCount(other.freeCount),
+      slack(other.slack),
+      slackClasses(other.slackClasses),
+      slackSites(other.slackSites),
+      numaSites(other.numaSites),
+      flowSites(other.flowSites),
+      sites(other.sites)
 {}
 
 Stats::Stats(Stats && other)
@@ -39,7 +45,13 @@ Stats::Stats(Stats && other)
       currentBytes(std::move(other.currentBytes)),
       totalBytes(std::move(other.totalBytes)),
       peekBytes(std::move(other.peekBytes)),
-      freeCount(std::move(other.freeCount))
+      freeCount(std::move(other.freeCount)),
+      slack(std::move(other.slack)),
+      slackClasses(std::move(other.slackClasses)),
+      slackSites(std::move(other.slackSites)),
+      numaSites(std::move(other.numaSites)),
+      flowSites(std::move(other.flowSites)),
+      sites(std::move(other.sites))
 {}
 
 Stats & Stats::operator=(const Stats & other) {
@@ -53,6 +65,13 @@ Stats & Stats::operator=(const Stats & other) {
         peekBytes    = other.peekBytes;
         
         freeCount = other.freeCount;
+
+        slack        = other.slack;
+        slackClasses = other.slackClasses;
+        slackSites   = other.slackSites;
+        numaSites    = other.numaSites;
+        flowSites    = other.flowSites;
+        sites        = other.sites;
     }
     return *this;
 }
@@ -68,6 +87,13 @@ Stats & Stats::operator=(Stats && other) {
         peekBytes    = std::move(other.peekBytes);
         
         freeCount = std::move(other.freeCount);
+
+        slack        = std::move(other.slack);
+        slackClasses = std::move(other.slackClasses);
+        slackSites   = std::move(other.slackSites);
+        numaSites    = std::move(other.numaSites);
+        flowSites    = std::move(other.flowSites);
+        sites        = std::move(other.sites);
     }
     return *this;
 }
@@ -114,9 +140,91 @@ auto Stats::getTotalFreeCount() const -> std::size_t {
     return freeCount;
 }
 
+auto Stats::getSlack() const -> Slack {
+    std::lock_guard lock(mutex);
+
+    return slack;
+}
+
+auto Stats::getSlackClasses() const -> std::map<std::size_t, Slack> {
+    std::lock_guard lock(mutex);
+
+    return slackClasses;
+}
+
+auto Stats::getSlackSites() const -> std::map<std::uint64_t, SlackSite> {
+    std::lock_guard lock(mutex);
+
+    return slackSites;
+}
+
+auto Stats::getNumaSites() const -> std::map<std::uint64_t, NumaSite> {
+    std::lock_guard lock(mutex);
+
+    return numaSites;
+}
+
+auto Stats::getFlowSites() const -> std::map<std::uint64_t, FlowSite> {
+    std::lock_guard lock(mutex);
+
+    return flowSites;
+}
+
+auto Stats::getTopSites(bool bytes) const -> std::vector<SiteSketch::Site> {
+    std::lock_guard lock(mutex);
+
+    return sites.getTopSites(bytes);
+}
+
+void Stats::Slack::add(std::size_t requestedSize, std::size_t usableSize) {
+    ++count;
+    requested += requestedSize;
+    usable    += usableSize;
+    if (requestedSize < minRequest) {
+        minRequest = requestedSize;
+    }
+    if (requestedSize > maxRequest) {
+        maxRequest = requestedSize;
+    }
+}
+
+void Stats::addSlackCore(const MallocInfo& info) {
+    if (info.usableSize < info.size) return;
+
+    slack.add(info.size, info.usableSize);
+    slackClasses[info.usableSize].add(info.size, info.usableSize);
+    slackSites.try_emplace(info.getStackId(), info.createdCallstack).first->second.add(info.size, info.usableSize);
+}
+
+void Stats::addMalloc(const MallocInfo& info) {
+    const auto id = info.getStackId();
+    std::lock_guard lock(mutex);
+
+    addMallocCore(info.size);
+    sites.add(id, info.size, info.createdCallstack);
+    if (info.usableSize != 0) {
+        addSlackCore(info);
+    }
+}
+
+void Stats::replaceMalloc(std::size_t oldSize, const MallocInfo& info) {
+    const auto id = info.getStackId();
+    std::lock_guard lock(mutex);
+
+    replaceMallocCore(oldSize, info.size);
+    sites.add(id, info.size, info.createdCallstack);
+    if (info.usableSize != 0) {
+        addSlackCore(info);
+    }
+}
+
 void Stats::addMalloc(std::size_t size) {
     std::lock_guard lock(mutex);
-    
+
+    addMallocCore(size);
+}
+
+void Stats::addMallocCore(std::size_t size) {
     ++currentMallocCount;
     ++totalMallocCount;
     if (peekMallocCount < currentMallocCount) {
@@ -132,7 +240,11 @@ void Stats::addMalloc(std::size_t size) {
 
 void Stats::replaceMalloc(std::size_t oldSize, std::size_t newSize) {
     std::lock_guard lock(mutex);
-    
+
+    replaceMallocCore(oldSize, newSize);
+}
+
+void Stats::replaceMallocCore(std::size_t oldSize, std::size_t newSize) {
     currentBytes -= oldSize;
     currentBytes += newSize;
     if (peekBytes < currentBytes) {
@@ -151,4 +263,24 @@ void Stats::addFree(std::size_t size) {
     --currentMallocCount;
     currentBytes -= size;
 }
+
+void Stats::addNumaFree(const MallocInfo& info, int blockNode, int freeingNode) {
+    std::lock_guard lock(mutex);
+
+    auto& site = numaSites.try_emplace(info.getStackId(), info.createdCallstack).first->second;
+    ++site.frees;
+    site.bytes += info.size;
+    if (blockNode >= 0 && blockNode != freeingNode) {
+        ++site.remoteFrees;
+        site.remoteBytes += info.size;
+    }
+}
+
+void Stats::addRemoteFree(const MallocInfo& info) {
+    std::lock_guard lock(mutex);
+
+    auto& site = flowSites.try_emplace(info.getStackId(), info.createdCallstack).first->second;
+    ++site.count;
+    site.bytes += info.size;
+}
 }
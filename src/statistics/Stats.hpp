@@ -23,8 +23,12 @@
 #define Stats_hpp
 
 #include <cstddef>
+#include <cstdint>
+#include <map>
 #include <mutex>
+#include <vector>
 
+#include "SiteSketch.hpp"
 #include "../MallocInfo.hpp"
 
 namespace lsan {
@@ -32,6 +36,83 @@ namespace lsan {
  * This class contains all statistics that this sanitizer produces.
  */
 class Stats {
+public:
+    /**
+     * This structure contains the allocator slack of a group of allocations.
+     */
+    struct Slack {
+        /** The count of allocations.               */
+        std::size_t count      = 0,
+        /** The sum of the requested sizes.         */
+                    requested  = 0,
+        /** The sum of the usable sizes.            */
+                    usable     = 0,
+        /** The smallest requested size.            */
+                    minRequest = SIZE_MAX,
+        /** The largest requested size.             */
+                    maxRequest = 0;
+
+        /**
+         * Adds an allocation to this slack record.
+         *
+         * @param requestedSize the requested size of the allocation
+         * @param usableSize the usable size reported by the allocator
+         */
+        void add(std::size_t requestedSize, std::size_t usableSize);
+
+        /**
+         * Returns the amount of bytes allocated but not requested.
+         *
+         * @return the wasted bytes
+         */
+        constexpr inline auto wasted() const -> std::size_t {
+            return usable - requested;
+        }
+    };
+
+    /**
+     * This structure contains the allocator slack of an allocation site.
+     */
+    struct SlackSite: Slack {
+        /** The callstack of the first allocation of this site. */
+        lcs::callstack callstack;
+
+        inline explicit SlackSite(const lcs::callstack& callstack): callstack(callstack) {}
+    };
+
+    /**
+     * This structure contains the sampled deallocations of an allocation site.
+     */
+    struct NumaSite {
+        /** The callstack of the first allocation of this site.                    */
+        lcs::callstack callstack;
+        /** The amount of sampled deallocations.                                   */
+        std::size_t frees       = 0,
+        /** The amount of sampled deallocations of blocks placed on another node. */
+                    remoteFrees = 0,
+        /** The sampled deallocated bytes.                                         */
+                    bytes       = 0,
+        /** The sampled deallocated bytes placed on another node.                  */
+                    remoteBytes = 0;
+
+        inline explicit NumaSite(const lcs::callstack& callstack): callstack(callstack) {}
+    };
+
+    /**
+     * This structure contains the blocks of an allocation site deallocated by another thread.
+     */
+    struct FlowSite {
+        /** The callstack of the first allocation of this site. */
+        lcs::callstack callstack;
+        /** The amount of blocks deallocated by another thread. */
+        std::size_t count = 0,
+        /** The bytes deallocated by another thread.            */
+                    bytes = 0;
+
+        inline explicit FlowSite(const lcs::callstack& callstack): callstack(callstack) {}
+    };
+
+private:
     /** The mutex used to protect the statistics.                     */
     mutable std::mutex mutex;
     
@@ -51,6 +132,39 @@ class Stats {
     
     /** The count of deallocations tracked by this sanitizer.         */
     std::size_t freeCount = 0;
+
+    /** The allocator slack of all allocations.                       */
+    Slack slack;
+    /** The allocator slack mapped to the usable sizes.               */
+    std::map<std::size_t, Slack> slackClasses;
+    /** The allocator slack mapped to the allocation sites.           */
+    std::map<std::uint64_t, SlackSite> slackSites;
+    /** The sampled deallocations mapped to the allocation sites.     */
+    std::map<std::uint64_t, NumaSite> numaSites;
+    /** The remote deallocations mapped to the allocation sites.      */
+    std::map<std::uint64_t, FlowSite> flowSites;
+    /** The estimates of the heaviest allocation sites.               */
+    SiteSketch sites;
+
+    /**
+     * Adds the allocator slack of the given allocation record. Does not lock.
+     *
+     * @param info the allocation record with the recorded usable size
+     */
+    void addSlackCore(const MallocInfo& info);
+    /**
+     * Adds the given size to the tracked allocations. Does not lock.
+     *
+     * @param size the size of the allocated object
+     */
+    void addMallocCore(std::size_t size);
+    /**
+     * Exchanges an allocation using the given values. Does not lock.
+     *
+     * @param oldSize the size to subtract
+     * @param newSize the size to add
+     */
+    void replaceMallocCore(std::size_t oldSize, std::size_t newSize);
     
 public:
     Stats() = default;
@@ -106,6 +220,47 @@ public:
      * @return the total count of deallocations
      */
     auto getTotalFreeCount() const -> std::size_t;
+
+    /**
+     * Returns the allocator slack of all allocations whose usable size was recorded.
+     *
+     * @return the total allocator slack
+     */
+    auto getSlack() const -> Slack;
+    /**
+     * Returns the allocator slack mapped to the usable sizes of the allocations.
+     *
+     * @return the allocator slack per size class
+     */
+    auto getSlackClasses() const -> std::map<std::size_t, Slack>;
+    /**
+     * Returns the allocator slack mapped to the hashes of the allocation sites.
+     *
+     * @return the allocator slack per allocation site
+     */
+    auto getSlackSites() const -> std::map<std::uint64_t, SlackSite>;
+
+    /**
+     * Returns the sampled deallocations mapped to the hashes of the allocation sites.
+     *
+     * @return the sampled deallocations per allocation site
+     */
+    auto getNumaSites() const -> std::map<std::uint64_t, NumaSite>;
+
+    /**
+     * Returns the blocks deallocated by another thread mapped to the hashes of the allocation sites.
+     *
+     * @return the blocks deallocated by another thread per allocation site
+     */
+    auto getFlowSites() const -> std::map<std::uint64_t, FlowSite>;
+
+    /**
+     * Returns the allocation sites with the highest estimated allocation counts or bytes.
+     *
+     * @param bytes whether to rank by the allocated bytes instead of the allocation counts
+     * @return the heaviest allocation sites in descending order
+     */
+    auto getTopSites(bool bytes) const -> std::vector<SiteSketch::Site>;
     
     /**
      * Adds the given size to the tracked allocations.
@@ -120,9 +275,7 @@ public:
      *
      * @param info the allocation record to append
      */
-    inline void addMalloc(const MallocInfo& info) {
-        addMalloc(info.size);
-    }
+    void addMalloc(const MallocInfo& info);
     
     /**
      * Exchanges an allocation using the given values.
@@ -131,6 +284,15 @@ public:
      * @param newSize the size to add
      */
     void replaceMalloc(std::size_t oldSize, std::size_t newSize);
+    /**
+     * @brief Exchanges an allocation using the given allocation record.
+     *
+     * The allocator slack of the new record is added if its usable size was recorded.
+     *
+     * @param oldSize the size to subtract
+     * @param info the new allocation record
+     */
+    void replaceMalloc(std::size_t oldSize, const MallocInfo& info);
     
     /**
      * Adds a deallocation to the statistics.
@@ -149,6 +311,25 @@ public:
         addFree(info.size);
     }
     
+    /**
+     * @brief Adds a sampled deallocation to the NUMA statistics.
+     *
+     * The deallocation is remote if the block is placed on another node than
+     * the one of the deallocating thread.
+     *
+     * @param info the allocation record of the deallocated block
+     * @param blockNode the node the block is placed on
+     * @param freeingNode the node of the deallocating thread
+     */
+    void addNumaFree(const MallocInfo& info, int blockNode, int freeingNode);
+
+    /**
+     * Adds the deallocation of a block by another thread than the allocating one.
+     *
+     * @param info the allocation record of the deallocated block
+     */
+    void addRemoteFree(const MallocInfo& info);
+
     /**
      * Adds the given allocation record to this instance and returns itself.
      *
@@ -19,10 +19,20 @@
  * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <ctime>
 #include <iostream>
 #include <functional>
+#include <iterator>
+#include <map>
+#include <numeric>
+#include <vector>
 
+#include <unistd.h>
+
+#include <lsan_dump.h>
 #include <lsan_internals.h>
 #include <lsan_stats.h>
 
@@ -30,18 +40,28 @@
 #include "../bytePrinter.hpp"
 #include "../lsanMisc.hpp"
 #include "../LeakSani.hpp"
+#include "../cow/cow.hpp"
+#include "../dump/dump.hpp"
+#include "../flow/flow.hpp"
+#include "../governor/governor.hpp"
+#include "../numa/numa.hpp"
+#include "../sharing/sharing.hpp"
+#include "../types/types.hpp"
+
+#include "statsMode.hpp"
+#include "threadCounters.hpp"
 
 using namespace lsan;
 
-auto __lsan_getTotalMallocs() -> std::size_t { return getStats().getTotalMallocCount(); }
-auto __lsan_getTotalBytes()   -> std::size_t { return getStats().getTotalBytes();       }
-auto __lsan_getTotalFrees()   -> std::size_t { return getStats().getTotalFreeCount();   }
+auto __lsan_getTotalMallocs() -> std::size_t { return statsMode::active() ? statsMode::getTotalMallocCount() : getStats().getTotalMallocCount(); }
+auto __lsan_getTotalBytes()   -> std::size_t { return statsMode::active() ? statsMode::getTotalBytes()       : getStats().getTotalBytes();       }
+auto __lsan_getTotalFrees()   -> std::size_t { return statsMode::active() ? statsMode::getTotalFreeCount()   : getStats().getTotalFreeCount();   }
 
-auto __lsan_getCurrentMallocCount() -> std::size_t { return getStats().getCurrentMallocCount(); }
-auto __lsan_getCurrentByteCount()   -> std::size_t { return getStats().getCurrentBytes();       }
+auto __lsan_getCurrentMallocCount() -> std::size_t { return statsMode::active() ? statsMode::getCurrentMallocCount() : getStats().getCurrentMallocCount(); }
+auto __lsan_getCurrentByteCount()   -> std::size_t { return statsMode::active() ? statsMode::getCurrentBytes()       : getStats().getCurrentBytes();       }
 
-auto __lsan_getMallocPeek() -> std::size_t { return getStats().getMallocPeek(); }
-auto __lsan_getBytePeek()   -> std::size_t { return getStats().getBytePeek();   }
+auto __lsan_getMallocPeek() -> std::size_t { return statsMode::active() ? statsMode::getMallocPeek() : getStats().getMallocPeek(); }
+auto __lsan_getBytePeek()   -> std::size_t { return statsMode::active() ? statsMode::getBytePeek()   : getStats().getBytePeek();   }
 
 /**
  * @brief Prints the statistics using the given parameters.
@@ -299,7 +319,11 @@ void __lsan_printFragmentationStatsWithWidth(std::size_t width) {
     bool ignore = getTracker().ignoreMalloc;
     getTracker().ignoreMalloc = true;
     auto & out = getOutputStream();
-    if (getBehaviour().statsActive()) {
+    if (statsMode::active()) {
+        out << formatter::get<Style::RED>
+            << formatter::format<Style::BOLD>("No memory fragmentation stats available in the stats-only mode!")
+            << formatter::clear<Style::RED> << std::endl << std::endl;
+    } else if (getBehaviour().statsActive()) {
         __lsan_printStatsCore("memory fragmentation", width, out,
                               __lsan_printFragmentationByteBar,
                               __lsan_printFragmentationObjectBar);
@@ -317,6 +341,146 @@ void __lsan_printFragmentationStatsWithWidth(std::size_t width) {
     getTracker().ignoreMalloc = ignore;
 }
 
+/**
+ * Prints the given value of the given setting adjusted by the overhead governor.
+ *
+ * @param knob the adjusted setting
+ * @param value the value of the setting
+ * @param out the output stream to print to
+ */
+static inline void __lsan_printKnobValue(governor::Knob knob, std::size_t value, std::ostream& out) {
+    switch (knob) {
+        case governor::Knob::DELETION_STACKS:
+        case governor::Knob::WARNINGS:
+            out << (value != 0 ? "on" : "off");
+            break;
+
+        case governor::Knob::SAMPLE_RATE:
+            out << "x" << value;
+            break;
+
+        default:
+            out << value << " frames";
+            break;
+    }
+}
+
+/**
+ * Prints the state and the adjustments of the overhead governor.
+ *
+ * @param out the output stream to print to
+ */
+static inline void __lsan_printGovernorStats(std::ostream& out) {
+    using formatter::Style;
+
+    char buffer[64] {};
+    const auto& [overhead, memory] = governor::getMeasurement();
+    std::snprintf(buffer, sizeof(buffer), "%.2f %% hook overhead, %.2f %% internal memory", overhead, memory);
+    out << formatter::format<Style::ITALIC>("Overhead governor:") << std::endl
+        << formatter::clearAll()
+        << buffer << " (budget " << *getBehaviour().overheadBudget() << " %)." << std::endl
+        << governor::toString(governor::Knob::SAMPLE_RATE) << ": ";
+    __lsan_printKnobValue(governor::Knob::SAMPLE_RATE, governor::getSampleFactor(), out);
+    out << ", " << governor::toString(governor::Knob::DELETION_STACKS) << ": ";
+    __lsan_printKnobValue(governor::Knob::DELETION_STACKS, governor::captureDeletions(), out);
+    out << ", " << governor::toString(governor::Knob::CAPTURE_DEPTH) << ": ";
+    __lsan_printKnobValue(governor::Knob::CAPTURE_DEPTH, governor::getCaptureDepth(), out);
+    out << ", " << governor::toString(governor::Knob::WARNINGS) << ": ";
+    __lsan_printKnobValue(governor::Knob::WARNINGS, governor::checkWarnings(), out);
+    out << "." << std::endl << std::endl;
+
+    governor::Adjustment adjustments[governor::adjustmentCapacity];
+    const auto count = governor::getAdjustments(adjustments);
+    const auto total = governor::getAdjustmentCount();
+    out << formatter::format<Style::UNDERLINED>(std::to_string(total) + (total == 1 ? " adjustment:" : " adjustments:")) << std::endl;
+    if (total > count) {
+        out << formatter::format<Style::ITALIC>(std::to_string(total - count) + " earlier adjustments omitted.") << std::endl;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto& adjustment = adjustments[i];
+        const auto time = std::chrono::system_clock::to_time_t(adjustment.timestamp);
+        tm local;
+        localtime_r(&time, &local);
+        std::strftime(buffer, sizeof(buffer), "%H:%M:%S", &local);
+        out << formatter::format<Style::GREYED>(buffer) << " "
+            << formatter::format<Style::BOLD>(governor::toString(adjustment.knob)) << ": ";
+        __lsan_printKnobValue(adjustment.knob, adjustment.from, out);
+        out << " -> ";
+        __lsan_printKnobValue(adjustment.knob, adjustment.to, out);
+        std::snprintf(buffer, sizeof(buffer), " (%.2f %% overhead, %.2f %% memory)", adjustment.overhead, adjustment.memory);
+        out << buffer << std::endl;
+    }
+    out << std::endl;
+}
+
+/**
+ * Prints the given amount of the heaviest allocation sites.
+ *
+ * @param count the maximum amount of allocation sites to be printed
+ * @param bytes whether to rank by the allocated bytes instead of the allocation counts
+ * @param out the output stream to print to
+ */
+static inline void __lsan_printTopSites(std::size_t count, bool bytes, std::ostream& out) {
+    using formatter::Style;
+
+    const auto& sites = getStats().getTopSites(bytes);
+    if (sites.empty()) return;
+
+    out << formatter::format<Style::UNDERLINED>(bytes ? "Allocation sites by allocated bytes (estimated):"
+                                                      : "Allocation sites by allocations (estimated):") << std::endl;
+    for (std::size_t i = 0; i < sites.size() && i < count; ++i) {
+        const auto& site = sites[i];
+        out << "#" << i + 1 << ": ";
+        if (bytes) {
+            out << formatter::format<Style::BOLD>(bytesToString(site.bytes)) << " in " << site.count << " allocations";
+        } else {
+            out << formatter::format<Style::BOLD>(std::to_string(site.count) + " allocations") << " of " << bytesToString(site.bytes);
+        }
+        out << std::endl;
+        callstackHelper::format(lcs::callstack(site.callstack), out);
+        out << std::endl;
+    }
+}
+
+/**
+ * Prints the given amount of the heaviest heap flows between threads and their allocation sites.
+ *
+ * @param count the maximum amount of heap flows to be printed
+ * @param out the output stream to print to
+ */
+static inline void __lsan_printThreadFlows(std::size_t count, std::ostream& out) {
+    using formatter::Style;
+
+    const auto& flows = flow::collect();
+    if (flows.empty()) return;
+
+    out << formatter::format<Style::UNDERLINED>("Blocks deallocated by another thread:") << std::endl;
+    for (std::size_t i = 0; i < flows.size() && i < count; ++i) {
+        const auto& flow = flows[i];
+        out << "#" << i + 1 << ": " << flow.fromName << " (" << flow.from << ") -> "
+            << flow.toName << " (" << flow.to << "): "
+            << formatter::format<Style::BOLD>(bytesToString(flow.bytes)) << " in " << flow.count << " blocks" << std::endl;
+    }
+    out << std::endl;
+
+    const auto& flowSites = getInstance().getStats().getFlowSites();
+    std::vector<const Stats::FlowSite*> sites;
+    for (const auto& [_, site] : flowSites) {
+        sites.push_back(&site);
+    }
+    std::sort(sites.begin(), sites.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs->bytes > rhs->bytes;
+    });
+    out << formatter::format<Style::UNDERLINED>("Allocation sites by bytes deallocated by another thread:") << std::endl;
+    for (std::size_t i = 0; i < sites.size() && i < 3; ++i) {
+        const auto& site = *sites[i];
+        out << "#" << i + 1 << ": " << formatter::format<Style::BOLD>(bytesToString(site.bytes))
+            << " in " << site.count << " blocks" << std::endl;
+        callstackHelper::format(lcs::callstack(site.callstack), out);
+        out << std::endl;
+    }
+}
+
 void __lsan_printStatsWithWidth(std::size_t width) {
     using formatter::Style;
     
@@ -328,6 +492,9 @@ void __lsan_printStatsWithWidth(std::size_t width) {
         __lsan_printStatsCore("memory usage", width, out,
                               std::bind(__lsan_printBar, __lsan_getCurrentByteCount(), __lsan_getBytePeek(), std::placeholders::_1, bytesToString(__lsan_getBytePeek()), std::placeholders::_2),
                               std::bind(__lsan_printBar, __lsan_getCurrentMallocCount(), __lsan_getMallocPeek(), std::placeholders::_1, std::to_string(__lsan_getMallocPeek()) + " objects", std::placeholders::_2));
+        __lsan_printTopSites(3, false, out);
+        __lsan_printTopSites(3, true, out);
+        __lsan_printThreadFlows(10, out);
     } else {
         out << formatter::get<Style::RED>
             << formatter::format<Style::BOLD>("No memory statistics available at the moment!") << std::endl
@@ -338,5 +505,563 @@ void __lsan_printStatsWithWidth(std::size_t width) {
             << "true" << formatter::format<Style::RED, Style::ITALIC>("?")
             << std::endl << std::endl;
     }
+    if (governor::active) {
+        __lsan_printGovernorStats(out);
+    }
+    getTracker().ignoreMalloc = ignore;
+}
+
+auto __lsan_getSlackBytes() -> std::size_t { return getStats().getSlack().wasted(); }
+
+auto __lsan_threadAllocatedBytes()  -> std::size_t { return threadCounters::allocatedBytes; }
+auto __lsan_threadFreedBytes()      -> std::size_t { return threadCounters::freedBytes;     }
+auto __lsan_threadAllocationCount() -> std::size_t { return threadCounters::allocations;    }
+auto __lsan_threadFreeCount()       -> std::size_t { return threadCounters::deallocations;  }
+
+/**
+ * Stores the heaviest allocation sites into the given array.
+ *
+ * @param k the maximum amount of allocation sites to be stored
+ * @param sites the array to store the allocation sites in
+ * @param bytes whether to rank by the allocated bytes instead of the allocation counts
+ * @return the amount of stored allocation sites
+ */
+static inline auto __lsan_copyTopSites(std::size_t k, __lsan_site* sites, bool bytes) -> std::size_t {
+    bool ignore = getTracker().ignoreMalloc;
+    getTracker().ignoreMalloc = true;
+    std::size_t i = 0;
+    {
+        const auto& topSites = getStats().getTopSites(bytes);
+        for (; i < topSites.size() && i < k; ++i) {
+            sites[i] = { topSites[i].id, topSites[i].count, topSites[i].bytes };
+        }
+    }
+    getTracker().ignoreMalloc = ignore;
+    return i;
+}
+
+auto __lsan_getTopSites(std::size_t k, __lsan_site* sites) -> std::size_t {
+    return __lsan_copyTopSites(k, sites, false);
+}
+
+auto __lsan_getTopSitesByBytes(std::size_t k, __lsan_site* sites) -> std::size_t {
+    return __lsan_copyTopSites(k, sites, true);
+}
+
+auto __lsan_getThreadFlows(std::size_t k, __lsan_threadFlow* flows) -> std::size_t {
+    std::lock_guard lock(getInstance().mutex);
+    bool ignore = getTracker().ignoreMalloc;
+    getTracker().ignoreMalloc = true;
+    std::size_t i = 0;
+    {
+        const auto& collected = flow::collect();
+        for (; i < collected.size() && i < k; ++i) {
+            const auto& flow = collected[i];
+            flows[i].allocatingThread   = flow.from;
+            flows[i].deallocatingThread = flow.to;
+            std::snprintf(flows[i].allocatingName,   sizeof(flows[i].allocatingName),   "%s", flow.fromName.c_str());
+            std::snprintf(flows[i].deallocatingName, sizeof(flows[i].deallocatingName), "%s", flow.toName.c_str());
+            flows[i].count = flow.count;
+            flows[i].bytes = flow.bytes;
+        }
+    }
+    getTracker().ignoreMalloc = ignore;
+    return i;
+}
+
+auto __lsan_dumpHeapWithContents(const char* path, bool contents) -> bool {
+    std::lock_guard lock(getInstance().mutex);
+    bool ignore = getTracker().ignoreMalloc;
+    getTracker().ignoreMalloc = true;
+    const auto success = dump::write(getInstance(), path, contents);
+    getTracker().ignoreMalloc = ignore;
+    return success;
+}
+
+/**
+ * Returns the given part of the given total as percentage string.
+ *
+ * @param part the part
+ * @param total the total
+ * @return the percentage string
+ */
+static inline auto percentString(std::size_t part, std::size_t total) -> std::string {
+    char buffer[16] {};
+    std::snprintf(buffer, sizeof(buffer), "%.1f %%", total == 0 ? 0.0 : static_cast<double>(part) / total * 100);
+    return buffer;
+}
+
+/**
+ * Prints the range of the requested sizes of the given slack record.
+ *
+ * @param slack the slack record
+ * @param out the output stream to print to
+ */
+static inline void __lsan_printRequestRange(const Stats::Slack& slack, std::ostream& out) {
+    out << slack.count << (slack.count == 1 ? " allocation" : " allocations") << " of " << bytesToString(slack.minRequest);
+    if (slack.minRequest != slack.maxRequest) {
+        out << " to " << bytesToString(slack.maxRequest);
+    }
+}
+
+/**
+ * @brief Prints the suggested request sizes for the given allocation site.
+ *
+ * The largest request can grow up to its size class without using more memory.
+ * If the smallest request lies just above a smaller size class, shrinking it
+ * into that size class is suggested as well.
+ *
+ * @param site the slack record of the allocation site
+ * @param classes the known size classes
+ * @param out the output stream to print to
+ */
+static inline void __lsan_printSuggestion(const Stats::Slack&                           site,
+                                          const std::map<std::size_t, Stats::Slack>& classes,
+                                          std::ostream&                               out) {
+    using formatter::Style;
+
+    const auto& grow = classes.lower_bound(site.maxRequest);
+    if (grow == classes.end()) return;
+
+    out << formatter::format<Style::ITALIC>("Suggestion: ") << "request "
+        << formatter::format<Style::BOLD>(bytesToString(grow->first)) << " (no additional memory)";
+    const auto& below = classes.lower_bound(site.minRequest);
+    if (below != classes.begin()) {
+        const auto shrink = std::prev(below)->first;
+        if (site.minRequest - shrink <= site.minRequest / 4) {
+            out << " or " << formatter::format<Style::BOLD>(bytesToString(shrink))
+                << " (saves " << bytesToString(below->first - shrink) << " per allocation)";
+        }
+    }
+    out << std::endl;
+}
+
+void __lsan_printSlackStatsWithCount(std::size_t count) {
+    using formatter::Style;
+
+    std::lock_guard lock(getInstance().mutex);
+    bool ignore = getTracker().ignoreMalloc;
+    getTracker().ignoreMalloc = true;
+    auto & out = getOutputStream();
+    if (getBehaviour().trackSlack()) {
+        const auto& stats   = getStats();
+        const auto& total   = stats.getSlack();
+        const auto& classes = stats.getSlackClasses();
+        const auto& sites   = stats.getSlackSites();
+
+        out << formatter::format<Style::ITALIC>("Allocator slack so far:") << std::endl
+            << formatter::clearAll()
+            << bytesToString(total.requested) << " requested, " << bytesToString(total.usable) << " usable, "
+            << formatter::format<Style::BOLD>(bytesToString(total.wasted())) << " wasted ("
+            << percentString(total.wasted(), total.usable) << ") in " << total.count << " allocations."
+            << std::endl << std::endl;
+
+        std::vector<std::pair<std::size_t, const Stats::Slack*>> sortedClasses;
+        sortedClasses.reserve(classes.size());
+        for (const auto& [usable, slack] : classes) {
+            sortedClasses.emplace_back(usable, &slack);
+        }
+        std::sort(sortedClasses.begin(), sortedClasses.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second->wasted() > rhs.second->wasted();
+        });
+        out << formatter::format<Style::UNDERLINED>("Size classes by wasted bytes:") << std::endl;
+        for (std::size_t i = 0; i < sortedClasses.size() && i < count && sortedClasses[i].second->wasted() > 0; ++i) {
+            const auto& [usable, slack] = sortedClasses[i];
+            out << formatter::format<Style::BOLD>(bytesToString(usable)) << ": "
+                << bytesToString(slack->wasted()) << " wasted (" << percentString(slack->wasted(), slack->usable) << ") in ";
+            __lsan_printRequestRange(*slack, out);
+            out << std::endl;
+        }
+        out << std::endl;
+
+        std::vector<const Stats::SlackSite*> sortedSites;
+        sortedSites.reserve(sites.size());
+        for (const auto& [_, site] : sites) {
+            if (site.wasted() > 0) {
+                sortedSites.push_back(&site);
+            }
+        }
+        std::sort(sortedSites.begin(), sortedSites.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs->wasted() > rhs->wasted();
+        });
+        out << formatter::format<Style::UNDERLINED>("Allocation sites by wasted bytes:") << std::endl;
+        for (std::size_t i = 0; i < sortedSites.size() && i < count; ++i) {
+            const auto& site = *sortedSites[i];
+            out << "#" << i + 1 << ": " << formatter::format<Style::BOLD>(bytesToString(site.wasted())) << " wasted ("
+                << percentString(site.wasted(), site.usable) << ") in ";
+            __lsan_printRequestRange(site, out);
+            out << std::endl;
+            __lsan_printSuggestion(site, classes, out);
+            callstackHelper::format(lcs::callstack(site.callstack), out);
+            out << std::endl;
+        }
+        if (sortedSites.size() > count) {
+            out << formatter::format<Style::UNDERLINED, Style::ITALIC>("And " + std::to_string(sortedSites.size() - count) + " more...")
+                << std::endl << std::endl;
+        }
+    } else {
+        out << formatter::get<Style::RED>
+            << formatter::format<Style::BOLD>("No allocator slack statistics available at the moment!") << std::endl
+            << formatter::format<Style::ITALIC>("Hint: Did you set ")
+            << formatter::clear<Style::RED>
+            << "LSAN_TRACK_SLACK (" << formatter::format<Style::GREYED>("__lsan_trackSlack") << ")"
+            << formatter::format<Style::ITALIC, Style::RED>(" to ")
+            << "true" << formatter::format<Style::RED, Style::ITALIC>("?")
+            << std::endl << std::endl;
+    }
+    getTracker().ignoreMalloc = ignore;
+}
+
+/**
+ * This structure contains the live heap of an allocation site.
+ */
+struct NumaLiveSite {
+    /** The callstack of the first found allocation of this site. */
+    lcs::callstack callstack;
+    /** The live bytes of this site.                              */
+    std::size_t bytes = 0;
+    /** The live bytes of this site per node, unplaced ones first. */
+    std::vector<std::size_t> nodes;
+
+    inline NumaLiveSite(const lcs::callstack& callstack, std::size_t nodeCount):
+        callstack(callstack), nodes(nodeCount + 1) {}
+};
+
+/**
+ * Prints the name of the given node.
+ *
+ * @param node the node, `-1` for unplaced pages
+ * @param out the output stream to print to
+ */
+static inline void __lsan_printNodeName(int node, std::ostream& out) {
+    if (node < 0) {
+        out << "Not placed";
+    } else {
+        out << "Node " << node;
+    }
+}
+
+void __lsan_printNumaStatsWithCount(std::size_t count) {
+    using formatter::Style;
+
+    std::lock_guard lock(getInstance().mutex);
+    bool ignore = getTracker().ignoreMalloc;
+    getTracker().ignoreMalloc = true;
+    auto & out = getOutputStream();
+    if (getBehaviour().numaStats()) {
+        const auto nodeCount = static_cast<std::size_t>(numa::nodeCount());
+        const auto toIndex   = [nodeCount](int node) {
+            return node < 0 ? 0 : std::min(static_cast<std::size_t>(node), nodeCount - 1) + 1;
+        };
+
+        std::vector<std::size_t> nodes(nodeCount + 1),
+                                 matrix((nodeCount + 1) * (nodeCount + 1));
+        std::map<std::uint64_t, NumaLiveSite> sites;
+        {
+            std::lock_guard lock(getInstance().getInfoMutex());
+
+            std::vector<const MallocInfo*> records;
+            std::vector<const void*>       addresses;
+            for (const auto& [pointer, info] : getInstance().getFragmentationInfos()) {
+                if (info.deleted) continue;
+
+                records.push_back(&info);
+                addresses.push_back(pointer);
+            }
+            std::vector<int> placements(addresses.size());
+            numa::nodesOf(addresses.data(), placements.data(), addresses.size());
+            for (std::size_t i = 0; i < records.size(); ++i) {
+                const auto& info  = *records[i];
+                const auto  index = toIndex(placements[i]);
+
+                nodes[index] += info.size;
+                matrix[toIndex(info.numaNode) * (nodeCount + 1) + index] += info.size;
+                auto& site = sites.try_emplace(info.getStackId(),
+                                               info.createdCallstack, nodeCount).first->second;
+                site.bytes += info.size;
+                site.nodes[index] += info.size;
+            }
+        }
+        std::size_t total = 0;
+        for (const auto bytes : nodes) {
+            total += bytes;
+        }
+
+        out << formatter::format<Style::ITALIC>("NUMA attribution of the live heap:") << std::endl
+            << formatter::clearAll()
+            << formatter::format<Style::BOLD>(bytesToString(total)) << " live on " << nodeCount
+            << (nodeCount == 1 ? " node." : " nodes.") << std::endl << std::endl;
+
+        out << formatter::format<Style::UNDERLINED>("Live bytes by physical node:") << std::endl;
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            if (i == 0 && nodes[i] == 0) continue;
+
+            __lsan_printNodeName(static_cast<int>(i) - 1, out);
+            out << ": " << formatter::format<Style::BOLD>(bytesToString(nodes[i]))
+                << " (" << percentString(nodes[i], total) << ")" << std::endl;
+        }
+        out << std::endl;
+
+        if (nodeCount > 1) {
+            out << formatter::format<Style::UNDERLINED>("Live bytes by allocating node and physical node:") << std::endl;
+            for (std::size_t from = 0; from <= nodeCount; ++from) {
+                for (std::size_t to = 0; to <= nodeCount; ++to) {
+                    const auto bytes = matrix[from * (nodeCount + 1) + to];
+                    if (bytes == 0) continue;
+
+                    if (from == 0) {
+                        out << "Unknown";
+                    } else {
+                        __lsan_printNodeName(static_cast<int>(from) - 1, out);
+                    }
+                    out << " -> ";
+                    __lsan_printNodeName(static_cast<int>(to) - 1, out);
+                    out << ": " << bytesToString(bytes) << " (" << percentString(bytes, total) << ")" << std::endl;
+                }
+            }
+            out << std::endl;
+        }
+
+        std::vector<const NumaLiveSite*> sortedSites;
+        sortedSites.reserve(sites.size());
+        for (const auto& [_, site] : sites) {
+            sortedSites.push_back(&site);
+        }
+        std::sort(sortedSites.begin(), sortedSites.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs->bytes > rhs->bytes;
+        });
+        out << formatter::format<Style::UNDERLINED>("Allocation sites by live bytes:") << std::endl;
+        for (std::size_t i = 0; i < sortedSites.size() && i < count; ++i) {
+            const auto& site = *sortedSites[i];
+            out << "#" << i + 1 << ": " << formatter::format<Style::BOLD>(bytesToString(site.bytes)) << " live";
+            for (std::size_t node = 0; node < site.nodes.size(); ++node) {
+                if (site.nodes[node] == 0) continue;
+
+                out << ", ";
+                __lsan_printNodeName(static_cast<int>(node) - 1, out);
+                out << ": " << percentString(site.nodes[node], site.bytes);
+            }
+            out << std::endl;
+            callstackHelper::format(lcs::callstack(site.callstack), out);
+            out << std::endl;
+        }
+        if (sortedSites.size() > count) {
+            out << formatter::format<Style::UNDERLINED, Style::ITALIC>("And " + std::to_string(sortedSites.size() - count) + " more...")
+                << std::endl << std::endl;
+        }
+
+        const auto& freeSites = getStats().getNumaSites();
+        std::vector<const Stats::NumaSite*> remoteSites;
+        for (const auto& [_, site] : freeSites) {
+            if (site.frees >= 8 && site.remoteFrees * 2 > site.frees) {
+                remoteSites.push_back(&site);
+            }
+        }
+        std::sort(remoteSites.begin(), remoteSites.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs->remoteBytes > rhs->remoteBytes;
+        });
+        if (!remoteSites.empty()) {
+            out << formatter::format<Style::UNDERLINED>("Allocation sites mostly freed from a remote node:") << std::endl;
+            for (std::size_t i = 0; i < remoteSites.size() && i < count; ++i) {
+                const auto& site = *remoteSites[i];
+                out << "#" << i + 1 << ": " << formatter::format<Style::BOLD>(percentString(site.remoteFrees, site.frees))
+                    << " of " << site.frees << " sampled deallocations remote ("
+                    << bytesToString(site.remoteBytes) << " of " << bytesToString(site.bytes) << ")" << std::endl;
+                callstackHelper::format(lcs::callstack(site.callstack), out);
+                out << std::endl;
+            }
+        }
+    } else {
+        out << formatter::get<Style::RED>
+            << formatter::format<Style::BOLD>("No NUMA statistics available at the moment!") << std::endl
+            << formatter::format<Style::ITALIC>("Hint: Did you set ")
+            << formatter::clear<Style::RED>
+            << "LSAN_NUMA_STATS (" << formatter::format<Style::GREYED>("__lsan_numaStats") << ")"
+            << formatter::format<Style::ITALIC, Style::RED>(" to ")
+            << "true" << formatter::format<Style::RED, Style::ITALIC>("?")
+            << std::endl << std::endl;
+    }
+    getTracker().ignoreMalloc = ignore;
+}
+
+void __lsan_printTypeStatsWithCount(std::size_t count) {
+    using formatter::Style;
+
+    std::lock_guard lock(getInstance().mutex);
+    bool ignore = getTracker().ignoreMalloc;
+    getTracker().ignoreMalloc = true;
+    auto & out = getOutputStream();
+    {
+        std::vector<std::pair<const void*, std::size_t>> blocks;
+        getInstance().forEachRecordOfAllTrackers([&blocks](const MallocInfo& info) {
+            if (info.deleted) return;
+
+            blocks.emplace_back(info.size < sizeof(void*) ? nullptr : *static_cast<const void* const*>(info.pointer), info.size);
+        });
+        const auto composition = types::aggregate(blocks);
+        const auto total       = std::accumulate(composition.types.begin(), composition.types.end(), composition.unknownBytes,
+                                                 [](const auto& sum, const auto& type) { return sum + type.bytes; });
+
+        out << formatter::format<Style::ITALIC>("Live heap by dynamic type:") << std::endl
+            << formatter::clearAll()
+            << formatter::format<Style::BOLD>(bytesToString(total - composition.unknownBytes)) << " of "
+            << formatter::format<Style::BOLD>(bytesToString(total)) << " in "
+            << (blocks.size() - composition.unknownCount) << " of " << blocks.size()
+            << " blocks attributed to " << composition.types.size()
+            << (composition.types.size() == 1 ? " type." : " types.") << std::endl << std::endl;
+        for (std::size_t i = 0; i < composition.types.size() && i < count; ++i) {
+            const auto& type = composition.types[i];
+            out << "#" << i + 1 << ": " << formatter::format<Style::BOLD>(type.name) << ": "
+                << bytesToString(type.bytes) << " (" << percentString(type.bytes, total) << ") in "
+                << type.count << (type.count == 1 ? " block" : " blocks") << std::endl;
+        }
+        if (composition.types.size() > count) {
+            out << formatter::format<Style::UNDERLINED, Style::ITALIC>("And " + std::to_string(composition.types.size() - count) + " more...")
+                << std::endl;
+        }
+        out << std::endl;
+    }
+    getTracker().ignoreMalloc = ignore;
+}
+
+/**
+ * This structure contains the bytes of an allocation site on copied pages.
+ */
+struct CowSite {
+    /** The callstack of the first found allocation of this site. */
+    lcs::callstack callstack;
+    /** The bytes of this site on copied pages.                   */
+    std::size_t bytes = 0;
+
+    inline explicit CowSite(const lcs::callstack& callstack): callstack(callstack) {}
+};
+
+void __lsan_printCowStatsWithCount(std::size_t count) {
+    using formatter::Style;
+
+    std::lock_guard lock(getInstance().mutex);
+    bool ignore = getTracker().ignoreMalloc;
+    getTracker().ignoreMalloc = true;
+    auto & out = getOutputStream();
+    if (cow::active()) {
+        const auto pageSize = cow::pageSize();
+        const auto breakage = cow::getBreakage();
+        const auto& pages   = breakage.brokenPages;
+
+        std::size_t attributed = 0;
+        std::map<std::uint64_t, CowSite> sites;
+        getInstance().forEachRecordOfAllTrackers([&](const MallocInfo& info) {
+            if (info.deleted) return;
+
+            const auto begin = reinterpret_cast<std::uintptr_t>(info.pointer),
+                       end   = begin + info.size;
+            std::size_t bytes = 0;
+            for (auto it = std::lower_bound(pages.begin(), pages.end(), begin / pageSize * pageSize);
+                 it != pages.end() && *it < end; ++it) {
+                bytes += std::min(end, *it + pageSize) - std::max(begin, *it);
+            }
+            if (bytes == 0) return;
+
+            attributed += bytes;
+            sites.try_emplace(info.getStackId(), info.createdCallstack).first->second.bytes += bytes;
+        });
+
+        out << formatter::format<Style::ITALIC>("Copy-on-write breakage of the process " + std::to_string(getpid()) + ":") << std::endl
+            << formatter::clearAll()
+            << formatter::format<Style::BOLD>(bytesToString(pages.size() * pageSize)) << " of "
+            << formatter::format<Style::BOLD>(bytesToString(breakage.sharedPages * pageSize))
+            << " shared with the parent duplicated since the fork (" << pages.size() << " of "
+            << breakage.sharedPages << " pages), " << bytesToString(attributed) << " of it by live blocks."
+            << std::endl << std::endl;
+
+        std::vector<const CowSite*> sortedSites;
+        sortedSites.reserve(sites.size());
+        for (const auto& [_, site] : sites) {
+            sortedSites.push_back(&site);
+        }
+        std::sort(sortedSites.begin(), sortedSites.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs->bytes > rhs->bytes;
+        });
+        if (!sortedSites.empty()) {
+            out << formatter::format<Style::UNDERLINED>("Allocation sites by duplicated bytes:") << std::endl;
+        }
+        for (std::size_t i = 0; i < sortedSites.size() && i < count; ++i) {
+            const auto& site = *sortedSites[i];
+            out << "#" << i + 1 << ": " << formatter::format<Style::BOLD>(bytesToString(site.bytes)) << " duplicated ("
+                << percentString(site.bytes, attributed) << ")" << std::endl;
+            callstackHelper::format(lcs::callstack(site.callstack), out);
+            out << std::endl;
+        }
+        if (sortedSites.size() > count) {
+            out << formatter::format<Style::UNDERLINED, Style::ITALIC>("And " + std::to_string(sortedSites.size() - count) + " more...")
+                << std::endl << std::endl;
+        }
+    } else {
+        out << formatter::get<Style::RED>
+            << formatter::format<Style::BOLD>("No copy-on-write statistics available in this process!") << std::endl
+            << formatter::format<Style::ITALIC>("Hint: Did you set ")
+            << formatter::clear<Style::RED>
+            << "LSAN_COW_SCAN" << formatter::format<Style::ITALIC, Style::RED>(" before the process was forked?")
+            << std::endl << std::endl;
+    }
+    getTracker().ignoreMalloc = ignore;
+}
+
+void __lsan_printFalseSharingWithCount(std::size_t count) {
+    using formatter::Style;
+
+    std::lock_guard lock(getInstance().mutex);
+    bool ignore = getTracker().ignoreMalloc;
+    getTracker().ignoreMalloc = true;
+    auto & out = getOutputStream();
+    {
+        std::vector<sharing::Block> blocks;
+        std::vector<lcs::callstack> callstacks;
+        std::map<std::uint64_t, std::size_t> sites;
+        // The records are passed between the trackers, the allocating thread is kept in them.
+        getInstance().forEachRecordOfAllTrackers([&](const MallocInfo& info) {
+            if (info.deleted) return;
+
+            const auto& [it, inserted] = sites.try_emplace(info.getStackId(), callstacks.size());
+            if (inserted) {
+                callstacks.push_back(info.createdCallstack);
+            }
+            const auto owner = static_cast<std::uint32_t>(info.thread) << 16 | info.threadGeneration;
+            blocks.push_back({ reinterpret_cast<std::uintptr_t>(info.pointer), info.size, owner, it->second });
+        });
+        const auto result = sharing::analyze(blocks);
+
+        out << formatter::format<Style::ITALIC>("Potential false sharing between threads:") << std::endl
+            << formatter::clearAll()
+            << formatter::format<Style::BOLD>(std::to_string(result.sharedLines)) << " of " << result.lines
+            << " cache lines of " << sharing::lineSize << " bytes hold blocks allocated by different threads."
+            << std::endl << std::endl;
+        if (!result.pairs.empty()) {
+            out << formatter::format<Style::UNDERLINED>("Allocation sites by shared cache lines:") << std::endl;
+        }
+        for (std::size_t i = 0; i < result.pairs.size() && i < count; ++i) {
+            const auto& pair = result.pairs[i];
+            out << "#" << i + 1 << ": " << formatter::format<Style::BOLD>(std::to_string(pair.lines))
+                << (pair.lines == 1 ? " cache line" : " cache lines");
+            if (pair.first == pair.second) {
+                out << " shared by the blocks of this site:" << std::endl;
+                callstackHelper::format(lcs::callstack(callstacks[pair.first]), out);
+            } else {
+                out << " shared by the blocks of" << std::endl;
+                callstackHelper::format(lcs::callstack(callstacks[pair.first]), out);
+                out << formatter::format<Style::ITALIC>("and of") << std::endl;
+                callstackHelper::format(lcs::callstack(callstacks[pair.second]), out);
+            }
+            out << std::endl;
+        }
+        if (result.pairs.size() > count) {
+            out << formatter::format<Style::UNDERLINED, Style::ITALIC>("And " + std::to_string(result.pairs.size() - count) + " more...")
+                << std::endl << std::endl;
+        }
+        if (!result.pairs.empty()) {
+            out << "Hint:" << formatter::format<Style::GREYED, Style::ITALIC>(" pad the blocks to the cache line size or allocate them per thread.")
+                << std::endl << std::endl;
+        }
+    }
     getTracker().ignoreMalloc = ignore;
 }
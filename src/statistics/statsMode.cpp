@@ -0,0 +1,176 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <pthread.h>
+
+#include "statsMode.hpp"
+
+#include "../behaviour/helper.hpp"
+
+namespace lsan::statsMode {
+std::atomic_int state = -1;
+// Starts one batch behind, so that the first counted event of a thread flushes and thereby registers the thread.
+thread_local std::size_t flushedEvents = -flushEvents;
+thread_local std::size_t flushedBytes  = 0;
+
+/** The amount of allocations of the calling thread when its counters were last added.   */
+static thread_local std::size_t flushedAllocations   __attribute__((tls_model("initial-exec"))) = 0;
+/** The amount of deallocations of the calling thread when its counters were last added. */
+static thread_local std::size_t flushedDeallocations __attribute__((tls_model("initial-exec"))) = 0;
+/** The allocated bytes of the calling thread when its counters were last added.         */
+static thread_local std::size_t flushedAllocated     __attribute__((tls_model("initial-exec"))) = 0;
+/** The freed bytes of the calling thread when its counters were last added.             */
+static thread_local std::size_t flushedFreed         __attribute__((tls_model("initial-exec"))) = 0;
+
+/** Whether the counters of the calling thread are flushed when it exits.              */
+static thread_local bool registered __attribute__((tls_model("initial-exec"))) = false;
+/** The key used to flush the counters of the exiting threads.                          */
+static pthread_key_t key;
+/** Ensures the key is only created once.                                               */
+static pthread_once_t keyOnce = PTHREAD_ONCE_INIT;
+
+/** The total amount of allocations.             */
+static std::atomic_size_t totalMallocs = 0;
+/** The total amount of deallocations.           */
+static std::atomic_size_t totalFrees   = 0;
+/** The total amount of allocated bytes.         */
+static std::atomic_size_t totalBytes   = 0;
+/** The peek of simultaneously allocated blocks. */
+static std::atomic_size_t mallocPeek   = 0;
+/** The peek of simultaneously allocated bytes.  */
+static std::atomic_size_t bytePeek     = 0;
+
+/*
+ * The current counts are transiently negative when a block is deallocated by
+ * another thread before its allocating thread has added its counters. They
+ * are exact once all threads have added their counters.
+ */
+/** The amount of currently allocated blocks.    */
+static std::atomic<std::ptrdiff_t> currentMallocs = 0;
+/** The amount of currently allocated bytes.     */
+static std::atomic<std::ptrdiff_t> currentBytes   = 0;
+
+auto load() noexcept -> bool {
+    const auto& mode = behaviour::getVariable("LSAN_MODE");
+    const auto value = mode && behaviour::lowerCompare(*mode, "stats");
+    state.store(value ? 1 : 0, std::memory_order_relaxed);
+    return value;
+}
+
+/**
+ * Raises the given peek to the given value if it is higher.
+ *
+ * @param peek the peek to be raised
+ * @param value the potentially new peek
+ */
+static inline void raise(std::atomic_size_t& peek, std::ptrdiff_t value) noexcept {
+    if (value <= 0) {
+        return;
+    }
+    auto expected = peek.load(std::memory_order_relaxed);
+    while (static_cast<std::size_t>(value) > expected
+           && !peek.compare_exchange_weak(expected, static_cast<std::size_t>(value), std::memory_order_relaxed));
+}
+
+/**
+ * Adds the remaining counters of an exiting thread to the global counters.
+ */
+static void flushExiting(void*) {
+    registered = false;
+    flush();
+    // Counted events of later thread-specific destructors flush and register again.
+    flushedEvents -= flushEvents;
+}
+
+/**
+ * Creates the key used to flush the counters of the exiting threads.
+ */
+static void createKey() {
+    pthread_key_create(&key, flushExiting);
+}
+
+void flush() noexcept {
+    const auto allocations   = threadCounters::allocations    - flushedAllocations,
+               deallocations = threadCounters::deallocations  - flushedDeallocations,
+               allocated     = threadCounters::allocatedBytes - flushedAllocated,
+               freed         = threadCounters::freedBytes     - flushedFreed;
+
+    flushedAllocations   = threadCounters::allocations;
+    flushedDeallocations = threadCounters::deallocations;
+    flushedAllocated     = threadCounters::allocatedBytes;
+    flushedFreed         = threadCounters::freedBytes;
+    flushedEvents        = flushedAllocations + flushedDeallocations;
+    flushedBytes         = flushedAllocated + flushedFreed;
+
+    totalMallocs.fetch_add(allocations,   std::memory_order_relaxed);
+    totalFrees  .fetch_add(deallocations, std::memory_order_relaxed);
+    totalBytes  .fetch_add(allocated,     std::memory_order_relaxed);
+
+    const auto blockDelta = static_cast<std::ptrdiff_t>(allocations - deallocations),
+               byteDelta  = static_cast<std::ptrdiff_t>(allocated   - freed);
+    raise(mallocPeek, currentMallocs.fetch_add(blockDelta, std::memory_order_relaxed) + blockDelta);
+    raise(bytePeek,   currentBytes  .fetch_add(byteDelta,  std::memory_order_relaxed) + byteDelta);
+
+    if (!registered) {
+        // Set first, the key might allocate.
+        registered = true;
+        pthread_once(&keyOnce, createKey);
+        pthread_setspecific(key, &registered);
+    }
+}
+
+auto getTotalMallocCount() noexcept -> std::size_t {
+    flush();
+    return totalMallocs.load(std::memory_order_relaxed);
+}
+
+auto getTotalBytes() noexcept -> std::size_t {
+    flush();
+    return totalBytes.load(std::memory_order_relaxed);
+}
+
+auto getTotalFreeCount() noexcept -> std::size_t {
+    flush();
+    return totalFrees.load(std::memory_order_relaxed);
+}
+
+auto getCurrentMallocCount() noexcept -> std::size_t {
+    flush();
+    return static_cast<std::size_t>(std::max<std::ptrdiff_t>(currentMallocs.load(std::memory_order_relaxed), 0));
+}
+
+auto getCurrentBytes() noexcept -> std::size_t {
+    flush();
+    return static_cast<std::size_t>(std::max<std::ptrdiff_t>(currentBytes.load(std::memory_order_relaxed), 0));
+}
+
+auto getMallocPeek() noexcept -> std::size_t {
+    flush();
+    return mallocPeek.load(std::memory_order_relaxed);
+}
+
+auto getBytePeek() noexcept -> std::size_t {
+    flush();
+    return bytePeek.load(std::memory_order_relaxed);
+}
+}
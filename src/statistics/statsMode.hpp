@@ -0,0 +1,175 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef statsMode_hpp
+#define statsMode_hpp
+
+#include <atomic>
+#include <cstddef>
+
+#include "threadCounters.hpp"
+
+#include "../allocations/realAlloc.hpp"
+
+/**
+ * @brief This namespace contains the stats-only mode selected by `LSAN_MODE=stats`.
+ *
+ * In this mode, the allocation wrappers neither record the allocations nor
+ * capture their callstacks: they only update the allocation counters of the
+ * calling thread. The counters of a thread are added to the global counters
+ * in batches and when the thread exits. Between these flushes, the global
+ * counters and the peeks are only approximate: they lag behind by at most
+ * `flushEvents` allocations or `flushBytes` bytes per running thread.
+ */
+namespace lsan::statsMode {
+/** The amount of counted events after which the counters of a thread are added to the global ones. */
+constexpr inline const std::size_t flushEvents = 64;
+/** The amount of counted bytes after which the counters of a thread are added to the global ones.  */
+constexpr inline const std::size_t flushBytes  = 64 * 1024;
+
+/** Whether the stats-only mode is active, `-1` while not yet determined.                */
+extern std::atomic_int state;
+/** The sum of the event counters of the calling thread when they were last added. */
+extern thread_local std::size_t flushedEvents __attribute__((tls_model("initial-exec")));
+/** The sum of the byte counters of the calling thread when they were last added.  */
+extern thread_local std::size_t flushedBytes  __attribute__((tls_model("initial-exec")));
+
+/**
+ * Determines whether the stats-only mode has been selected.
+ *
+ * @return whether the stats-only mode is active
+ */
+auto load() noexcept -> bool;
+
+/**
+ * Returns whether the stats-only mode is active.
+ *
+ * @return whether only the allocation counters are updated
+ */
+static inline auto active() noexcept -> bool {
+    const auto value = state.load(std::memory_order_relaxed);
+    return __builtin_expect(value < 0, false) ? load() : value != 0;
+}
+
+/**
+ * Adds the not yet added counters of the calling thread to the global counters.
+ * Registers the calling thread to add its remaining counters when it exits.
+ */
+void flush() noexcept;
+
+/**
+ * Adds the counters of the calling thread to the global counters if enough
+ * events have been counted since they were last added.
+ */
+static inline void maybeFlush() noexcept {
+    if (threadCounters::allocations + threadCounters::deallocations - flushedEvents >= flushEvents
+        || threadCounters::allocatedBytes + threadCounters::freedBytes - flushedBytes >= flushBytes) {
+        flush();
+    }
+}
+
+/**
+ * Counts the allocation of the given block if it is a counted one.
+ *
+ * @param pointer the allocated block, may be `nullptr`
+ * @return the given block
+ */
+static inline auto counted(void* pointer) noexcept -> void* {
+    if (pointer != nullptr && !real::isBootstrap(pointer)) {
+        threadCounters::addAllocation(real::malloc_usable_size(pointer));
+        maybeFlush();
+    }
+    return pointer;
+}
+
+/**
+ * Counts the deallocation of a block of the given usable size.
+ *
+ * @param size the usable size of the deallocated block
+ */
+static inline void deallocated(std::size_t size) noexcept {
+    threadCounters::addDeallocation(size);
+    maybeFlush();
+}
+
+/**
+ * Counts the deallocation of the given block if it is a counted one.
+ * Must be called before the block is deallocated.
+ *
+ * @param pointer the block to be deallocated, may be `nullptr`
+ */
+static inline void deallocated(void* pointer) noexcept {
+    if (pointer != nullptr && !real::isBootstrap(pointer)) {
+        deallocated(real::malloc_usable_size(pointer));
+    }
+}
+
+/**
+ * Returns the total amount of allocations.
+ *
+ * @return the total amount of allocations
+ */
+auto getTotalMallocCount() noexcept -> std::size_t;
+
+/**
+ * Returns the total amount of allocated bytes.
+ *
+ * @return the total amount of allocated bytes
+ */
+auto getTotalBytes() noexcept -> std::size_t;
+
+/**
+ * Returns the total amount of deallocations.
+ *
+ * @return the total amount of deallocations
+ */
+auto getTotalFreeCount() noexcept -> std::size_t;
+
+/**
+ * Returns the amount of currently allocated blocks.
+ *
+ * @return the amount of live blocks
+ */
+auto getCurrentMallocCount() noexcept -> std::size_t;
+
+/**
+ * Returns the amount of currently allocated bytes.
+ *
+ * @return the amount of live bytes
+ */
+auto getCurrentBytes() noexcept -> std::size_t;
+
+/**
+ * Returns the peek of simultaneously allocated blocks.
+ *
+ * @return the peek of live blocks
+ */
+auto getMallocPeek() noexcept -> std::size_t;
+
+/**
+ * Returns the peek of simultaneously allocated bytes.
+ *
+ * @return the peek of live bytes
+ */
+auto getBytePeek() noexcept -> std::size_t;
+}
+
+#endif /* statsMode_hpp */
@@ -0,0 +1,66 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef threadCounters_hpp
+#define threadCounters_hpp
+
+#include <cstddef>
+
+/**
+ * @brief This namespace contains the allocation counters of the threads.
+ *
+ * The counters are plain thread-local variables, updated for every allocation
+ * and deallocation that is not made internally by this sanitizer. Like the
+ * counters of jemalloc, the usable sizes of the blocks are counted. The usable
+ * size is determined once by the allocation functions and passed in.
+ */
+namespace lsan::threadCounters {
+/** The amount of allocations of the calling thread.    */
+extern thread_local std::size_t allocations    __attribute__((tls_model("initial-exec")));
+/** The amount of deallocations of the calling thread.  */
+extern thread_local std::size_t deallocations  __attribute__((tls_model("initial-exec")));
+/** The bytes allocated by the calling thread.          */
+extern thread_local std::size_t allocatedBytes __attribute__((tls_model("initial-exec")));
+/** The bytes deallocated by the calling thread.        */
+extern thread_local std::size_t freedBytes     __attribute__((tls_model("initial-exec")));
+
+/**
+ * Counts the allocation of a block of the given usable size.
+ *
+ * @param size the usable size of the allocated block
+ */
+static inline void addAllocation(std::size_t size) noexcept {
+    ++allocations;
+    allocatedBytes += size;
+}
+
+/**
+ * Counts the deallocation of a block of the given usable size.
+ *
+ * @param size the usable size of the deallocated block
+ */
+static inline void addDeallocation(std::size_t size) noexcept {
+    ++deallocations;
+    freedBytes += size;
+}
+}
+
+#endif /* threadCounters_hpp */
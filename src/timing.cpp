@@ -28,6 +28,10 @@
 
 #include "formatter.hpp"
 
+#ifdef __linux__
+ #include "allocations/backend.hpp"
+#endif
+
 namespace lsan::timing {
 auto getTimingMap() -> std::map<AllocType, Timings>& {
     return getInstance().getTimingMap();
@@ -147,6 +151,14 @@ auto printTimings(std::ostream& out) -> std::ostream& {
 
     std::lock_guard lock { getInstance().mutex };
 
+#ifdef __linux__
+    const auto& backend = backend::get();
+    out << formatter::format<Style::BOLD>("Allocator backend: ") << backend.name;
+    if (backend.library != nullptr) {
+        out << " (" << backend.library << ")";
+    }
+    out << std::endl << std::endl;
+#endif
     out << formatter::format<Style::BOLD>("Malloc timings")  << std::endl << getTimingMap()[AllocType::malloc]  << std::endl
         << formatter::format<Style::BOLD>("Calloc timings")  << std::endl << getTimingMap()[AllocType::calloc]  << std::endl
         << formatter::format<Style::BOLD>("Realloc timings") << std::endl << getTimingMap()[AllocType::realloc] << std::endl
@@ -0,0 +1,275 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include <dlfcn.h>
+
+#ifdef __linux__
+ #include <fcntl.h>
+ #include <link.h>
+ #include <unistd.h>
+
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+#endif
+
+#include "types.hpp"
+
+#include "../utils.hpp"
+
+namespace lsan::types {
+/**
+ * This structure represents a virtual table.
+ */
+struct Vtable {
+    /** The begin of the virtual table.                    */
+    std::uintptr_t begin;
+    /** The size of the virtual table in bytes.            */
+    std::size_t size;
+    /** The mangled name of the type.                      */
+    std::string name;
+    /** The index of the type in the aggregation or `-1`. */
+    std::size_t index = SIZE_MAX;
+};
+
+#ifdef __linux__
+/**
+ * This structure represents a loaded module.
+ */
+struct Module {
+    /** The lowest loaded address of the module.              */
+    std::uintptr_t begin;
+    /** The end of the highest loaded segment of the module.  */
+    std::uintptr_t end;
+    /** The load bias of the module.                           */
+    std::uintptr_t base;
+    /** The file name of the module.                           */
+    std::string path;
+    /** Whether the virtual tables have been loaded.           */
+    bool loaded = false;
+    /** The virtual tables of the module, sorted by address.   */
+    std::vector<Vtable> vtables;
+};
+
+/**
+ * Loads the virtual tables of the given module from its symbol table.
+ *
+ * The dynamic symbol table is used if the module has been stripped.
+ *
+ * @param module the module whose virtual tables to load
+ */
+static inline void loadVtables(Module& module) {
+    module.loaded = true;
+
+    const auto fd = open(module.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(ElfW(Ehdr))) {
+        close(fd);
+        return;
+    }
+    const auto size = static_cast<std::size_t>(info.st_size);
+    const auto file = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED) return;
+
+    const auto begin  = static_cast<const char*>(file);
+    const auto header = reinterpret_cast<const ElfW(Ehdr)*>(begin);
+    if (std::memcmp(header->e_ident, ELFMAG, SELFMAG) == 0
+        && header->e_shentsize == sizeof(ElfW(Shdr))
+        && header->e_shoff + header->e_shnum * sizeof(ElfW(Shdr)) <= size) {
+        const auto sections = reinterpret_cast<const ElfW(Shdr)*>(begin + header->e_shoff);
+
+        const ElfW(Shdr)* table = nullptr;
+        for (std::size_t i = 0; i < header->e_shnum; ++i) {
+            if (sections[i].sh_type == SHT_SYMTAB) {
+                table = &sections[i];
+                break;
+            } else if (sections[i].sh_type == SHT_DYNSYM) {
+                table = &sections[i];
+            }
+        }
+        if (table != nullptr && table->sh_link < header->e_shnum
+            && table->sh_offset + table->sh_size <= size
+            && sections[table->sh_link].sh_offset + sections[table->sh_link].sh_size <= size) {
+            const auto& strings = sections[table->sh_link];
+            const auto  symbols = reinterpret_cast<const ElfW(Sym)*>(begin + table->sh_offset);
+            const auto  names   = begin + strings.sh_offset;
+            for (std::size_t i = 0; i < table->sh_size / sizeof(ElfW(Sym)); ++i) {
+                const auto& symbol = symbols[i];
+                if (ELF64_ST_TYPE(symbol.st_info) != STT_OBJECT || symbol.st_size == 0
+                    || symbol.st_value == 0 || symbol.st_name >= strings.sh_size) continue;
+
+                const auto name = names + symbol.st_name;
+                if (std::strncmp(name, "_ZTV", 4) != 0
+                    || std::memchr(name, '\0', strings.sh_size - symbol.st_name) == nullptr) continue;
+
+                module.vtables.push_back({ module.base + symbol.st_value, symbol.st_size, name + 4 });
+            }
+        }
+    }
+    munmap(file, size);
+
+    std::sort(module.vtables.begin(), module.vtables.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.begin < rhs.begin;
+    });
+}
+
+/**
+ * This class resolves the virtual tables pointed to by the first words of blocks.
+ */
+class Resolver {
+    /** The loaded modules, sorted by address.                       */
+    std::vector<Module> modules;
+    /** The already resolved words within the loaded modules.        */
+    std::unordered_map<std::uintptr_t, Vtable*> cache;
+
+    /**
+     * Adds the given loaded module.
+     *
+     * @param info the information about the module
+     * @param data the resolver
+     * @return `0` to continue the iteration
+     */
+    static auto addModule(dl_phdr_info* info, std::size_t, void* data) -> int {
+        auto& self = *static_cast<Resolver*>(data);
+
+        std::uintptr_t begin = UINTPTR_MAX,
+                       end   = 0;
+        for (std::size_t i = 0; i < info->dlpi_phnum; ++i) {
+            const auto& segment = info->dlpi_phdr[i];
+            if (segment.p_type != PT_LOAD) continue;
+
+            begin = std::min(begin, static_cast<std::uintptr_t>(info->dlpi_addr + segment.p_vaddr));
+            end   = std::max(end,   static_cast<std::uintptr_t>(info->dlpi_addr + segment.p_vaddr + segment.p_memsz));
+        }
+        if (begin < end) {
+            const auto name = info->dlpi_name;
+            self.modules.push_back({ begin, end, info->dlpi_addr, name == nullptr || *name == '\0' ? "/proc/self/exe" : name, false, {} });
+        }
+        return 0;
+    }
+
+public:
+    inline Resolver() {
+        dl_iterate_phdr(addModule, this);
+        std::sort(modules.begin(), modules.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.begin < rhs.begin;
+        });
+    }
+
+    /**
+     * Returns the virtual table the given word points into.
+     *
+     * @param word the word to be looked up
+     * @return the virtual table or `nullptr` if the word does not point into one
+     */
+    auto find(const void* word) -> Vtable* {
+        const auto address = reinterpret_cast<std::uintptr_t>(word);
+        auto module = std::upper_bound(modules.begin(), modules.end(), address, [](const auto& address, const auto& module) {
+            return address < module.begin;
+        });
+        if (module == modules.begin() || address >= (--module)->end) {
+            return nullptr;
+        }
+
+        const auto& [it, inserted] = cache.try_emplace(address, nullptr);
+        if (inserted) {
+            if (!module->loaded) {
+                loadVtables(*module);
+            }
+            auto vtable = std::upper_bound(module->vtables.begin(), module->vtables.end(), address, [](const auto& address, const auto& vtable) {
+                return address < vtable.begin;
+            });
+            if (vtable != module->vtables.begin() && address < (vtable - 1)->begin + (vtable - 1)->size) {
+                it->second = &*(vtable - 1);
+            }
+        }
+        return it->second;
+    }
+};
+#else
+/**
+ * This class resolves the virtual tables pointed to by the first words of blocks.
+ */
+class Resolver {
+    /** The already resolved words.                                  */
+    std::unordered_map<std::uintptr_t, Vtable*> cache;
+    /** The found virtual tables by their address.                   */
+    std::unordered_map<std::uintptr_t, Vtable> vtables;
+
+public:
+    /**
+     * Returns the virtual table the given word points into.
+     *
+     * @param word the word to be looked up
+     * @return the virtual table or `nullptr` if the word does not point into one
+     */
+    auto find(const void* word) -> Vtable* {
+        const auto& [it, inserted] = cache.try_emplace(reinterpret_cast<std::uintptr_t>(word), nullptr);
+        if (inserted) {
+            Dl_info info;
+            if (dladdr(word, &info) != 0 && info.dli_sname != nullptr && std::strncmp(info.dli_sname, "_ZTV", 4) == 0) {
+                const auto begin = reinterpret_cast<std::uintptr_t>(info.dli_saddr);
+                it->second = &vtables.try_emplace(begin, Vtable { begin, 0, info.dli_sname + 4 }).first->second;
+            }
+        }
+        return it->second;
+    }
+};
+#endif
+
+auto aggregate(const std::vector<std::pair<const void*, std::size_t>>& blocks) -> Composition {
+    Resolver resolver;
+    Composition toReturn;
+    // The same type can have a virtual table in multiple modules.
+    std::unordered_map<std::string, std::size_t> indices;
+    for (const auto& [word, size] : blocks) {
+        const auto vtable = resolver.find(word);
+        if (vtable == nullptr) {
+            ++toReturn.unknownCount;
+            toReturn.unknownBytes += size;
+            continue;
+        }
+        if (vtable->index == SIZE_MAX) {
+            auto name = utils::demangle(vtable->name.c_str());
+            const auto& [it, inserted] = indices.try_emplace(name, toReturn.types.size());
+            if (inserted) {
+                toReturn.types.push_back({ std::move(name) });
+            }
+            vtable->index = it->second;
+        }
+        auto& type = toReturn.types[vtable->index];
+        ++type.count;
+        type.bytes += size;
+    }
+    std::sort(toReturn.types.begin(), toReturn.types.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.bytes > rhs.bytes;
+    });
+    return toReturn;
+}
+}
@@ -0,0 +1,75 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef types_hpp
+#define types_hpp
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief This namespace contains the attribution of memory blocks to their C++ dynamic type.
+ *
+ * The first word of a polymorphic object points into the virtual table of its
+ * dynamic type. The virtual tables are found using the symbol tables of the
+ * loaded modules.
+ */
+namespace lsan::types {
+/**
+ * This structure contains the blocks attributed to a dynamic type.
+ */
+struct Type {
+    /** The demangled name of the type.  */
+    std::string name;
+    /** The amount of blocks of the type. */
+    std::size_t count = 0;
+    /** The bytes of the blocks.          */
+    std::size_t bytes = 0;
+};
+
+/**
+ * This structure contains the composition of a set of blocks by their dynamic type.
+ */
+struct Composition {
+    /** The found types, sorted by their bytes.       */
+    std::vector<Type> types;
+    /** The amount of blocks without a known type.    */
+    std::size_t unknownCount = 0;
+    /** The bytes of the blocks without a known type. */
+    std::size_t unknownBytes = 0;
+};
+
+/**
+ * @brief Aggregates the given blocks by their dynamic type.
+ *
+ * The blocks are given by their first word and their size. The first words are
+ * looked up only once each.
+ *
+ * @param blocks the first words and the sizes of the blocks
+ * @return the composition of the blocks
+ */
+auto aggregate(const std::vector<std::pair<const void*, std::size_t>>& blocks) -> Composition;
+}
+
+#endif /* types_hpp */
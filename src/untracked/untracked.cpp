@@ -0,0 +1,112 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+#include "untracked.hpp"
+
+namespace lsan::untracked {
+std::atomic_size_t totalCount = 0;
+std::atomic_size_t totalBytes = 0;
+std::atomic_size_t liveCount  = 0;
+std::atomic_size_t liveBytes  = 0;
+std::atomic_size_t remembered = 0;
+
+/**
+ * This structure contains a part of the remembered untracked blocks.
+ */
+struct Shard {
+    /** The mutex protecting the blocks.     */
+    std::mutex mutex;
+    /** The remembered blocks of this shard. */
+    std::unordered_map<const void*, Block> blocks;
+};
+
+/** The amount of shards of the remembered blocks. */
+static constexpr std::size_t shardCount = 64;
+
+/**
+ * Returns the shard responsible for the given block.
+ *
+ * The shards are allocated upon the first use and never freed, since blocks
+ * are still deallocated after the static objects have been destroyed.
+ *
+ * @param pointer the block
+ * @return the according shard
+ */
+static inline auto shardOf(const void* pointer) -> Shard& {
+    static const auto shards = new Shard[shardCount];
+
+    return shards[std::hash<const void*>()(pointer) % shardCount];
+}
+
+void add(const void* pointer, std::size_t size, bool excluded) {
+    if (!excluded) {
+        totalCount.fetch_add(1,    std::memory_order_relaxed);
+        totalBytes.fetch_add(size, std::memory_order_relaxed);
+        liveCount .fetch_add(1,    std::memory_order_relaxed);
+        liveBytes .fetch_add(size, std::memory_order_relaxed);
+    }
+
+    auto& shard = shardOf(pointer);
+    std::lock_guard lock(shard.mutex);
+    if (shard.blocks.insert_or_assign(pointer, Block { size, excluded, false }).second) {
+        remembered.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+auto remove(const void* pointer, bool keepDeallocated, Block& block) -> Result {
+    if (remembered.load(std::memory_order_relaxed) == 0) {
+        return Result::UNKNOWN;
+    }
+    auto& shard = shardOf(pointer);
+    std::lock_guard lock(shard.mutex);
+    const auto& it = shard.blocks.find(pointer);
+    if (it == shard.blocks.end()) {
+        return Result::UNKNOWN;
+    }
+    if (it->second.deallocated) {
+        return Result::DEALLOCATED;
+    }
+    block = it->second;
+    if (keepDeallocated) {
+        it->second.deallocated = true;
+    } else {
+        shard.blocks.erase(it);
+        remembered.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (!block.excluded) {
+        liveCount.fetch_sub(1,          std::memory_order_relaxed);
+        liveBytes.fetch_sub(block.size, std::memory_order_relaxed);
+    }
+    return Result::REMOVED;
+}
+
+void forgetSlow(const void* pointer) {
+    auto& shard = shardOf(pointer);
+    std::lock_guard lock(shard.mutex);
+    if (shard.blocks.erase(pointer) != 0) {
+        remembered.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+}
@@ -0,0 +1,118 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef untracked_hpp
+#define untracked_hpp
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief This namespace contains the bookkeeping of the untracked allocations.
+ *
+ * The allocations smaller than `LSAN_MIN_TRACKED_SIZE` are only counted and the
+ * ones of the modules excluded by `LSAN_TRACK_MODULES` are not counted at all,
+ * neither their callstacks nor records are created. Their addresses and
+ * requested sizes are remembered in a sharded map, so their deallocations are
+ * told apart from invalid ones. Deallocated blocks stay remembered as such if
+ * invalid deallocations are detected, which allows to detect their double
+ * deallocation.
+ */
+namespace lsan::untracked {
+/** The total amount of counted untracked allocations.           */
+extern std::atomic_size_t totalCount;
+/** The total requested size of the counted untracked allocations. */
+extern std::atomic_size_t totalBytes;
+/** The amount of currently allocated counted untracked blocks.  */
+extern std::atomic_size_t liveCount;
+/** The requested size of the currently allocated counted untracked blocks. */
+extern std::atomic_size_t liveBytes;
+/** The amount of blocks remembered in the map.                  */
+extern std::atomic_size_t remembered;
+
+/**
+ * This structure represents a remembered untracked block.
+ */
+struct Block {
+    /** The requested size of the block.                    */
+    std::size_t size;
+    /** Whether the block is of an excluded module.          */
+    bool excluded;
+    /** Whether the block has been deallocated.              */
+    bool deallocated;
+};
+
+/**
+ * This enumeration contains the possible results of removing a block.
+ */
+enum class Result {
+    /** The block is not an untracked one.                   */
+    UNKNOWN,
+    /** The untracked block has been removed.                */
+    REMOVED,
+    /** The untracked block has already been deallocated.    */
+    DEALLOCATED
+};
+
+/**
+ * Remembers the given untracked block, counting it unless it is of an excluded module.
+ *
+ * @param pointer the allocated block
+ * @param size the requested size
+ * @param excluded whether the block is of a module excluded by `LSAN_TRACK_MODULES`
+ */
+void add(const void* pointer, std::size_t size, bool excluded = false);
+
+/**
+ * @brief Removes the given block if it is an untracked one.
+ *
+ * Must be called before the block is deallocated.
+ *
+ * @param pointer the block to be deallocated
+ * @param keepDeallocated whether to remember the block as deallocated
+ * @param block set to the removed block
+ * @return whether the given block was an untracked one
+ */
+auto remove(const void* pointer, bool keepDeallocated, Block& block) -> Result;
+
+/**
+ * Forgets the given block, since it has been tracked.
+ *
+ * @param pointer the newly tracked block
+ */
+void forgetSlow(const void* pointer);
+
+/**
+ * @brief Forgets the given block, since it has been tracked.
+ *
+ * Untracked blocks at the same address may still be remembered, because they
+ * have been deallocated as such or while the tracking was suspended.
+ *
+ * @param pointer the newly tracked block
+ */
+static inline void forget(const void* pointer) {
+    if (remembered.load(std::memory_order_relaxed) != 0) {
+        forgetSlow(pointer);
+    }
+}
+}
+
+#endif /* untracked_hpp */
@@ -22,7 +22,11 @@
 #ifndef utils_hpp
 #define utils_hpp
 
+#include <cstdlib>
 #include <sstream>
+#include <string>
+
+#include <cxxabi.h>
 
 namespace lsan::utils {
 /**
@@ -36,6 +40,23 @@ static inline auto toString(const void* pointer) -> std::string {
     stream << pointer;
     return stream.str();
 }
+
+/**
+ * Demangles the given C string.
+ *
+ * @param string the string to be demangled
+ * @return the possibly demangled string
+ */
+static inline auto demangle(const char * string) noexcept -> std::string {
+    int status;
+    const char * result = abi::__cxa_demangle(string, nullptr, nullptr, &status);
+    if (result == nullptr || result == string) {
+        return string;
+    }
+    std::string toReturn = result;
+    std::free(const_cast<char *>(result));
+    return toReturn;
+}
 }
 
 #endif /* utils_hpp */
@@ -0,0 +1,501 @@
+/*
+ * LeakSanitizer - Small library showing information about lost memory.
+ *
+ * Copyright (C) 2024  mhahnFr
+ *
+ * This file is part of the LeakSanitizer.
+ *
+ * The LeakSanitizer is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The LeakSanitizer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with the
+ * LeakSanitizer, see the file LICENSE.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Offline analyzer for the heap dumps written by `__lsan_dumpHeap`.
+ *
+ * Usage: lsan-heap top <dump> [count]
+ *        lsan-heap diff <old dump> <new dump> [count]
+ *        lsan-heap dominators <dump> [count]
+ *
+ * Build: make tools
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <lsan_dump.h>
+
+/**
+ * This class represents a heap dump mapped into memory.
+ */
+class Dump {
+    /** The beginning of the mapped file. */
+    const char* data = nullptr;
+    /** The size of the mapped file.      */
+    std::size_t size = 0;
+
+    /**
+     * Returns the records of the given section, checking its bounds.
+     *
+     * @param offset the offset of the section
+     * @param count the amount of records
+     * @return the first record of the section
+     */
+    template<typename T>
+    auto section(std::uint64_t offset, std::uint64_t count) const -> const T* {
+        if (offset % alignof(T) != 0 || offset > size || count > (size - offset) / sizeof(T)) {
+            throw std::runtime_error("Corrupt section in heap dump");
+        }
+        return reinterpret_cast<const T*>(data + offset);
+    }
+
+public:
+    /** The header of the dump. */
+    const __lsan_dumpHeader* header;
+
+    explicit Dump(const std::string& path) {
+        const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open " + path);
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(__lsan_dumpHeader)) {
+            close(fd);
+            throw std::runtime_error(path + " is not a heap dump");
+        }
+        size = static_cast<std::size_t>(info.st_size);
+        const auto mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Could not map " + path);
+        }
+        data   = static_cast<const char*>(mapped);
+        header = reinterpret_cast<const __lsan_dumpHeader*>(data);
+        if (std::memcmp(header->magic, LSAN_DUMP_MAGIC, sizeof(header->magic)) != 0 || header->version != LSAN_DUMP_VERSION) {
+            munmap(mapped, size);
+            throw std::runtime_error(path + " is not a supported heap dump");
+        }
+        // Check the bounds of all sections once.
+        blocks();
+        stacks();
+        frames();
+        modules();
+        section<char>(header->stringsOffset, header->stringsSize);
+    }
+
+   ~Dump() {
+        munmap(const_cast<char*>(data), size);
+    }
+
+    Dump(const Dump&) = delete;
+    Dump(Dump&&)      = delete;
+
+    auto operator=(const Dump&) -> Dump& = delete;
+    auto operator=(Dump&&)      -> Dump& = delete;
+
+    inline auto blocks()  const -> const __lsan_dumpBlock*  { return section<__lsan_dumpBlock>(header->blockOffset, header->blockCount);    }
+    inline auto stacks()  const -> const __lsan_dumpStack*  { return section<__lsan_dumpStack>(header->stackOffset, header->stackCount);    }
+    inline auto frames()  const -> const __lsan_dumpFrame*  { return section<__lsan_dumpFrame>(header->frameOffset, header->frameCount);    }
+    inline auto modules() const -> const __lsan_dumpModule* { return section<__lsan_dumpModule>(header->moduleOffset, header->moduleCount); }
+
+    /**
+     * Returns the string at the given offset of the string table.
+     *
+     * @param offset the offset in the string table
+     * @return the string
+     */
+    inline auto string(std::uint64_t offset) const -> const char* {
+        return offset < header->stringsSize ? data + header->stringsOffset + offset : "<< Corrupt >>";
+    }
+
+    /**
+     * Returns the contents of the given block.
+     *
+     * @param block the block
+     * @return the contents or `nullptr` if not included
+     */
+    inline auto contents(const __lsan_dumpBlock& block) const -> const char* {
+        if (block.contents == UINT64_MAX || block.contents > size || block.size > size - block.contents) {
+            return nullptr;
+        }
+        return data + block.contents;
+    }
+
+    /**
+     * Returns the age of the given block in seconds at the time of the dump.
+     *
+     * @param block the block
+     * @return the age in seconds
+     */
+    inline auto age(const __lsan_dumpBlock& block) const -> double {
+        if (header->ticksPerSecond == 0 || block.timestamp > header->timestamp) {
+            return 0;
+        }
+        return static_cast<double>(header->timestamp - block.timestamp) / static_cast<double>(header->ticksPerSecond);
+    }
+
+    /**
+     * Prints the frames of the callstack with the given index.
+     *
+     * @param stack the index of the callstack
+     * @param out the output stream
+     */
+    void printStack(std::uint32_t stack, std::ostream& out) const {
+        if (stack >= header->stackCount) return;
+
+        const auto& record = stacks()[stack];
+        for (std::uint32_t i = 0; i < record.frameCount && record.firstFrame + i < header->frameCount; ++i) {
+            const auto& frame = frames()[record.firstFrame + i];
+            out << (i == 0 ? "    At: " : "    at: ") << string(frame.name) << std::endl;
+        }
+    }
+};
+
+/**
+ * This structure contains the live blocks of an allocation site.
+ */
+struct Site {
+    /** The index of the callstack in its dump. */
+    std::uint32_t stack;
+    /** The amount of live blocks.              */
+    std::int64_t count = 0;
+    /** The live bytes.                         */
+    std::int64_t bytes = 0;
+    /** The age of the oldest block in seconds. */
+    double oldest = 0;
+};
+
+/**
+ * Aggregates the blocks of the given dump by their allocation site.
+ *
+ * @param dump the heap dump
+ * @return the allocation sites mapped to their stack identifiers
+ */
+static auto aggregate(const Dump& dump) -> std::unordered_map<std::uint64_t, Site> {
+    std::unordered_map<std::uint64_t, Site> sites;
+    const auto blocks = dump.blocks();
+    for (std::uint64_t i = 0; i < dump.header->blockCount; ++i) {
+        const auto& block = blocks[i];
+        const auto id = block.stack < dump.header->stackCount ? dump.stacks()[block.stack].id : 0;
+        auto& site = sites.try_emplace(id, Site { block.stack }).first->second;
+        ++site.count;
+        site.bytes += static_cast<std::int64_t>(block.size);
+        site.oldest = std::max(site.oldest, dump.age(block));
+    }
+    return sites;
+}
+
+/**
+ * Prints the allocation sites with the most live bytes.
+ *
+ * @param path the path of the dump
+ * @param count the amount of sites to be printed
+ */
+static void top(const std::string& path, std::size_t count) {
+    const Dump dump(path);
+    const auto& sites = aggregate(dump);
+    std::vector<const Site*> sorted;
+    std::int64_t total = 0;
+    for (const auto& [_, site] : sites) {
+        sorted.push_back(&site);
+        total += site.bytes;
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs->bytes > rhs->bytes;
+    });
+    std::cout << dump.header->blockCount << " live blocks of " << total << " bytes in " << sites.size()
+              << " allocation sites." << std::endl << std::endl;
+    for (std::size_t i = 0; i < sorted.size() && i < count; ++i) {
+        const auto& site = *sorted[i];
+        std::cout << "#" << i + 1 << ": " << site.bytes << " bytes in " << site.count << " blocks, oldest "
+                  << site.oldest << " s" << std::endl;
+        dump.printStack(site.stack, std::cout);
+        std::cout << std::endl;
+    }
+}
+
+/**
+ * Prints the allocation sites whose live bytes changed the most between the given dumps.
+ *
+ * The dumps are loaded and aggregated in parallel.
+ *
+ * @param oldPath the path of the older dump
+ * @param newPath the path of the newer dump
+ * @param count the amount of sites to be printed
+ */
+static void diff(const std::string& oldPath, const std::string& newPath, std::size_t count) {
+    const Dump oldDump(oldPath), newDump(newPath);
+    std::unordered_map<std::uint64_t, Site> oldSites;
+    std::thread loader([&] { oldSites = aggregate(oldDump); });
+    const auto& newSites = aggregate(newDump);
+    loader.join();
+
+    struct Change {
+        const Site* site;
+        const Dump* dump;
+        std::int64_t bytes, count;
+    };
+    std::vector<Change> changes;
+    for (const auto& [id, site] : newSites) {
+        const auto& it = oldSites.find(id);
+        const auto bytes = site.bytes - (it == oldSites.end() ? 0 : it->second.bytes);
+        const auto blocks = site.count - (it == oldSites.end() ? 0 : it->second.count);
+        if (bytes != 0 || blocks != 0) {
+            changes.push_back({ &site, &newDump, bytes, blocks });
+        }
+    }
+    for (const auto& [id, site] : oldSites) {
+        if (newSites.find(id) == newSites.end()) {
+            changes.push_back({ &site, &oldDump, -site.bytes, -site.count });
+        }
+    }
+    std::sort(changes.begin(), changes.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.bytes > rhs.bytes;
+    });
+    std::cout << changes.size() << " allocation sites changed." << std::endl << std::endl;
+    for (std::size_t i = 0; i < changes.size() && i < count; ++i) {
+        const auto& change = changes[i];
+        std::cout << "#" << i + 1 << ": " << (change.bytes > 0 ? "+" : "") << change.bytes << " bytes, "
+                  << (change.count > 0 ? "+" : "") << change.count << " blocks" << std::endl;
+        change.dump->printStack(change.site->stack, std::cout);
+        std::cout << std::endl;
+    }
+}
+
+/**
+ * Finds the pointers between the blocks of the given dump.
+ *
+ * The contents of the blocks are scanned in parallel for aligned words pointing
+ * into another block.
+ *
+ * @param dump the heap dump
+ * @return the indices of the referenced blocks per block
+ */
+static auto findEdges(const Dump& dump) -> std::vector<std::vector<std::uint32_t>> {
+    const auto blocks = dump.blocks();
+    const auto count  = dump.header->blockCount;
+    std::vector<std::vector<std::uint32_t>> edges(count);
+
+    const auto lookUp = [&](std::uint64_t address) -> std::uint64_t {
+        const auto it = std::upper_bound(blocks, blocks + count, address, [](std::uint64_t address, const auto& block) {
+            return address < block.address;
+        });
+        if (it == blocks) return UINT64_MAX;
+
+        const auto& block = *(it - 1);
+        return address < block.address + std::max<std::uint64_t>(block.size, 1) ? static_cast<std::uint64_t>(it - 1 - blocks) : UINT64_MAX;
+    };
+    const auto scan = [&](std::uint64_t begin, std::uint64_t end) {
+        for (auto i = begin; i < end; ++i) {
+            const auto contents = dump.contents(blocks[i]);
+            if (contents == nullptr) continue;
+
+            for (std::uint64_t offset = 0; offset + sizeof(std::uint64_t) <= blocks[i].size; offset += sizeof(std::uint64_t)) {
+                std::uint64_t word;
+                std::memcpy(&word, contents + offset, sizeof(word));
+                const auto target = lookUp(word);
+                if (target != UINT64_MAX && target != i) {
+                    edges[i].push_back(static_cast<std::uint32_t>(target));
+                }
+            }
+            std::sort(edges[i].begin(), edges[i].end());
+            edges[i].erase(std::unique(edges[i].begin(), edges[i].end()), edges[i].end());
+        }
+    };
+    const auto threadCount = std::max<std::uint64_t>(1, std::thread::hardware_concurrency());
+    const auto chunk       = (count + threadCount - 1) / threadCount;
+    std::vector<std::thread> threads;
+    for (std::uint64_t begin = 0; begin < count; begin += chunk) {
+        threads.emplace_back(scan, begin, std::min(count, begin + chunk));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return edges;
+}
+
+/**
+ * @brief Prints the blocks retaining the most bytes.
+ *
+ * The dominator tree of the pointer graph is computed. As the roots of the
+ * process are not part of the dump, every block not referenced by another
+ * block is considered to be a root. Blocks only reachable in cycles are
+ * treated as roots as well.
+ *
+ * @param path the path of the dump
+ * @param count the amount of blocks to be printed
+ */
+static void dominators(const std::string& path, std::size_t count) {
+    const Dump dump(path);
+    if ((dump.header->flags & LSAN_DUMP_CONTENTS) == 0) {
+        throw std::runtime_error(path + " does not contain the contents of the blocks");
+    }
+    const auto blocks     = dump.blocks();
+    const auto blockCount = dump.header->blockCount;
+    const auto& edges     = findEdges(dump);
+
+    // Node 0 is the virtual root, node i + 1 is the block i.
+    const auto nodeCount = blockCount + 1;
+    std::vector<std::vector<std::uint32_t>> predecessors(nodeCount);
+    std::vector<bool> referenced(nodeCount);
+    for (std::uint64_t i = 0; i < blockCount; ++i) {
+        for (const auto target : edges[i]) {
+            predecessors[target + 1].push_back(static_cast<std::uint32_t>(i + 1));
+            referenced[target + 1] = true;
+        }
+    }
+
+    std::vector<std::uint32_t> order, position(nodeCount, UINT32_MAX);
+    std::vector<std::uint32_t> rootChildren;
+    const auto traverse = [&](std::uint32_t start) {
+        std::vector<std::pair<std::uint32_t, std::size_t>> stack { { start, 0 } };
+        position[start] = 0;
+        while (!stack.empty()) {
+            auto& [node, next] = stack.back();
+            const auto& targets = node == 0 ? rootChildren : edges[node - 1];
+            if (next < targets.size()) {
+                const auto target = node == 0 ? targets[next++] : targets[next++] + 1;
+                if (position[target] == UINT32_MAX) {
+                    position[target] = 0;
+                    stack.push_back({ target, 0 });
+                }
+            } else {
+                order.push_back(node);
+                stack.pop_back();
+            }
+        }
+    };
+    for (std::uint32_t i = 1; i < nodeCount; ++i) {
+        if (!referenced[i]) {
+            rootChildren.push_back(i);
+        }
+    }
+    traverse(0);
+    for (std::uint32_t i = 1; i < nodeCount; ++i) {
+        if (position[i] == UINT32_MAX) {
+            // Only reachable in a cycle: traversed as another child of the virtual root.
+            rootChildren.push_back(i);
+            order.pop_back();
+            traverse(i);
+            order.push_back(0);
+        }
+    }
+    for (const auto child : rootChildren) {
+        predecessors[child].push_back(0);
+    }
+    // The order is the post order, the virtual root is the last node.
+    for (std::uint32_t i = 0; i < order.size(); ++i) {
+        position[order[i]] = i;
+    }
+
+    std::vector<std::uint32_t> dominator(nodeCount, UINT32_MAX);
+    dominator[0] = 0;
+    const auto intersect = [&](std::uint32_t lhs, std::uint32_t rhs) {
+        while (lhs != rhs) {
+            while (position[lhs] < position[rhs]) lhs = dominator[lhs];
+            while (position[rhs] < position[lhs]) rhs = dominator[rhs];
+        }
+        return lhs;
+    };
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto it = order.rbegin() + 1; it != order.rend(); ++it) {
+            auto candidate = UINT32_MAX;
+            for (const auto predecessor : predecessors[*it]) {
+                if (dominator[predecessor] == UINT32_MAX) continue;
+
+                candidate = candidate == UINT32_MAX ? predecessor : intersect(predecessor, candidate);
+            }
+            if (candidate != dominator[*it]) {
+                dominator[*it] = candidate;
+                changed = true;
+            }
+        }
+    }
+
+    std::vector<std::uint64_t> retained(nodeCount);
+    for (std::uint64_t i = 0; i < blockCount; ++i) {
+        retained[i + 1] = blocks[i].size;
+    }
+    for (const auto node : order) {
+        if (node != 0) {
+            retained[dominator[node]] += retained[node];
+        }
+    }
+
+    std::vector<std::uint32_t> sorted;
+    for (std::uint32_t i = 1; i < nodeCount; ++i) {
+        if (retained[i] > blocks[i - 1].size) {
+            sorted.push_back(i);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [&](const auto lhs, const auto rhs) {
+        return retained[lhs] > retained[rhs];
+    });
+    std::cout << "Blocks retaining other blocks, by retained bytes:" << std::endl << std::endl;
+    for (std::size_t i = 0; i < sorted.size() && i < count; ++i) {
+        const auto& block = blocks[sorted[i] - 1];
+        std::cout << "#" << i + 1 << ": 0x" << std::hex << block.address << std::dec << " of " << block.size
+                  << " bytes retains " << retained[sorted[i]] << " bytes" << std::endl;
+        dump.printStack(block.stack, std::cout);
+        std::cout << std::endl;
+    }
+}
+
+/**
+ * Prints the usage of this tool.
+ *
+ * @param name the name of this tool
+ * @return the exit code
+ */
+static auto usage(const char* name) -> int {
+    std::cerr << "Usage: " << name << " top <dump> [count]" << std::endl
+              << "       " << name << " diff <old dump> <new dump> [count]" << std::endl
+              << "       " << name << " dominators <dump> [count]" << std::endl;
+    return EXIT_FAILURE;
+}
+
+auto main(int argc, char** argv) -> int {
+    if (argc < 3) {
+        return usage(argv[0]);
+    }
+    try {
+        const std::string command = argv[1];
+        if (command == "top") {
+            top(argv[2], argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 10);
+        } else if (command == "diff" && argc > 3) {
+            diff(argv[2], argv[3], argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 10);
+        } else if (command == "dominators") {
+            dominators(argv[2], argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 10);
+        } else {
+            return usage(argv[0]);
+        }
+    } catch (const std::exception& exception) {
+        std::cerr << argv[0] << ": " << exception.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}